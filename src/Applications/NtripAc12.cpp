@@ -19,6 +19,7 @@
 #include "Rtcm3Station.h"
 #include "Rs232.h"
 #include "RawAC12.h"
+#include "BufferIn.h"
 #include <stdio.h>
 
 bool Configure(int argc, const char** argv);
@@ -74,7 +75,11 @@ bool GpsSession()
     debug("GpsSession: starting\n");
     // Initialize the gps receiver
     Rs232   in(SerialName);
-    RawAC12 gps(in);
+
+    // Read the receiver in a thread of its own, so a slow send to the
+    //   caster doesn't overflow the serial port
+    BufferIn buffered(in);
+    RawAC12 gps(buffered);
     if (gps.GetError() != OK)
         return Error("Unable to init the AC12  on port %s\n", SerialName);
 
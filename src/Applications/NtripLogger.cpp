@@ -18,6 +18,7 @@
 #include "NtripClient.h"
 #include "RawRtcm3.h"
 #include "SqliteLogger.h"
+#include "BufferIn.h"
 #include <stdio.h>
 
 bool Configure(int argc, const char** argv);
@@ -73,7 +74,11 @@ bool LoggerSession()
     debug("LoggerSession: starting\n");
     // Initialize the gps receiver
     NtripClient   in(CasterName, Port, Mount, User, Password);
-    RawRtcm3 gps(in);
+
+    // Read the caster in a thread of its own, so a slow database
+    //   commit doesn't hold up the data
+    BufferIn buffered(in);
+    RawRtcm3 gps(buffered);
     if (gps.GetError() != OK)
         return Error("Unable to read RTCM3.1 data from %s:%s/%s:%s:%s\n", 
                       CasterName, Port, Mount, User, Password);
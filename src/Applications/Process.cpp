@@ -20,7 +20,13 @@
 #include "RawReceiver.h"  
 #include "RawSimulator.h"
 #include "DoubleDiff.h"
+#include "MultiRover.h"
+#include "Smoother.h"
 #include "SP3.h" 
+#include "EphemerisAnchored.h"
+#include "EphemerisComposite.h"
+#include "RinexNav.h"
+#include "InputFile.h"
 #include "NewRawReceiver.h"
 #include "OutputFile.h"
 #include "Logger.h"
@@ -92,23 +98,42 @@ bool ResidualFile::PrintResiduals(DoubleDiff& dbl)
 
 
 bool Process(int argc, const char** argv);
+bool ProcessRovers(RawReceiver& base, Ephemerides& eph);
 bool Configure(int argc, const char** argv);
 bool DisplayOptions();
+bool SetTimeRange(RawReceiver& base);
+bool ParseTime(const char* str, Time day, Time& t);
+bool Smooth(Smoother& smoother, LocalEnu& BaseCentered, LocalEnu& RovingCentered);
+Triple ConvertPosition(Position& pos, LocalEnu& BaseCentered, LocalEnu& RovingCentered);
 
 
 // run string parameters
 static const char* BaseModel;
 static const char* BasePortName;
-static const char* RovingModel;
-static const char* RovingPortName;
+static int NrRovers;
+static const char* RovingModel[MultiRover::MaxRovers];
+static const char* RovingPortName[MultiRover::MaxRovers];
 static const char* Sp3Name;
+static const char* NavName;
 static const char* OutputName;
+static const char* SmoothName;
 static enum {SPACES, COMMAS} OutputType;
 static bool Static;
 extern bool CodeOnly;
+extern bool Robust;
+extern int RinexThreads;
 extern int DebugLevel;
 static enum {WGS84, ECEF, ENU, TEST} PositionType;
 static bool Simulator;
+static int Threads;
+static bool Fix;
+static double Ratio;
+static double FixBudget;  // msec
+static double AnchorStep; // sec
+static const char* StartArg;
+static const char* EndArg;
+static Time Start;
+static Time End;
 
 
 
@@ -130,25 +155,65 @@ bool Process(int argc, const char** argv)
         double MinRange = 9999e99;
         double MaxRange = -9999e99;
 
-	// Open up the two sources of raw measurements
+	// Every broadcast ephemeris we come across, from the navigation file
+	//   and from the receivers, so we can go back to older ones
+	EphemerisArchive* archive = new EphemerisArchive;
+
+	// Open up the base
 	RawReceiver* base = NewRawReceiver(BaseModel, BasePortName);
-	RawReceiver* roving = NewRawReceiver(RovingModel, RovingPortName);
-	if (base == NULL || roving == NULL) return Error();
+	if (base == NULL) return Error();
+	base->SetArchive(archive);
 
 	// Read the first epoch so we have initial position estimates
 	if (Range(base->Pos) == 0 && base->NextEpoch() != OK) return Error("Can't read first epoch from base\n");
-	if (Range(roving->Pos) == 0 && roving->NextEpoch() != OK) return Error("Can't read first epoch from rover\n");
+
+	// Skip ahead to the start time
+	if (SetTimeRange(*base) != OK) return Error();
 
 	// Configure the event logger to use base receiver's time clock
 	EventSetTime(&base->GpsTime);
  
-	// By default, we'll get the ephemerides from the base unit
-	Ephemerides *eph = base;
+	// Get each satellite from the best of the sp3 file, the archive,
+	//   the base and the rover
+	EphemeridesComposite* best = new EphemeridesComposite;
+	Ephemerides *eph = best;
 
 	// Open the sp3 file if given
-	if (Sp3Name != NULL)
-		eph = new SP3(Sp3Name);
-	if (eph == NULL) return Error();
+	if (Sp3Name != NULL && best->Add(*new SP3(Sp3Name), "sp3") != OK)
+		return Error();
+
+	// And all the broadcast ephemerides from a navigation file
+	if (NavName != NULL) {
+		InputFile nav(NavName);
+		RinexNav reader(nav);
+		if (reader.Read(*archive) != OK) return Error("Can't read navigation file %s\n", NavName);
+	}
+	best->Add(*archive, "archive");
+
+	// The base's broadcast ephemerides
+	best->Add(*base, "base");
+
+	// At high rates, interpolate the satellites between anchors
+	if (AnchorStep > 0)
+		eph = new EphemeridesAnchored(*eph, (Time)(AnchorStep * NsecPerSec));
+
+	// Several rovers share the work on the base
+	//   (their ephemerides aren't used or archived, since they are read
+	//    in their own threads)
+	if (NrRovers > 1)
+		return ProcessRovers(*base, *eph);
+
+	// Open up the rover
+	RawReceiver* roving = NewRawReceiver(RovingModel[0], RovingPortName[0]);
+	if (roving == NULL) return Error();
+	roving->SetArchive(archive);
+	if (Range(roving->Pos) == 0 && roving->NextEpoch() != OK) return Error("Can't read first epoch from rover\n");
+	if (StartArg != NULL && roving->SeekTo(Start) != OK) return Error("Can't skip the rover to %s\n", StartArg);
+	best->Add(*roving, "rover");
+
+	// Or simulate the rover's measurements from the ephemerides
+	if (Simulator)
+		roving = new RawSimulator(*roving, *eph, Static);
 
 	// Open the output file
 	PositionFormatter Output(OutputName, PositionType, OutputType);
@@ -162,6 +227,14 @@ bool Process(int argc, const char** argv)
 	DoubleDiff dbl(*eph, *base, *roving);
 	if (Static)
 		dbl.BeginStatic();
+	dbl.SetThreads(Threads);
+	dbl.SetFixing(Fix, Ratio, (Time)(FixBudget * NsecPerSec / 1000));
+
+	// Save the position equations for smoothing afterwards
+	Smoother* smoother = NULL;
+	if (SmoothName != NULL)
+		smoother = new Smoother;
+	if (smoother != NULL && smoother->GetError() != OK) return Error();
 
 	// Setup ENU coordinates centered at the base station
 	LocalEnu BaseCentered(base->Pos);
@@ -173,14 +246,10 @@ bool Process(int argc, const char** argv)
 	double fit;
 
 	// do for each position until "done"
-	while (dbl.NextPosition(time, pos, cep, fit) == OK) {
+	for (int32 epoch=0; dbl.NextPosition(time, pos, cep, fit) == OK && time <= End; epoch++) {
 
 		// Convert the ECEF position to the desired form
-		Triple triple;
-		if      (PositionType == ECEF)     triple = pos;
-		else if (PositionType == WGS84)    triple = PositionToWgs84(pos);
-		else if (PositionType == ENU)      triple = BaseCentered.ToEnu(pos);
-		else if (PositionType == TEST)     triple = RovingCentered.ToEnu(pos);
+		Triple triple = ConvertPosition(pos, BaseCentered, RovingCentered);
 
 		// Display the position
 		Output.PrintTime(base->GpsTime);
@@ -189,27 +258,259 @@ bool Process(int argc, const char** argv)
 
 		Residuals.PrintResiduals(dbl);
 
+		// Pass the epoch to the smoother
+		if (smoother != NULL) {
+			static PositionFactor f;
+			if (dbl.GetFactor(f) != OK) return Error();
+			if (cep == -1) f.NrAmbiguities = -1;
+			f.Epoch = epoch; f.GpsTime = base->GpsTime; f.Cep = cep; f.Fit = fit;
+			if (smoother->Forward(f) != OK) return Error();
+		}
+
                 MinRange = min(MinRange, Range(roving->Pos-base->Pos));
                 MaxRange = max(MaxRange, Range(roving->Pos-base->Pos));
 	}
 
         printf("The base ranged from %.3f km to %.3f km\n", MinRange, MaxRange);
         debug ("The base ranged from %.3f km to %.3f km\n", MinRange, MaxRange);
+	debug("Satellite states: %d hits, %d misses\n", eph->States().Hits, eph->States().Misses);
+	best->Display("at end");
+
+	// Show how quickly the ambiguities were fixed
+	if (Fix) {
+		FixStatistics st;
+		dbl.GetFixStatistics(st);
+		printf("Fixed %d of %d epochs. %d of %d segments were fixed.\n", 
+			(int)st.FixedEpochs, (int)st.Epochs, (int)st.FixedSegments, (int)st.Segments);
+		if (st.FixedSegments > 0)
+			printf("Time to first fix: average %.0f sec, min %.0f sec, max %.0f sec\n", 
+			st.TotalTtff/st.FixedSegments, st.MinTtff, st.MaxTtff);
+		printf("Integer search: %d searches, %d timed out, longest %.3f msec\n",
+			(int)st.Searches, (int)st.Timeouts, S(st.MaxSearchTime)*1000);
+	}
+
+	// Go back and output the smoothed positions
+	if (smoother != NULL) {
+		bool ok = Smooth(*smoother, BaseCentered, RovingCentered);
+		delete smoother;
+		if (ok != OK) return Error();
+	}
 
 	return OK;
 }
 
 
 
+//////////////////////////////////////////////////////////////////////////
+//
+// With several rovers, each gets its own output and residual files,
+//   named after the usual ones with the rover's number added on.
+//   They are written from the rover's own thread.
+//
+//////////////////////////////////////////////////////////////////////////
+
+class RoverFiles : public RoverOutput
+{
+public:
+	RoverFiles(const char* OutputName, const char* ResidualName, RawReceiver& base, RawReceiver& rover);
+	bool Write(DoubleDiff& dbl, Time t, Position& pos, double cep, double fit);
+	bool GetError() {return Output.GetError() || Residuals.GetError();}
+
+protected:
+	PositionFormatter Output;
+	ResidualFile Residuals;
+	LocalEnu BaseCentered;
+	LocalEnu RovingCentered;
+};
+
+
+RoverFiles::RoverFiles(const char* OutputName, const char* ResidualName, RawReceiver& base, RawReceiver& rover)
+: Output(OutputName, PositionType, OutputType), Residuals(ResidualName), 
+  BaseCentered(base.Pos), RovingCentered(rover.Pos)
+{
+}
+
+
+bool RoverFiles::Write(DoubleDiff& dbl, Time t, Position& pos, double cep, double fit)
+{
+	Triple triple = ConvertPosition(pos, BaseCentered, RovingCentered);
+
+	Output.PrintTime(t);
+	if (cep == -1)   Output.Write("  *** No Data ***\n");
+	else             Output.Data(triple[0], triple[1], triple[2], cep, fit);
+
+	return Residuals.PrintResiduals(dbl);
+}
+
+
+
+bool ProcessRovers(RawReceiver& base, Ephemerides& eph)
+//////////////////////////////////////////////////////////////////////////
+// Process all the rovers in parallel against the same base
+//////////////////////////////////////////////////////////////////////////
+{
+	if (SmoothName != NULL)
+		return Error("Smoothing only works with one rover\n");
+	if (Simulator)
+		return Error("Simulating only works with one rover\n");
+
+	// Open up the rovers, each with its own double difference engine and files
+	RawReceiver* roving[MultiRover::MaxRovers];
+	DoubleDiff* dbl[MultiRover::MaxRovers];
+	RoverFiles* files[MultiRover::MaxRovers];
+	MultiRover multi(eph, base);
+	for (int r=0; r<NrRovers; r++) {
+		roving[r] = NewRawReceiver(RovingModel[r], RovingPortName[r]);
+		if (roving[r] == NULL) return Error();
+		if (Range(roving[r]->Pos) == 0 && roving[r]->NextEpoch() != OK) 
+			return Error("Can't read first epoch from rover %s\n", RovingPortName[r]);
+		if (StartArg != NULL && roving[r]->SeekTo(Start) != OK)
+			return Error("Can't skip rover %s to %s\n", RovingPortName[r], StartArg);
+
+		char name[256], residuals[256];
+		snprintf(name, sizeof(name), "%s.%d", OutputName, r+1);
+		snprintf(residuals, sizeof(residuals), "residuals.txt.%d", r+1);
+		files[r] = new RoverFiles(name, residuals, base, *roving[r]);
+		if (files[r]->GetError() != OK) return Error("Can't open output file %s\n", name);
+
+		dbl[r] = new DoubleDiff(eph, base, *roving[r]);
+		if (Static)
+			dbl[r]->BeginStatic();
+		dbl[r]->SetThreads(Threads);
+		dbl[r]->SetFixing(Fix, Ratio, (Time)(FixBudget * NsecPerSec / 1000));
+
+		if (multi.AddRover(*dbl[r], *files[r]) != OK) return Error();
+	}
+
+	// Process them all
+	multi.SetEnd(End);
+	if (multi.Run() != OK) return Error();
+
+	// Show how each rover did
+	for (int r=0; r<NrRovers; r++) {
+		printf("Rover %d (%s)", r+1, RovingPortName[r]);
+		if (Fix) {
+			FixStatistics st;
+			dbl[r]->GetFixStatistics(st);
+			printf(": fixed %d of %d epochs", (int)st.FixedEpochs, (int)st.Epochs);
+			if (st.FixedSegments > 0)
+				printf(", first fix after %.0f sec on average", st.TotalTtff/st.FixedSegments);
+		}
+		printf("\n");
+	}
+
+	for (int r=0; r<NrRovers; r++) {
+		delete dbl[r];
+		delete files[r];
+		delete roving[r];
+	}
+
+	return OK;
+}
+
+
+
+bool Smooth(Smoother& smoother, LocalEnu& BaseCentered, LocalEnu& RovingCentered)
+{
+	// Wait for the backward pass to finish
+	if (smoother.Finish() != OK) return Error();
+
+	// Open the smoothed output file
+	PositionFormatter Output(SmoothName, PositionType, OutputType);
+	if (Output.GetError() != OK) return Error("Can't open output file %s\n", SmoothName);
+
+	// Copy the smoothed positions, in order
+	Time time;  Position pos;  double cep, fit;
+	while (smoother.NextPosition(time, pos, cep, fit) == OK) {
+		Triple triple = ConvertPosition(pos, BaseCentered, RovingCentered);
+		Output.PrintTime(time);
+		if (cep == -1)   Output.Write("  *** No Data ***\n");
+		else             Output.Data(triple[0], triple[1], triple[2], cep, fit);
+	}
+
+	return OK;
+}
+
+
+
+bool SetTimeRange(RawReceiver& base)
+//////////////////////////////////////////////////////////////////////////
+// Work out the start and end times, and move the base to the start.
+//   A time without a date is on the day of the base's first epoch.
+//////////////////////////////////////////////////////////////////////////
+{
+	if (StartArg == NULL && EndArg == NULL) return OK;
+
+	// We need a first epoch to know what day it is
+	if (base.GpsTime == 0 && base.NextEpoch() != OK)
+		return Error("Can't read first epoch from base\n");
+	int32 year, month, day;
+	TimeToDate(base.GpsTime, year, month, day);
+	Time FirstDay = DateToTime(year, month, day);
+
+	if (EndArg != NULL && ParseTime(EndArg, FirstDay, End) != OK)
+		return Error();
+	if (StartArg == NULL)
+		return OK;
+	if (ParseTime(StartArg, FirstDay, Start) != OK)
+		return Error();
+
+	debug("SetTimeRange: start=%.3f  end=%.3f\n", S(Start), S(End));
+	if (base.SeekTo(Start) != OK)
+		return Error("Can't skip the base to %s\n", StartArg);
+	return OK;
+}
+
+
+bool ParseTime(const char* str, Time day, Time& t)
+// Convert "[yyyy/mm/dd/]hh:mm[:ss]"
+{
+	int year, month, mday, hour, min;
+	double sec = 0;
+	if (sscanf(str, "%d/%d/%d/%d:%d:%lf", &year, &month, &mday, &hour, &min, &sec) >= 5)
+		t = DateToTime(year, month, mday) + TodToTime(hour, min, sec);
+	else if (sscanf(str, "%d:%d:%lf", &hour, &min, &sec) >= 2)
+		t = day + TodToTime(hour, min, sec);
+	else
+		return Error("Didn't understand the time %s. Use [yyyy/mm/dd/]hh:mm[:ss]\n", str);
+	return OK;
+}
+
+
+
+Triple ConvertPosition(Position& pos, LocalEnu& BaseCentered, LocalEnu& RovingCentered)
+// Convert the ECEF position to the desired form
+{
+	Triple triple;
+	if      (PositionType == ECEF)     triple = pos;
+	else if (PositionType == WGS84)    triple = PositionToWgs84(pos);
+	else if (PositionType == ENU)      triple = BaseCentered.ToEnu(pos);
+	else if (PositionType == TEST)     triple = RovingCentered.ToEnu(pos);
+	return triple;
+}
+
+
+
  bool Configure(int argc, const char** argv)
  {
      // defaults
 	 CodeOnly = false;
+	 Robust = false;
 	 Static = false;
 	 Sp3Name = NULL;
+	 NavName = NULL;
 	 OutputName = NULL;
+	 SmoothName = NULL;
 	 OutputType = SPACES;
 	 Simulator = false;
+	 Threads = 1;
+	 Fix = false;
+	 Ratio = 3;
+	 FixBudget = 50;
+	 AnchorStep = 0;
+	 StartArg = NULL;
+	 EndArg = NULL;
+	 End = MaxTime;
 
 	 // Do for each argument
 	 const char* arg;
@@ -218,7 +519,9 @@ bool Process(int argc, const char** argv)
 
 		 if (Same(argv[i], "-codeonly"))     CodeOnly = true;
 		 else if (Same(argv[i], "-static"))  Static = true;
+		 else if (Same(argv[i], "-robust"))  Robust = true;
 		 else if (Match(argv[i], "-sp3=", Sp3Name))   ;
+		 else if (Match(argv[i], "-nav=", NavName))   ;
 		 else if (Match(argv[i], "-ecef=", OutputName))    PositionType = ECEF;
 		 else if (Match(argv[i], "-enu=", OutputName))     PositionType = ENU;
 		 else if (Match(argv[i], "-wgs84=", OutputName))   PositionType = WGS84;
@@ -226,19 +529,35 @@ bool Process(int argc, const char** argv)
 		 else if (Match(argv[i], "-debug=", arg))          DebugLevel = atoi(arg);
 		 else if (Same(argv[i], "-commas"))                OutputType = COMMAS;
 		 else if (Same(argv[i], "-simulator"))             Simulator=true;
+		 else if (Match(argv[i], "-threads=", arg))        Threads = atoi(arg);
+		 else if (Match(argv[i], "-load=", arg))           RinexThreads = atoi(arg);
+		 else if (Match(argv[i], "-smooth=", SmoothName))  ;
+		 else if (Same(argv[i], "-fix"))                   Fix = true;
+		 else if (Match(argv[i], "-ratio=", arg))          Ratio = atof(arg);
+		 else if (Match(argv[i], "-fixbudget=", arg))      FixBudget = atof(arg);
+		 else if (Match(argv[i], "-anchors=", arg))        AnchorStep = atof(arg);
+		 else if (Same(argv[i], "-anchors"))               AnchorStep = S(EphemeridesAnchored::DefaultStep);
+		 else if (Match(argv[i], "-start=", StartArg))     ;
+		 else if (Match(argv[i], "-end=", EndArg))         ;
 		 else    return Error("Didn't recognize option %s\n", argv[i]);
 	 }
 
 	 if (OutputName == NULL)
 		 return Error("Need to specify an output file. (eg. ""-wgs84=file.out"") \n");
 
-	 if (argc-i < 4)
+	 if (argc-i < 4 || (argc-i) % 2 != 0)
 		 return Error("Need to specify: BaseModel BaseFile RovingModel RovingFile\n");
 
 	 BaseModel = argv[i];
 	 BasePortName = argv[i+1];
-	 RovingModel = argv[i+2];
-	 RovingPortName = argv[i+3];
+
+	 // Any number of rovers may follow
+	 for (NrRovers=0, i+=2; i<argc; NrRovers++, i+=2) {
+		 if (NrRovers >= MultiRover::MaxRovers)
+			 return Error("No more than %d rovers\n", MultiRover::MaxRovers);
+		 RovingModel[NrRovers] = argv[i];
+		 RovingPortName[NrRovers] = argv[i+1];
+	 }
 
 	 return OK;
  }
@@ -247,31 +566,48 @@ bool Process(int argc, const char** argv)
  bool DisplayOptions()
  {
 	 printf("\n");
-     printf("Process [options] BaseModel BaseFile RovingModel RovingFile\n");
+     printf("Process [options] BaseModel BaseFile RovingModel RovingFile [RovingModel RovingFile ...]\n");
 	 printf("     Double difference postprocessor for GPS data\n");
 	 printf("\n");
 	 printf("        BaseModel - the type of gps (or data) for the base receiver\n");
 	 printf("        BaseFile  - the name of base receiver's data file\n");
 	 printf("        RovingModel - type of gps (or data) for the rover\n");
 	 printf("        RovingFile - the name of the roving receiver's data file\n");
+	 printf("    With more than one rover, the base is read once and the rovers\n");
+	 printf("      are processed in parallel. Rover n's output goes to outputfile.n\n");
+	 printf("      and its residuals to residuals.txt.n\n");
      printf("\n");
 	 printf("    The following ""models"" are supported\n");
 	 printf("        RINEX      - Rinex V2.3\n");
 	 printf("        XENIR      - Rinex, but with phase reversed\n");
 	 printf("        RTCM       - Rtcm104 (RTK) messages xx xx xx\n");
+	 printf("        SQLITE     - observations saved in an Sqlite database\n");
 	 printf("        <receiver> - Raw data stream from a gps receiver\n");
 	 printf("                     (AC12, ANTARIS, SIRF, LASSENIQ, ALLSTAR, GPS18)\n");
 	 printf("\n");    
 	 printf("    Where {options} include any of the following:\n");
 	 printf("        -static    - the roving receiver is standing still\n");
 	 printf("        -codeonly  - do the calculation without carrier phase\n");
+	 printf("        -robust    - reweight bad observations rather than dropping satellites\n");
      printf("        -sp3=ephfile  - use precise ephemerides from ""file""\n");
-	 printf("                     (otherwise, use base receiver's broadcast eph if avail)\n");
+	 printf("                     (otherwise, use the best broadcast eph of the base and rover)\n");
+	 printf("        -nav=navfile  - use all the broadcast ephemerides in a Rinex nav file\n");
 	 printf("        -enu=outputfile  - output ENU from Base\n");
 	 printf("        -ecef=outputfile - output ECEF (XYZ)\n");
 	 printf("        -wgs84=outputfile - output Lat/Lon/Alt (default)\n");
 	 printf("        -test=outputfile  - output ENU relative to initial rover position\n");
 	 printf("        -commas          - output is comma separated\n");
+	 printf("        -threads=n       - use n threads when looking for bad satellites\n");
+	 printf("        -smooth=outputfile - also output positions smoothed with the final ambiguities\n");
+	 printf("        -fix             - fix the phase ambiguities at integers\n");
+	 printf("        -ratio=r         - accept a fix if the next best is r times worse (default 3)\n");
+	 printf("        -fixbudget=msec  - most time to spend fixing each epoch (default 50)\n");
+	 printf("        -anchors[=sec]   - for >1 Hz data, only calculate the satellites every\n");
+	 printf("                           sec seconds and interpolate in between (default 15)\n");
+	 printf("        -simulator       - replace the rover's measurements with simulated ones\n");
+	 printf("        -start=time      - skip ahead to time, as [yyyy/mm/dd/]hh:mm[:ss]\n");
+	 printf("                           (without a date, on the day the base starts)\n");
+	 printf("        -end=time        - stop after time\n");
      printf("    This is version '%s' built on %s %s\n", VERSION, __TIME__, __DATE__);
 	 printf("\n");
 	 return OK;
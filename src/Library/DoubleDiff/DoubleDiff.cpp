@@ -32,10 +32,6 @@
 //
 // TO DO:
 //   o Statistically valid error estimates. 
-//   o (eventually) Integer solution of phase ambiguity variables.
-//   o Save data necessary to move backward in time. This allows us to
-//     use our final values of the phase variables to update earlier estimates 
-//     of positions. (smoothing).
 //   o Allow roving receiver to take up a known station and improve the location
 //     of the stationary receiver.  (eg. stationary is on car in parking lot,
 //     rover stops at a known benchmark for a short time.)
@@ -43,6 +39,7 @@
 ////////////////////////////////////////////////////////////////////////////////
 
 #include "DoubleDiff.h"
+#include "Thread.h"
 
 
 
@@ -55,6 +52,16 @@ DoubleDiff::DoubleDiff(Ephemerides& e, RawReceiver& s, RawReceiver& r)
 	// Assume Kinematic by default
 	Kinematic = true;
 
+	// Search for bad satellites in the calling thread
+	Threads = 1;
+
+	// Float solution unless asked
+	Fixing = false;
+
+	// No slips waiting for a common epoch
+	for (int s=0; s<MaxSats; s++)
+		Slip[s] = false;
+
 	// Current and previous observations. Pointers so we can swap easily.
 	Obs = new Observations;
 	PreviousObs = new Observations;
@@ -77,13 +84,52 @@ bool DoubleDiff::NextPosition(Time& t, Position& pos, double& cep, double& fit)
 	// Save the old observations and get new ones
 	Swap(Obs, PreviousObs);
 	Obs->Init(Base, Rover, Eph);
-	
+
+	return SolveEpoch(t, pos, cep, fit);
+}
+
+
+
+bool DoubleDiff::NextPosition(BaseEpoch& b, bool& common, Time& t, Position& pos, double& cep, double& fit)
+///////////////////////////////////////////////////////////////////////////
+// Same as above, but the base epochs come from elsewhere, one at a time.
+//   Several rovers can share the same base epoch. If the rover has no
+//   epoch at the same time, common is false and there is no position.
+///////////////////////////////////////////////////////////////////////////
+{
+	// Advance the rover to the base's epoch
+	if (RoverNextEpoch(b, common) != OK) return Error();
+	if (!common) return OK;
+
+    if (Kinematic)
+		solution.NewPosition(LastComputedPosition);
+
+	// Save the old observations and get new ones
+	Swap(Obs, PreviousObs);
+	Obs->Init(b, Rover);
+	if (Obs->GetError() != OK) return Error();
+	for (int s=0; s<MaxSats; s++) {
+		(*Obs)[s].Slip = (*Obs)[s].Slip || Slip[s];
+		Slip[s] = false;
+	}
+
+	return SolveEpoch(t, pos, cep, fit);
+}
+
+
+
+bool DoubleDiff::SolveEpoch(Time& t, Position& pos, double& cep, double& fit)
+{
 	// Decide which satellites we are going to use
 	Check.SelectSatellites(*Obs, *PreviousObs);
 
 	// Find the best solution, dropping satellites if necesary
 	if (FindBestSolution(*Obs, pos, cep, fit) != OK) return Error();
 
+	// Try to fix the ambiguities at integers
+	if (Fixing && cep != -1)
+		if (solution.Fix(*Obs, pos) != OK) return Error();
+
 	// Keep track of our last position
 	if (cep < 0)     pos = LastComputedPosition;
 	else             LastComputedPosition = pos;
@@ -100,6 +146,17 @@ bool DoubleDiff::NextPosition(Time& t, Position& pos, double& cep, double& fit)
 
 bool DoubleDiff::FindBestSolution(Observations& Obs, Position& pos, double& cep, double& fit)
 {
+	// In robust mode, reweight the observations rather than searching for bad ones
+	if (Check.IsRobust()) {
+		if (solution.UpdateRobust(Obs, Check.GetRobustParameters(), pos, cep, fit) != OK)
+			return Error();
+		if (Check.Acceptable(Obs, solution)) return OK;
+		Event("Unable get solution. Starting all over.  fit=%.1f\n", fit);
+		solution.Reset();
+		cep = -1;
+		return OK;
+	}
+
 	// Save our current solution so we can roll back if necessary
 	Solution backup = solution;
 
@@ -109,15 +166,17 @@ bool DoubleDiff::FindBestSolution(Observations& Obs, Position& pos, double& cep,
 	// If the solution is acceptable (or none found), then done
 	if (Check.Acceptable(Obs, solution)) return OK;
 
-      // Drop the worst of the satellites.
-      solution = backup;
+      // Drop the worst of the satellites. (trials are downdated from the full solution)
       double oldfit = fit;
       int Worst1 = -1; int Worst2 = -1;
-      if (DropWorst(Obs, Worst1) != OK) return Error();
+      if (DropWorst(backup, Obs, Worst1) != OK) return Error();
 
       // If didn't work, drop the two worst satellites
       if (Worst1 == -1)
-          if (Drop2Worst(Obs, Worst1, Worst2) != OK) return Error();
+          if (Drop2Worst(backup, Obs, Worst1, Worst2) != OK) return Error();
+
+      // Roll back, since the satellites must be dropped before updating
+      solution = backup;
 
       // If no acceptable solution found, start all over.
       if (Worst1 == -1) {
@@ -136,30 +195,69 @@ bool DoubleDiff::FindBestSolution(Observations& Obs, Position& pos, double& cep,
 
      
 
-bool DoubleDiff::DropWorst(Observations& Obs, int& WorstSat)
+static bool TryExclusion(Policy& check, Solution& before, Solution& sol, Observations& obs, 
+                         int s, int t, double& fit)
+///////////////////////////////////////////////////////////////////////
+// Try the solution without satellite s, and also t if it isn't -1.
+//   fit is -1 if the remaining satellites aren't acceptable.
+// sol is the solution with all the satellites, and before is the one from
+//   the previous epoch. Dropping the reference satellite changes the double
+//   differences, so that trial starts from before and updates in full.
+///////////////////////////////////////////////////////////////////////
 {
-	Solution backup = solution;
+	// Take the satellites out of the current solution if we can
+	bool downdate = sol.CanExclude(s, t);
+	if (downdate && sol.Exclude(obs, s, t, fit) != OK) return Error();
+
+	// do a temporary reconfiguration without the satellites
+	bool oldphases = obs[s].ValidPhase; obs[s].ValidPhase = false;
+	bool oldcodes  = obs[s].ValidCode;  obs[s].ValidCode = false;
+	bool oldphaset, oldcodet;
+	if (t != -1) {
+		oldphaset = obs[t].ValidPhase; obs[t].ValidPhase = false;
+		oldcodet  = obs[t].ValidCode;  obs[t].ValidCode = false;
+	}
+
+	// Is the configuration acceptable?
+	if (downdate) {
+		if (fit != -1 && !check.Acceptable(obs, sol))
+			fit = -1;
+	}
+	else {
+		Solution trial(before);
+		Position pos; double cep;
+		if (trial.Update(obs, pos, cep, fit) != OK) return Error();
+		if (!check.Acceptable(obs, trial))
+			fit = -1;
+	}
+
+	// Undo the temporary reconfiguration
+	obs[s].ValidPhase = oldphases;
+	obs[s].ValidCode = oldcodes;
+	if (t != -1) {
+		obs[t].ValidPhase = oldphaset;
+		obs[t].ValidCode = oldcodet;
+	}
+	return downdate? sol.Restore(): OK;
+}
+
+
 
+bool DoubleDiff::DropWorst(Solution& before, Observations& Obs, int& WorstSat)
+{
 	// do for each valid satellite
 	WorstSat = -1; double WorstFit = 999999;
 	for (int s=0; s<MaxSats; s++) {
 		if (!Obs[s].ValidPhase && !Obs[s].ValidCode) continue;
-
-	    // do a temporary reconfiguration without the satellite
-		bool oldphase = Obs[s].ValidPhase; Obs[s].ValidPhase = false;
-		bool oldcode  = Obs[s].ValidCode;  Obs[s].ValidCode = false;
 		debug("DoubledDiff::Update - experimentally droppinng %d\n", s);
 
+		// Try the solution without the satellite
+		double fit;
+		if (TryExclusion(Check, before, solution, Obs, s, -1, fit) != OK) return Error();
+
 		// keep track of the most acceptable configuration (ie worst satellite)
-          Position pos; double cep; double fit;
-	    if (solution.Update(Obs, pos, cep, fit) != OK) return Error();
-		if (Check.Acceptable(Obs, solution) && fit < WorstFit)
+		if (fit != -1 && fit < WorstFit)
 			{WorstSat = s; WorstFit=fit;}
-
-		// Undo the temporary reconfiguration
-		solution = backup;
-		Obs.obs[s].ValidPhase = oldphase;
-		Obs.obs[s].ValidCode = oldcode;
 	}
 	debug("DoubleDiff::Update - WorstSat=%d\n", WorstSat);
 
@@ -171,35 +269,143 @@ bool DoubleDiff::DropWorst(Observations& Obs, int& WorstSat)
 
 
 
-bool DoubleDiff::Drop2Worst(Observations& Obs, int& Worst1, int& Worst2)
+//////////////////////////////////////////////////////////////////////////
+//
+// Dropping two satellites means trying every pair of them, so the search
+//   can be spread across several threads. Each thread works on its own
+//   copy of the solution and observations, and takes a few more pairs
+//   from a shared queue whenever it runs out of work.
+//
+//////////////////////////////////////////////////////////////////////////
+
+class PairQueue
 {
-	Solution backup = solution;
+public:
+	int NrPairs;
+	int Pair[MaxSats*(MaxSats-1)/2][2];
 
-	// do for each valid satellite
-	Worst1 = Worst2 = -1; double WorstFit = 999999;
+	PairQueue() {NrPairs = 0; Next = 0;}
+	void Add(int s, int t) {Pair[NrPairs][0] = s; Pair[NrPairs][1] = t; NrPairs++;}
+	bool Take(int& first, int& last);
+
+private:
+	static const int Chunk = 4;
+	Mutex m;
+	int Next;
+};
+
+
+bool PairQueue::Take(int& first, int& last)
+{
+	// Hand out the next few pairs, or false if there are none left
+	m.Lock();
+	first = Next;
+	last = min(Next+Chunk, NrPairs);
+	Next = last;
+	m.Unlock();
+
+	return first < last;
+}
+
+
+
+class PairSearch : public Thread
+{
+public:
+	int Best;          // index of the best pair, -1 if none acceptable
+	double BestFit;
+	bool ErrCode;
+
+	PairSearch(PairQueue& q, Policy& check, Solution& before, Solution& sol, Observations& obs);
+	inline bool GetError() {return ErrCode;}
+
+protected:
+	void Run();
+
+	PairQueue& Queue;
+	Policy& Check;
+	Solution& Before;     // shared, only copied from
+	Solution sol;
+	Observations obs;
+};
+
+
+PairSearch::PairSearch(PairQueue& q, Policy& check, Solution& before, Solution& s, Observations& o)
+: Queue(q), Check(check), Before(before), sol(s), obs(o)
+{
+	Best = -1; BestFit = 999999;
+	ErrCode = OK;
+}
+
+
+void PairSearch::Run()
+{
+	// Pairs arrive in increasing order, so ties go to the earliest pair
+	int first, last;
+	while (ErrCode == OK && Queue.Take(first, last))
+		for (int i=first; i<last; i++) {
+			double fit;
+			if (TryExclusion(Check, Before, sol, obs, Queue.Pair[i][0], Queue.Pair[i][1], fit) != OK)
+				{ErrCode = Error(); break;}
+			if (fit != -1 && fit < BestFit)
+				{Best = i; BestFit = fit;}
+		}
+}
+
+
+
+bool DoubleDiff::Drop2Worst(Solution& before, Observations& Obs, int& Worst1, int& Worst2)
+{
+	// Make a list of the pairs of valid satellites
+	PairQueue queue;
 	for (int s=0; s<MaxSats; s++) for (int t=s+1; t<MaxSats; t++) {
 		if (!Obs[s].ValidPhase && !Obs[s].ValidCode) continue;
             if (!Obs[t].ValidPhase && !Obs[t].ValidCode) continue;
+		queue.Add(s, t);
+	}
 
-	    // do a temporary reconfiguration without the satellite
-		bool oldphases = Obs[s].ValidPhase; Obs[s].ValidPhase = false;
-		bool oldcodes  = Obs[s].ValidCode;  Obs[s].ValidCode = false;
-            bool oldphaset = Obs[t].ValidPhase; Obs[t].ValidPhase = false;
-            bool oldcodet  = Obs[t].ValidCode;  Obs[t].ValidCode = false;
-		debug("DoubledDiff::Update - experimentally droppinng %d and %d\n", s, t);
+	// Don't bother with threads unless each one gets a reasonable share
+	static const int MinPairsPerThread = 8;
+	int threads = min(Threads, queue.NrPairs/MinPairsPerThread);
+
+	// Find the pair giving the most acceptable configuration
+	int Best = -1; double WorstFit = 999999;
+	if (threads <= 1) {
+		for (int i=0; i<queue.NrPairs; i++) {
+			debug("DoubledDiff::Update - experimentally droppinng %d and %d\n", 
+				queue.Pair[i][0], queue.Pair[i][1]);
+			double fit;
+			if (TryExclusion(Check, before, solution, Obs, queue.Pair[i][0], queue.Pair[i][1], fit) != OK)
+				return Error();
+			if (fit != -1 && fit < WorstFit)
+				{Best = i; WorstFit=fit;}
+		}
+	}
 
-		// keep track of the most acceptable configuration (ie worst satellite)
-          Position pos; double cep; double fit;
-	    if (solution.Update(Obs, pos, cep, fit) != OK) return Error();
-		if (Check.Acceptable(Obs, solution) && fit < WorstFit)
-			{Worst1 = s; Worst2 = t; WorstFit=fit;}
-
-		// Undo the temporary reconfiguration
-		solution = backup;
-		Obs[s].ValidPhase = oldphases;
-		Obs[s].ValidCode = oldcodes;
-            Obs[t].ValidPhase = oldphaset;
-            Obs[t].ValidCode = oldcodet;
+	else {
+		// Start the workers
+		PairSearch* worker[MaxThreads];
+		bool err = OK;
+		for (int i=0; i<threads; i++) {
+			worker[i] = new PairSearch(queue, Check, before, solution, Obs);
+			if (worker[i]->Start() != OK) err = Error();
+		}
+
+		// Wait for them, keeping the best. Ties go to the earliest pair, same as one thread.
+		for (int i=0; i<threads; i++) {
+			if (worker[i]->Join() != OK || worker[i]->GetError() != OK) err = Error();
+			if (worker[i]->Best != -1 && (worker[i]->BestFit < WorstFit 
+			       || (worker[i]->BestFit == WorstFit && worker[i]->Best < Best)))
+				{Best = worker[i]->Best; WorstFit = worker[i]->BestFit;}
+			delete worker[i];
+		}
+		if (err != OK) return Error("Drop2Worst: search thread failed\n");
+	}
+
+	Worst1 = Worst2 = -1;
+	if (Best != -1) {
+		Worst1 = queue.Pair[Best][0];
+		Worst2 = queue.Pair[Best][1];
 	}
 	debug("DoubleDiff::Update - Worst1=%d  Worst2=%d\n", Worst1, Worst2);
 
@@ -218,6 +424,17 @@ void DoubleDiff::BeginKinematic()
 	Kinematic = true;
 }
 
+void DoubleDiff::SetThreads(int threads)
+{
+	Threads = max(1, min(threads, (int)MaxThreads));
+}
+
+void DoubleDiff::SetFixing(bool fixing, double ratio, Time budget)
+{
+	Fixing = fixing;
+	solution.SetFixing(ratio, budget);
+}
+
 void DoubleDiff::BeginStatic()
 {
 	Event("Begin Static - Rover is stationary\n");
@@ -272,6 +489,29 @@ bool DoubleDiff::DoubleNextEpoch(RawReceiver& base, RawReceiver& rover)
 }
 
 
+bool DoubleDiff::RoverNextEpoch(BaseEpoch& b, bool& common)
+///////////////////////////////////////////////////////////////////////////
+// Advance the rover until it reaches the base epoch's time.
+//   Slips in any epochs skipped by either receiver are remembered
+//   until the two have an epoch in common.
+///////////////////////////////////////////////////////////////////////////
+{
+	for (int s=0; s<MaxSats; s++)
+		Slip[s] |= !b.obs[s].Valid || b.obs[s].Slip || b.obs[s].Phase == 0;
+
+	while (Rover.GpsTime < b.GpsTime) {
+		if (Rover.NextEpoch() != OK) return Error();
+		for (int s=0; s<MaxSats; s++)
+			Slip[s] |= !Rover.obs[s].Valid || Rover.obs[s].Slip || Rover.obs[s].Phase == 0;
+	}
+
+	common = (Rover.GpsTime == b.GpsTime);
+	if (common)
+		GpsTime = b.GpsTime;
+	return OK;
+}
+
+
 void DoubleDiff::Reset()
 {
 	solution.Reset();
@@ -45,8 +45,18 @@ protected: // Data
 	RawReceiver& Rover;
 	bool Kinematic;
 
+	// How many threads search for satellites to drop
+	int Threads;
+	static const int MaxThreads = 64;
+
+	// Whether to fix the integer ambiguities
+	bool Fixing;
+
 	Observations *Obs, *PreviousObs;
 
+	// When the base is shared, slips since the last common epoch
+	bool Slip[MaxSats];
+
 	// Current estimated positions
 	Position LastComputedPosition;
 
@@ -59,8 +69,11 @@ protected: // Data
 public:
 	DoubleDiff(Ephemerides& e, RawReceiver& s, RawReceiver& r);
 	bool NextPosition(Time& time, Position& pos, double& cep, double& fit);
+	bool NextPosition(BaseEpoch& b, bool& common, Time& time, Position& pos, double& cep, double& fit);
 	void BeginStatic();
 	void BeginKinematic();
+	void SetThreads(int threads);
+	void SetFixing(bool fixing, double ratio, Time budget);
 	virtual ~DoubleDiff(void);
 
 	void LogResiduals();
@@ -73,15 +86,20 @@ public:
 	bool ValidPhase(int sat)         {return (*Obs)[sat].ValidPhase;}
 	double GetCodeResidual(int sat)  {return solution.GetCodeResidual(sat);} 
 	double GetPhaseResidual(int sat) {return solution.GetPhaseResidual(sat);}
+	bool GetFactor(PositionFactor& f) {return solution.GetFactor(f);}
+	bool IsFixed()                   {return solution.IsFixed();}
+	void GetFixStatistics(FixStatistics& st) {solution.GetFixStatistics(st);}
 
 private: // Procedures
     bool DoubleNextEpoch(RawReceiver& base, RawReceiver& rover);
+	bool RoverNextEpoch(BaseEpoch& b, bool& common);
+	bool SolveEpoch(Time& t, Position& pos, double& cep, double& fit);
 	void NewPosition(Position& pos);
 	bool UpdateObservations(Position& pos, double& cep, double& fit);
 	void Reset();
 	bool FindBestSolution(Observations &Obs, Position& pos, double& cep, double& fit);
-        bool DropWorst(Observations& Obs, int& sat);
-        bool Drop2Worst(Observations& obs, int& Worst1, int& Worst2);
+        bool DropWorst(Solution& before, Observations& Obs, int& sat);
+        bool Drop2Worst(Solution& before, Observations& obs, int& Worst1, int& Worst2);
 };
 
 #endif // DOUBLEDIFF_INCLUDED
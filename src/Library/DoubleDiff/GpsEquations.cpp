@@ -25,7 +25,8 @@
 //   whole waves. In this case, we do a least squares estimate and let
 //   the resultss fall on fractional numbers. We should get a good solution,
 //   but the resulting positions are not as precise as if we figured out the 
-//   exact integers. I hope to add integer "fixed" solutions at a later date.
+//   exact integers. Once the float values settle down, Lambda can find the 
+//   integers, and they are fed back into these equations as constraints.
 //
 // All of the mathematics is based on Householder transformations. These
 //   linear transformations take the place of conventional "elimination" 
@@ -64,6 +65,9 @@
 //      appending the new observation equations to the previous NxN matrix and
 //      applying Householder transforms until we again have an NxN upper diagonal
 //      matrix.
+//    o When looking for a bad satellite, its equations are "downdated" out
+//      of the upper diagonal matrix rather than solving all over again.
+//      (See LinearEquations::Downdate)
 //
 // Summarizing the mathematics, Householder transforms are everything!
 //    They allow us to rearrange and eliminate variables to our heart's content
@@ -72,6 +76,8 @@
 // To keep memory management and matrix operations simple, we allocate a single
 //   fixed size matrix.  The first five columns hold Tphase, Tcode, X, Y and Z,
 //   and the subsequent columns contain the ambiguity variables.
+//   The size is a template parameter, and the Solution switches to a larger
+//   (or smaller) size as the number of satellites changes. (See NewGpsEquations)
 //
 // At the end of every epoch, the matrix is NxN upper diagonal and contains the 
 //   least squares solution.
@@ -81,7 +87,8 @@
 #include "GpsEquations.h"
 
 
-GpsEquations::GpsEquations()
+template <int Channels>
+GpsEquations<Channels>::GpsEquations()
 {
 	Reset();
 }
@@ -89,7 +96,8 @@ GpsEquations::GpsEquations()
 
 
 
-bool GpsEquations::SolvePosition(Position& offset, double& cep, double& fit)
+template <int Channels>
+bool GpsEquations<Channels>::SolvePosition(Position& offset, double& cep, double& fit)
 {
 	Debug("GpsEquations::SolvePosition  (start)");
 
@@ -114,41 +122,81 @@ bool GpsEquations::SolvePosition(Position& offset, double& cep, double& fit)
 	return OK;
 }
 
-bool GpsEquations::AppendCode(Triple& e, double b, double weight)
+template <int Channels>
+bool GpsEquations<Channels>::AppendCode(Triple& e, double b, double weight)
 {
 	debug(2, "GpsEquations::AppendCode e=(%g,%g,%g) b=%g weight=%g\n",e[0],e[1],e[2],b,weight);
 	int row = AddRow();
-	A[row][TcCol] = 1   * weight;
-	A[row][XCol] = e[0] * weight;
-	A[row][YCol] = e[1] * weight;
-	A[row][ZCol] = e[2] * weight;
-	B[row] = b * weight;
+	CodeRow(e, b, weight, A[row], B[row]);
 
 	return OK;
 }
 
 
-bool GpsEquations::AppendPhase(Triple& e, double p, int sat, double v, double nonv, double weight)
+template <int Channels>
+void GpsEquations<Channels>::CodeRow(Triple& e, double b, double weight, double* row, double& rhs)
+// Build a code equation without adding it. (The equation can later be downdated)
+{
+	for (int c = 0; c<=LastCol; c++)
+		row[c] = 0;
+	row[TcCol] = 1   * weight;
+	row[XCol] = e[0] * weight;
+	row[YCol] = e[1] * weight;
+	row[ZCol] = e[2] * weight;
+	rhs = b * weight;
+}
+
+
+template <int Channels>
+bool GpsEquations<Channels>::AppendPhase(Triple& e, double p, int sat, double v, double nonv, double weight)
 {
 	int col = SatelliteToColumn[sat];
 	debug(2, "GpsEquations::AppendPhase e=(%g,%g,%g) p=%g weight=%g v=%g nonv=%g sat=%d col=%d\n",
 		e[0],e[1],e[2], p, weight, v, nonv, sat, col);
 	int row = AddRow();
 	if (row == -1) return Error();
-	A[row][TpCol] = 1   * weight;
-	A[row][XCol] = e[0] * weight;
-	A[row][YCol] = e[1] * weight;
-	A[row][ZCol] = e[2] * weight;
-	B[row] = p * weight;
+	PhaseRow(e, p, sat, v, nonv, weight, A[row], B[row]);
+
+	return OK;
+}
+
+
+template <int Channels>
+void GpsEquations<Channels>::PhaseRow(Triple& e, double p, int sat, double v, double nonv, double weight,
+							double* row, double& rhs)
+// Build a phase equation without adding it.
+{
+	int col = SatelliteToColumn[sat];
+	for (int c = 0; c<FirstPhase; c++)
+		row[c] = 0;
+	row[TpCol] = 1   * weight;
+	row[XCol] = e[0] * weight;
+	row[YCol] = e[1] * weight;
+	row[ZCol] = e[2] * weight;
+	rhs = p * weight;
 	for (int c = FirstPhase; c<=LastCol; c++)
-	    if (c == col) A[row][c] = v * weight;
-		else          A[row][c] = nonv * weight;
+	    if (c == col) row[c] = v * weight;
+		else          row[c] = nonv * weight;
+}
+
+
+template <int Channels>
+bool GpsEquations<Channels>::AppendAmbiguity(int sat, double value, double weight)
+// Constrain a satellite's phase ambiguity to a known (fixed) value
+{
+	int col = SatelliteToColumn[sat];
+	debug(2, "GpsEquations::AppendAmbiguity sat=%d col=%d value=%.0f weight=%g\n", sat, col, value, weight);
+	if (col == -1) return Error("AppendAmbiguity - sat %d has no phase variable\n", sat);
+	int row = AddRow();
+	A[row][col] = weight;
+	B[row] = value * weight;
 
 	return OK;
 }
 
 
-bool GpsEquations::NewPosition()
+template <int Channels>
+bool GpsEquations<Channels>::NewPosition()
 {
 	debug("NewPosition  LastRow=%d  LastCol=%d\n", LastRow, LastCol);
 	if (LastRow == -1)
@@ -164,7 +212,8 @@ bool GpsEquations::NewPosition()
 	return OK;
 }
 
-bool GpsEquations::NewEpoch()
+template <int Channels>
+bool GpsEquations<Channels>::NewEpoch()
 {
 	debug("GpsEquations::NewEpoch  LastRow=%d \n", LastRow);
 	if (LastRow == -1)
@@ -179,7 +228,8 @@ bool GpsEquations::NewEpoch()
 }
 
 
-bool GpsEquations::AddPhase(int sat)
+template <int Channels>
+bool GpsEquations<Channels>::AddPhase(int sat)
 {
 	// If we are already tracking the satellite, then NOP
 	if (SatelliteToColumn[sat] != -1) return OK;
@@ -194,7 +244,8 @@ bool GpsEquations::AddPhase(int sat)
 }
 
 
-bool GpsEquations::DropPhase(int sat)
+template <int Channels>
+bool GpsEquations<Channels>::DropPhase(int sat)
 {
 	// if already dropped, then NOP
 	int col = SatelliteToColumn[sat];
@@ -211,7 +262,8 @@ bool GpsEquations::DropPhase(int sat)
 	return OK;
 }
 
-bool GpsEquations::DeletePhase(int sat)
+template <int Channels>
+bool GpsEquations<Channels>::DeletePhase(int sat)
 {
 	// Drop the Satellite phase variable.
 	//   Redo the mapping to match the DeleteCol operation.
@@ -228,7 +280,8 @@ bool GpsEquations::DeletePhase(int sat)
 }
 
 
-bool GpsEquations::ChangeReference(int OldRef, int NewRef)
+template <int Channels>
+bool GpsEquations<Channels>::ChangeReference(int OldRef, int NewRef)
 {
 	// Make sure we are changing to a valid satellite
 	int RefCol = SatelliteToColumn[NewRef];
@@ -255,7 +308,8 @@ bool GpsEquations::ChangeReference(int OldRef, int NewRef)
 
 
 
-int GpsEquations::LastSatellite()
+template <int Channels>
+int GpsEquations<Channels>::LastSatellite()
 // Note: we could keep track of ColumnToSatellite instead of scanning.
 {
 	for (int s=0; s<MaxSats; s++)
@@ -266,39 +320,45 @@ int GpsEquations::LastSatellite()
 
 
 
-double GpsEquations::GetAmbiguity(int sat)
+template <int Channels>
+double GpsEquations<Channels>::GetAmbiguity(int sat)
 {
 	int col = SatelliteToColumn[sat];
 	if (col == -1) return 0;
 	else           return X[col];
 }
 
-Position GpsEquations::GetOffset()
+template <int Channels>
+Position GpsEquations<Channels>::GetOffset()
 {
 	return Position(X[XCol], X[YCol], X[ZCol]);
 }
 
-double GpsEquations::GetTc()
+template <int Channels>
+double GpsEquations<Channels>::GetTc()
 {
 	return X[TcCol];
 }
 
-double GpsEquations::GetTp()
+template <int Channels>
+double GpsEquations<Channels>::GetTp()
 {
 	return X[TpCol];
 }
 
 
-bool GpsEquations::PhaseDefined(int sat)
+template <int Channels>
+bool GpsEquations<Channels>::PhaseDefined(int sat)
 {
 	return SatelliteToColumn[sat] != -1;
 }
 
 
-void GpsEquations::Reset()
+template <int Channels>
+void GpsEquations<Channels>::Reset()
 {
 	debug("GpsEquations::Reset\n");
-	LinearEquations::Reset();
+	Equations::Reset();
 	LastCol = FirstPhase-1;
 	for (int s=0; s<MaxSats; s++)
 		SatelliteToColumn[s] = -1;
@@ -309,17 +369,68 @@ void GpsEquations::Reset()
 
 
 
-GpsEquations& GpsEquations::operator=(GpsEquations& src)
+template <int Channels>
+GpsEquations<Channels>& GpsEquations<Channels>::operator=(GpsEquations& src)
+{
+	*(Equations*)this = src;
+	for (int s=0; s<MaxSats; s++)
+		SatelliteToColumn[s] = src.SatelliteToColumn[s];
+
+	return *this;
+}
+
+template <int Channels>
+GpsEquations<Channels>::GpsEquations(GpsEquations& src)
+: GpsEquationsBase(), Equations(src)
 {
-	*(LinearEquations*)this = src;
 	for (int s=0; s<MaxSats; s++)
 		SatelliteToColumn[s] = src.SatelliteToColumn[s];
+}
+
+
+
+template <int Channels>
+GpsEquationsBase& GpsEquations<Channels>::CopyFrom(GpsEquationsBase& src)
+// Copy equations which may be a different size.
+{
+	switch (src.GetChannels()) {
+	case 8:   return Assign((GpsEquations<8>&)src);
+	case 12:  return Assign((GpsEquations<12>&)src);
+	case 24:  return Assign((GpsEquations<24>&)src);
+	case 48:  return Assign((GpsEquations<48>&)src);
+	}
 
+	Error("GpsEquations::CopyFrom - no equations with %d channels\n", src.GetChannels());
 	return *this;
 }
 
-GpsEquations::GpsEquations(GpsEquations& src)
+
+template class GpsEquations<8>;
+template class GpsEquations<12>;
+template class GpsEquations<24>;
+template class GpsEquations<48>;
+
+
+
+int GpsEquationsSize(int channels)
+// The size of the smallest equations with room for the given number of channels
 {
-	*this = src;
+	for (int i=0; i<NrEquationSizes; i++)
+		if (channels <= EquationChannels[i])
+			return EquationChannels[i];
+	return -1;
 }
 
+
+GpsEquationsBase* NewGpsEquations(int channels)
+{
+	switch (GpsEquationsSize(channels)) {
+	case 8:   return new GpsEquations<8>;
+	case 12:  return new GpsEquations<12>;
+	case 24:  return new GpsEquations<24>;
+	case 48:  return new GpsEquations<48>;
+	}
+
+	Error("NewGpsEquations - can't handle %d channels\n", channels);
+	return NULL;
+}
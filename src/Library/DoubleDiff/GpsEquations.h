@@ -23,25 +23,115 @@
 #include "Observations.h"
 
 
-class GpsEquations: public LinearEquations
+////////////////////////////////////////////////////////////////////////
+//
+// GpsEquationsBase is the interface to the gps equations, whatever their size.
+//   GpsEquations<Channels> has room for the given number of satellites,
+//   and NewGpsEquations() picks the smallest one which fits.
+//
+////////////////////////////////////////////////////////////////////////
+
+class GpsEquationsBase
+{
+public:
+	static const int TcCol=0, TpCol=1, XCol=2, YCol=3, ZCol=4, FirstPhase=5;
+
+	virtual bool AppendCode(Triple& e, double b, double weight) = 0;
+	virtual bool AppendPhase(Triple& e, double p, int sat, double SatVal, double NonsatVal, 
+		double weight) = 0;
+	virtual void CodeRow(Triple& e, double b, double weight, double* row, double& rhs) = 0;
+	virtual void PhaseRow(Triple& e, double p, int sat, double SatVal, double NonsatVal,
+		double weight, double* row, double& rhs) = 0;
+	virtual bool AppendAmbiguity(int sat, double value, double weight) = 0;
+
+	virtual bool SolvePosition(Position& pos, double& cep, double& fit) = 0;
+	virtual bool NewPosition() = 0;
+	virtual bool NewEpoch() = 0;
+	virtual void Reset() = 0;
+	virtual bool Downdate(int rows, double D[][MaxDowndateCols], double* d) = 0;
+	virtual bool Restore() = 0;
+
+	virtual bool ChangeReference(int OldRef, int NewRef) = 0;
+	virtual bool DropPhase(int sat) = 0;
+	virtual bool AddPhase(int sat) = 0;
+	virtual bool DeletePhase(int sat) = 0;
+	virtual bool PhaseDefined(int sat) = 0;
+
+	// Get solution values
+	virtual Position GetOffset() = 0;           // The position offset
+	virtual double GetTc() = 0;
+	virtual double GetTp() = 0;
+	virtual double GetAmbiguity(int sat) = 0;
+	virtual double GetFit() = 0;
+	virtual int GetLastRow() = 0;
+	virtual int GetLastCol() = 0;
+	virtual int GetMaxRows() = 0;
+
+	// The triangular equations themselves. (for saving the position rows)
+	virtual double GetCoefficient(int row, int col) = 0;
+	virtual double GetRhs(int row) = 0;
+	virtual int GetColumn(int sat) = 0;
+
+	// Size of the equations
+	virtual int GetChannels() = 0;
+	virtual GpsEquationsBase* Clone() = 0;
+	virtual GpsEquationsBase& CopyFrom(GpsEquationsBase& src) = 0;
+
+	virtual ~GpsEquationsBase() {}
+};
+
+
+// The sizes which are compiled, smallest first
+static const int NrEquationSizes = 4;
+static const int EquationChannels[NrEquationSizes] = {8, 12, 24, 48};
+
+int GpsEquationsSize(int channels);
+GpsEquationsBase* NewGpsEquations(int channels);
+
+
+
+template <int Channels>
+class GpsEquations: public GpsEquationsBase, public LinearEquations<3*Channels, 3+Channels>
 {
 protected:
+	typedef LinearEquations<3*Channels, 3+Channels> Equations;
+	using Equations::A;
+	using Equations::B;
+	using Equations::X;
+	using Equations::LastRow;
+	using Equations::LastCol;
+	using Equations::TotalR2;
+	using Equations::TotalCount;
+	using Equations::AddRow;
+	using Equations::AddCol;
+	using Equations::DeleteRow;
+	using Equations::DeleteCol;
+	using Equations::Eliminate;
+	using Equations::Solve;
+	using Equations::Trace2;
+	using Equations::Debug;
 
 	// How the columns are assigned
 	int SatelliteToColumn[MaxSats];
 
 public:
-	static const int TcCol=0, TpCol=1, XCol=2, YCol=3, ZCol=4, FirstPhase=5;
 	GpsEquations();
 	bool AppendCode(Triple& e, double b, double weight);
 	bool AppendPhase(Triple& e, double p, int sat, double SatVal, double NonsatVal, 
 		double weight);
+	void CodeRow(Triple& e, double b, double weight, double* row, double& rhs);
+	void PhaseRow(Triple& e, double p, int sat, double SatVal, double NonsatVal,
+		double weight, double* row, double& rhs);
+	bool AppendAmbiguity(int sat, double value, double weight);
 	int LastSatellite();
 
 	bool SolvePosition(Position& pos, double& cep, double& fit);
 	bool NewPosition();
 	bool NewEpoch();
 	void Reset();
+	bool Downdate(int rows, double D[][MaxDowndateCols], double* d)
+		                         {return Equations::Downdate(rows, D, d);}
+	bool Restore()               {return Equations::Restore();}
 
 	bool ChangeReference(int OldRef, int NewRef);
 	bool DropPhase(int sat);
@@ -55,9 +145,31 @@ public:
 	double GetTc();
 	double GetTp();
 	double GetAmbiguity(int sat);
+	double GetFit()              {return Equations::GetFit();}
+	int GetLastRow()             {return LastRow;}
+	int GetLastCol()             {return LastCol;}
+	int GetMaxRows()             {return Equations::MaxRows;}
+
+	double GetCoefficient(int row, int col) {return A[row][col];}
+	double GetRhs(int row)       {return B[row];}
+	int GetColumn(int sat)       {return SatelliteToColumn[sat];}
+
+	int GetChannels()            {return Channels;}
+	GpsEquationsBase* Clone()    {return new GpsEquations(*this);}
+	GpsEquationsBase& CopyFrom(GpsEquationsBase& src);
 
 	GpsEquations(GpsEquations& src);
 	GpsEquations& operator=(GpsEquations& src);
+
+	template <int C>
+	GpsEquations& Assign(GpsEquations<C>& src)
+	{
+		Equations::Assign(src);
+		for (int s=0; s<MaxSats; s++)
+			SatelliteToColumn[s] = src.SatelliteToColumn[s];
+		return *this;
+	}
+	template <int C> friend class GpsEquations;
 };
 
 #endif
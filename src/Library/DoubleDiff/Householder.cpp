@@ -1,2 +1,263 @@
-// Dummy File to act as a placeholder.  All relevant stuff is in the header file
+// Vector kernels for the Householder transformations
+//    Part of kinematic, a collection of utilities for GPS positioning
+//
+// Copyright (C) 2005  John Morris    www.precision-gps.org
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation, version 2.
 
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+
+//////////////////////////////////////////////////////////////////////////////
+//
+// The Householder transforms spend their time scaling rows and adding them
+//   together. These are the kernels which do it, one version for each
+//   instruction set. The best one the cpu supports is picked at startup.
+//
+// Every version does a separate multiply and add, in the same order as
+//   the plain C version, so they all give exactly the same answers.
+//   (a fused multiply-add would round differently)
+//
+//////////////////////////////////////////////////////////////////////////////
+
+#include "Householder.h"
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define X86_KERNELS
+#include <immintrin.h>
+#endif
+
+#if defined(__GNUC__) && defined(__aarch64__)
+#define NEON_KERNELS
+#include <arm_neon.h>
+#endif
+
+
+
+//
+// Plain C. Always available.
+//
+
+static void ScaleC(int n, double s, const double* x, double* y)
+{
+	for (int k=0; k<n; k++)
+		y[k] = s * x[k];
+}
+
+static void AddScaledC(int n, double s, const double* x, double* y)
+{
+	for (int k=0; k<n; k++)
+		y[k] = y[k] + s * x[k];
+}
+
+static void SubScaledC(int n, double s, const double* x, double* y)
+{
+	for (int k=0; k<n; k++)
+		y[k] = y[k] - s * x[k];
+}
+
+static HouseholderKernels CKernels = {"c", ScaleC, AddScaledC, SubScaledC};
+
+
+
+#ifdef X86_KERNELS
+
+//
+// SSE2, two doubles at a time
+//
+
+__attribute__((target("sse2")))
+static void ScaleSse2(int n, double s, const double* x, double* y)
+{
+	__m128d vs = _mm_set1_pd(s);
+	int k = 0;
+	for (; k+2<=n; k+=2)
+		_mm_storeu_pd(y+k, _mm_mul_pd(vs, _mm_loadu_pd(x+k)));
+	for (; k<n; k++)
+		y[k] = s * x[k];
+}
+
+__attribute__((target("sse2")))
+static void AddScaledSse2(int n, double s, const double* x, double* y)
+{
+	__m128d vs = _mm_set1_pd(s);
+	int k = 0;
+	for (; k+2<=n; k+=2)
+		_mm_storeu_pd(y+k, _mm_add_pd(_mm_loadu_pd(y+k), _mm_mul_pd(vs, _mm_loadu_pd(x+k))));
+	for (; k<n; k++)
+		y[k] = y[k] + s * x[k];
+}
+
+__attribute__((target("sse2")))
+static void SubScaledSse2(int n, double s, const double* x, double* y)
+{
+	__m128d vs = _mm_set1_pd(s);
+	int k = 0;
+	for (; k+2<=n; k+=2)
+		_mm_storeu_pd(y+k, _mm_sub_pd(_mm_loadu_pd(y+k), _mm_mul_pd(vs, _mm_loadu_pd(x+k))));
+	for (; k<n; k++)
+		y[k] = y[k] - s * x[k];
+}
+
+static HouseholderKernels Sse2Kernels = {"sse2", ScaleSse2, AddScaledSse2, SubScaledSse2};
+
+
+//
+// AVX2, four doubles at a time.  (Not "fma", so the compiler can't fuse them)
+//
+
+__attribute__((target("avx2")))
+static void ScaleAvx2(int n, double s, const double* x, double* y)
+{
+	__m256d vs = _mm256_set1_pd(s);
+	int k = 0;
+	for (; k+4<=n; k+=4)
+		_mm256_storeu_pd(y+k, _mm256_mul_pd(vs, _mm256_loadu_pd(x+k)));
+	for (; k<n; k++)
+		y[k] = s * x[k];
+}
+
+__attribute__((target("avx2")))
+static void AddScaledAvx2(int n, double s, const double* x, double* y)
+{
+	__m256d vs = _mm256_set1_pd(s);
+	int k = 0;
+	for (; k+4<=n; k+=4)
+		_mm256_storeu_pd(y+k, _mm256_add_pd(_mm256_loadu_pd(y+k),
+		                                    _mm256_mul_pd(vs, _mm256_loadu_pd(x+k))));
+	for (; k<n; k++)
+		y[k] = y[k] + s * x[k];
+}
+
+__attribute__((target("avx2")))
+static void SubScaledAvx2(int n, double s, const double* x, double* y)
+{
+	__m256d vs = _mm256_set1_pd(s);
+	int k = 0;
+	for (; k+4<=n; k+=4)
+		_mm256_storeu_pd(y+k, _mm256_sub_pd(_mm256_loadu_pd(y+k),
+		                                    _mm256_mul_pd(vs, _mm256_loadu_pd(x+k))));
+	for (; k<n; k++)
+		y[k] = y[k] - s * x[k];
+}
+
+static HouseholderKernels Avx2Kernels = {"avx2", ScaleAvx2, AddScaledAvx2, SubScaledAvx2};
+
+#endif // X86_KERNELS
+
+
+
+#ifdef NEON_KERNELS
+
+//
+// NEON, two doubles at a time. (vmul + vadd rather than vfma, to match the C version)
+//
+
+static void ScaleNeon(int n, double s, const double* x, double* y)
+{
+	float64x2_t vs = vdupq_n_f64(s);
+	int k = 0;
+	for (; k+2<=n; k+=2)
+		vst1q_f64(y+k, vmulq_f64(vs, vld1q_f64(x+k)));
+	for (; k<n; k++)
+		y[k] = s * x[k];
+}
+
+static void AddScaledNeon(int n, double s, const double* x, double* y)
+{
+	float64x2_t vs = vdupq_n_f64(s);
+	int k = 0;
+	for (; k+2<=n; k+=2)
+		vst1q_f64(y+k, vaddq_f64(vld1q_f64(y+k), vmulq_f64(vs, vld1q_f64(x+k))));
+	for (; k<n; k++)
+		y[k] = y[k] + s * x[k];
+}
+
+static void SubScaledNeon(int n, double s, const double* x, double* y)
+{
+	float64x2_t vs = vdupq_n_f64(s);
+	int k = 0;
+	for (; k+2<=n; k+=2)
+		vst1q_f64(y+k, vsubq_f64(vld1q_f64(y+k), vmulq_f64(vs, vld1q_f64(x+k))));
+	for (; k<n; k++)
+		y[k] = y[k] - s * x[k];
+}
+
+static HouseholderKernels NeonKernels = {"neon", ScaleNeon, AddScaledNeon, SubScaledNeon};
+
+#endif // NEON_KERNELS
+
+
+
+static bool Supported(HouseholderKernels* k)
+{
+	if (k == &CKernels) return true;
+#ifdef X86_KERNELS
+	if (k == &Sse2Kernels) return __builtin_cpu_supports("sse2");
+	if (k == &Avx2Kernels) return __builtin_cpu_supports("avx2");
+#endif
+#ifdef NEON_KERNELS
+	if (k == &NeonKernels) return true;
+#endif
+	return false;
+}
+
+
+// All the kernels, best first
+static HouseholderKernels* AllKernels[] = {
+#ifdef X86_KERNELS
+	&Avx2Kernels, &Sse2Kernels,
+#endif
+#ifdef NEON_KERNELS
+	&NeonKernels,
+#endif
+	&CKernels
+};
+static const int NrKernels = sizeof(AllKernels)/sizeof(AllKernels[0]);
+
+// The plain C kernels until the first set of equations picks the best
+//   ones (see DefaultKernels). Not at startup, which is before debugging
+//   is set up, and not on first use, which may be in several threads.
+HouseholderKernels* Kernels = &CKernels;
+static bool Chosen = false;
+
+
+bool SelectKernels(const char* name)
+////////////////////////////////////////////////////////////////////
+// Use the named kernels ("c", "sse2", "avx2", "neon"),
+//   or the best ones the cpu supports if name is NULL.
+////////////////////////////////////////////////////////////////////
+{
+	for (int i=0; i<NrKernels; i++) {
+		if (name != NULL && strcmp(name, AllKernels[i]->Name) != 0) continue;
+		if (!Supported(AllKernels[i])) continue;
+		Kernels = AllKernels[i];
+		Chosen = true;
+		debug("SelectKernels: using %s\n", Kernels->Name);
+		return OK;
+	}
+
+	return Error("Householder kernels '%s' aren't available on this cpu\n", name);
+}
+
+
+void DefaultKernels()
+// The best kernels for the cpu, unless some have been selected already
+{
+	if (!Chosen)
+		SelectKernels(NULL);
+}
+
+
+// Skip the zeros when factoring.  (see BenchSolve -dense and -slack)
+bool SparseFactor = true;
+int32 GroupSlack = 8;
@@ -0,0 +1,281 @@
+// Lambda resolves the integer phase ambiguities
+//    Part of Kinematic, a utility for GPS positioning
+//
+// Copyright (C) 2006  John Morris    www.precision-gps.org
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation, version 2.
+
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+
+//////////////////////////////////////////////////////////////////////////////
+//
+// Notation follows de Jonge and Tiberius, "The LAMBDA method for integer
+//   ambiguity estimation: implementation aspects" (1996).
+//
+//   Q = transpose(L) * D * L     L unit lower triangular, D diagonal
+//   z = transpose(Z) * a         Z integer with an integer inverse
+//
+// Rather than keep Z, we keep its inverse Zi, since the fixed ambiguities
+//   are transpose(Zi) * z. The decorrelated float values z are updated along
+//   with each transform, so Z itself is never needed.
+//
+//////////////////////////////////////////////////////////////////////////////
+
+#include "Lambda.h"
+
+
+static const double SingularPivot = 1e-9;   // smaller diagonal means an unknown ambiguity
+static const int32 NodesPerClockCheck = 256;
+
+
+Lambda::Lambda()
+{
+	RatioThreshhold = 3;
+	MinAmbiguities = 5;
+	MaxNodes = 200000;
+	Budget = 50 * NsecPerSec / 1000;
+
+	Searches = Fixes = Timeouts = 0;
+	MaxSearchTime = 0;
+}
+
+
+inline static double Sign(double x) {return (x <= 0)? -1: 1;}
+
+
+static void Gauss(int n, double L[][MaxAmbiguities], double Zi[][MaxAmbiguities], double* z, int i, int j)
+// Integer Gauss transform, reducing L[i][j] to at most 1/2
+{
+	double mu = round(L[i][j]);
+	if (mu == 0) return;
+
+	for (int k=i; k<n; k++)
+		L[k][j] -= mu * L[k][i];
+	for (int k=0; k<n; k++)
+		Zi[i][k] += mu * Zi[j][k];
+	z[j] -= mu * z[i];
+}
+
+
+static void Permute(int n, double L[][MaxAmbiguities], double* D, double Zi[][MaxAmbiguities],
+					double* z, int j, double del)
+// Swap ambiguities j and j+1, where del is the new D[j+1]
+{
+	double eta = D[j] / del;
+	double lam = D[j+1] * L[j+1][j] / del;
+	D[j] = eta * D[j+1];
+	D[j+1] = del;
+
+	for (int k=0; k<j; k++) {
+		double a0 = L[j][k], a1 = L[j+1][k];
+		L[j][k] = -L[j+1][j] * a0 + a1;
+		L[j+1][k] = eta * a0 + lam * a1;
+	}
+	L[j+1][j] = lam;
+	for (int k=j+2; k<n; k++)
+		Swap(L[k][j], L[k][j+1]);
+
+	for (int k=0; k<n; k++)
+		Swap(Zi[j][k], Zi[j+1][k]);
+	Swap(z[j], z[j+1]);
+}
+
+
+static void Reduce(int n, double L[][MaxAmbiguities], double* D, double Zi[][MaxAmbiguities], double* z)
+// Decorrelate the ambiguities, putting the smallest variances last
+{
+	int j = n-2, k = n-2;
+	while (j >= 0) {
+		if (j <= k)
+			for (int i=j+1; i<n; i++)
+				Gauss(n, L, Zi, z, i, j);
+
+		double del = D[j] + L[j+1][j] * L[j+1][j] * D[j+1];
+		if (del + 1e-6 < D[j+1]) {
+			Permute(n, L, D, Zi, z, j, del);
+			k = j; j = n-2;
+		}
+		else
+			j--;
+	}
+}
+
+
+
+Lambda::Status Lambda::Resolve(int n, double R[][MaxAmbiguities], const double* a, double* fixed, double& ratio)
+/////////////////////////////////////////////////////////////////////////////////
+// Find the integer ambiguities.
+//   R - upper triangular square root of the ambiguities' information matrix
+//   a - the float ambiguities
+//   fixed - the integer ambiguities, if FIXED
+//   ratio - how much worse the second best candidate is than the best
+/////////////////////////////////////////////////////////////////////////////////
+{
+	debug("Lambda::Resolve  n=%d\n", n);
+	ratio = 0;
+	if (n < MinAmbiguities) return REJECTED;
+	assert(n <= MaxAmbiguities);
+
+	Searches++;
+	Time start = GetCurrentTime();
+	Time deadline = (Budget > 0)? start + Budget: MaxTime;
+
+	// Invert R. Its diagonal must be solid.
+	static const int N = MaxAmbiguities;
+	double U[N][N];
+	for (int i=0; i<n; i++)
+		if (abs(R[i][i]) < SingularPivot) return SINGULAR;
+	for (int j=0; j<n; j++) {
+		U[j][j] = 1 / R[j][j];
+		for (int i=j-1; i>=0; i--) {
+			double sum = 0;
+			for (int k=i+1; k<=j; k++)
+				sum += R[i][k] * U[k][j];
+			U[i][j] = -sum / R[i][i];
+		}
+	}
+
+	// Q = U * transpose(U), so L is U's columns scaled by their diagonal, and D is the diagonal squared
+	double L[N][N], D[N], Zi[N][N], z[N];
+	for (int i=0; i<n; i++) {
+		D[i] = U[i][i] * U[i][i];
+		for (int j=0; j<n; j++) {
+			L[i][j] = (j <= i)? U[j][i] / U[i][i]: 0;
+			Zi[i][j] = (i == j)? 1: 0;
+		}
+		z[i] = a[i];
+	}
+
+	// Decorrelate, then look for the two best candidates
+	Reduce(n, L, D, Zi, z);
+	double zn[2][N], s[2];
+	Status status = Search(n, L, D, z, zn, s, deadline);
+
+	Time elapsed = GetCurrentTime() - start;
+	MaxSearchTime = max(MaxSearchTime, elapsed);
+	if (status == TIMEOUT) {
+		Timeouts++;
+		debug("Lambda::Resolve - timed out after %.3f msec\n", S(elapsed)*1000);
+		return status;
+	}
+
+	// Is the best candidate clearly better than the next one?
+	ratio = (s[0] > 0)? s[1] / s[0]: 9999;
+	debug("Lambda::Resolve  best=%.3f  second=%.3f  ratio=%.1f  %.3f msec\n",
+		s[0], s[1], ratio, S(elapsed)*1000);
+	if (ratio < RatioThreshhold)
+		return REJECTED;
+
+	// Transform the best candidate back to the original ambiguities
+	for (int c=0; c<n; c++) {
+		double sum = 0;
+		for (int r=0; r<n; r++)
+			sum += Zi[r][c] * zn[0][r];
+		fixed[c] = round(sum);
+	}
+
+	Fixes++;
+	return FIXED;
+}
+
+
+
+Lambda::Status Lambda::Search(int n, double L[][MaxAmbiguities], double* D, double* zs,
+							  double zn[2][MaxAmbiguities], double* s, Time deadline)
+///////////////////////////////////////////////////////////////////////////
+// Depth first search for the two integer vectors closest to zs,
+//   going from the last (most precise) ambiguity to the first.
+//   Returns the candidates in zn and their squared distances in s, best first,
+//   or TIMEOUT if it ran out of nodes or time first.
+///////////////////////////////////////////////////////////////////////////
+{
+	static const int N = MaxAmbiguities;
+	double S[N][N], dist[N], zb[N], z[N], step[N];
+	for (int i=0; i<n; i++)
+		for (int j=0; j<n; j++)
+			S[i][j] = 0;
+
+	int found = 0, worst = 0;
+	double maxdist = 1e99;
+
+	int k = n-1;
+	dist[k] = 0;
+	zb[k] = zs[k];
+	z[k] = round(zb[k]);
+	double y = zb[k] - z[k];
+	step[k] = Sign(y);
+
+	for (int32 nodes=0; ; nodes++) {
+
+		// Don't let a hard epoch hold things up
+		if (nodes >= MaxNodes) return TIMEOUT;
+		if (nodes % NodesPerClockCheck == 0 && GetCurrentTime() > deadline) return TIMEOUT;
+
+		double newdist = dist[k] + y*y / D[k];
+		if (newdist < maxdist) {
+
+			// Move down a level, centering on the conditional estimate
+			if (k != 0) {
+				dist[--k] = newdist;
+				for (int i=0; i<=k; i++)
+					S[k][i] = S[k+1][i] + (z[k+1] - zb[k+1]) * L[k+1][i];
+				zb[k] = zs[k] + S[k][k];
+				z[k] = round(zb[k]);
+				y = zb[k] - z[k];
+				step[k] = Sign(y);
+				continue;
+			}
+
+			// At the bottom, we have a candidate. Keep the two best.
+			if (found < 2) {
+				if (found == 0 || newdist > s[worst]) worst = found;
+				for (int i=0; i<n; i++)
+					zn[found][i] = z[i];
+				s[found++] = newdist;
+			}
+			else {
+				if (newdist < s[worst]) {
+					for (int i=0; i<n; i++)
+						zn[worst][i] = z[i];
+					s[worst] = newdist;
+					worst = (s[0] < s[1])? 1: 0;
+				}
+			}
+			if (found == 2)
+				maxdist = s[worst];
+
+			// Try the next integer at this level, zig-zagging outward
+			z[0] += step[0];
+			y = zb[0] - z[0];
+			step[0] = -step[0] - Sign(step[0]);
+		}
+
+		else {
+			// Nothing more at this level. Move back up.
+			if (k == n-1) break;
+			k++;
+			z[k] += step[k];
+			y = zb[k] - z[k];
+			step[k] = -step[k] - Sign(step[k]);
+		}
+	}
+
+	// Best first
+	if (s[1] < s[0]) {
+		Swap(s[0], s[1]);
+		for (int i=0; i<n; i++)
+			Swap(zn[0][i], zn[1][i]);
+	}
+
+	return FIXED;
+}
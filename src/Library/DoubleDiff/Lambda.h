@@ -0,0 +1,70 @@
+#ifndef LAMBDA_INCLUDED
+#define LAMBDA_INCLUDED
+// Part of Kinematic, a utility for GPS positioning
+//
+// Copyright (C) 2006  John Morris    www.precision-gps.org
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation, version 2.
+
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+
+
+#include "Util.h"
+
+
+//////////////////////////////////////////////////////////////////////////////
+//
+// Lambda finds the integer values of the phase ambiguities.
+//   (Teunissen's "Least-squares AMBiguity Decorrelation Adjustment")
+//
+// The float ambiguities come with the upper triangular block of the solved
+//   gps equations which belongs to them. That block is the square root of
+//   their information matrix, so their covariance is inverse(R)*transpose(inverse(R)),
+//   and it can be split into transpose(L)*D*L without ever forming the covariance.
+//
+// The ambiguities are then decorrelated with integer Gauss transforms and
+//   permutations, and a depth first search finds the two closest integer vectors.
+//   The best one is accepted if the second best is worse by at least the ratio.
+//
+// The search is bounded by a number of nodes and a wall clock budget,
+//   so a poorly conditioned epoch can't stall real time processing.
+//
+//////////////////////////////////////////////////////////////////////////////
+
+static const int MaxAmbiguities = 48;
+
+class Lambda
+{
+public:
+	// Tunables
+	double RatioThreshhold;   // second best must be this much worse than the best
+	int32 MinAmbiguities;     // don't try to fix fewer ambiguities than this
+	int32 MaxNodes;           // most nodes to visit in one search
+	Time Budget;              // most wall clock time for one search, 0 for no limit
+
+	enum Status {FIXED, REJECTED, TIMEOUT, SINGULAR};
+
+	// Statistics over all the searches
+	int32 Searches, Fixes, Timeouts;
+	Time MaxSearchTime;
+
+	Lambda();
+	Status Resolve(int n, double R[][MaxAmbiguities], const double* a, double* fixed, double& ratio);
+
+private:
+	Status Search(int n, double L[][MaxAmbiguities], double* D, double* z, double zn[2][MaxAmbiguities],
+		          double* s, Time deadline);
+};
+
+
+#endif // LAMBDA_INCLUDED
@@ -20,26 +20,32 @@
 #include "LinearEquation.h"
 
 
-LinearEquations::LinearEquations(void)
+template <int Rows, int Cols>
+LinearEquations<Rows,Cols>::LinearEquations(void)
 {
+	// Pick the row kernels before any threads share them
+	DefaultKernels();
 	Reset();
 }
 
-LinearEquations::~LinearEquations(void)
+template <int Rows, int Cols>
+LinearEquations<Rows,Cols>::~LinearEquations(void)
 {
 }
 
 
-void LinearEquations::Reset()
+template <int Rows, int Cols>
+void LinearEquations<Rows,Cols>::Reset()
 {
 	debug(3,"LinearEquations:: Reset\n");
 	LastCol = -1;
 	LastRow = -1;
-	TotalR2 = R2 = 0;
-	TotalCount = Count = 0;
+	TotalR2 = R2 = SolvedR2 = 0;
+	TotalCount = Count = SolvedCount = 0;
 }
 
-int LinearEquations::AddRow()
+template <int Rows, int Cols>
+int LinearEquations<Rows,Cols>::AddRow()
 {
 	debug(2, "LinearEquations::Addrow  LastRow=%d\n", LastRow);
 	LastRow++;
@@ -51,7 +57,8 @@ int LinearEquations::AddRow()
 	return LastRow;
 }
 
-int LinearEquations::AddCol()
+template <int Rows, int Cols>
+int LinearEquations<Rows,Cols>::AddCol()
 {
 	debug(2, "LinearEquations::AddCol  LastCol=%d\n", LastCol);
 	LastCol++;
@@ -63,7 +70,8 @@ int LinearEquations::AddCol()
 	return LastCol;
 }
 
-int LinearEquations::DeleteRow(int row)
+template <int Rows, int Cols>
+int LinearEquations<Rows,Cols>::DeleteRow(int row)
 {
 	debug(2, "LinearEquations::DeleteRow  row=%d  LastRow=%d\n", row, LastRow);
 	assert(row >= 0 && row <= LastRow);
@@ -78,7 +86,8 @@ int LinearEquations::DeleteRow(int row)
 }
 
 
-int LinearEquations::DeleteCol(int col)
+template <int Rows, int Cols>
+int LinearEquations<Rows,Cols>::DeleteCol(int col)
 {
 	debug(2, "LinearEquations::DeleteCol  col=%d  LastCol=%d\n", col, LastCol);
 	assert (col >= 0 && col <= LastCol);
@@ -91,7 +100,8 @@ int LinearEquations::DeleteCol(int col)
 }
 
 
-bool LinearEquations::Eliminate(int row, int col)
+template <int Rows, int Cols>
+bool LinearEquations<Rows,Cols>::Eliminate(int row, int col)
 {
 	debug(2, "LinearEquations::Eliminate row=%d  col=%d LastRow=%d  LastCol=%d\n",
 		                                 row,    col,   LastRow,    LastCol);
@@ -103,7 +113,8 @@ bool LinearEquations::Eliminate(int row, int col)
 
 
 
-bool LinearEquations::Solve()
+template <int Rows, int Cols>
+bool LinearEquations<Rows,Cols>::Solve()
 {
 	Debug("LinearEquations::Solve\n");
 	if (LastRow < LastCol) 
@@ -113,9 +124,16 @@ bool LinearEquations::Solve()
 	TotalCount += Count;  TotalR2 += R2;
 
 	// Do a QR factorization, putting the matrix into upper diagonal form
-	for (int c=0; c<=LastCol; c++)
-		if (ApplyHouseholder(A, c, LastRow, c, LastCol, B, c, c) != OK)
+	//   and taking advantage of the zeros. (most of the matrix)
+	if (SparseFactor) {
+		if (SparseHouseholder(A, LastRow, LastCol, B) != OK)
 			return Error("Can't solve equations");
+	}
+	else {
+		for (int c=0; c<=LastCol; c++)
+			if (ApplyHouseholder(A, c, LastRow, c, LastCol, B, c, c) != OK)
+				return Error("Can't solve equations");
+	}
 
 	// use backsubstitution to solve
 	if (BackSubstitute(A, LastCol, LastCol, B, X) != OK)
@@ -126,6 +144,7 @@ bool LinearEquations::Solve()
 	R2 = 0;
 	for (int r=LastCol+1; r<=LastRow; r++)
 		R2 += B[r]*B[r];
+	SolvedCount = Count;  SolvedR2 = R2;
 
 	// Drop the residuals from the matrix
 	LastRow = LastCol;
@@ -139,7 +158,103 @@ bool LinearEquations::Solve()
 	return OK;
 }
 
-double LinearEquations::GetFit()
+
+template <int Rows, int Cols>
+bool LinearEquations<Rows,Cols>::Downdate(int rows, double D[][MaxDowndateCols], double* d)
+///////////////////////////////////////////////////////////////////////////////
+// Remove equations from a solved system without factoring it again.
+//   Only the solution (X, R2, Count) changes. The triangular factor is left 
+//   alone, so Restore() can recover the full solution.
+//
+// Let W = D * inverse(A), r = d - D*X (the residuals of the removed rows),
+//   and M = I - W*transpose(W). Then the solution without the rows is
+//       X' = X - inverse(A) * transpose(W) * inverse(M) * r
+//   and the sum of squared residuals drops by transpose(r) * inverse(M) * r.
+//
+// A row with a zero pivot in M is the only equation for some variable 
+//   (eg. the phase of a newly added satellite). It fits exactly, so removing
+//   it along with its variable doesn't change the rest of the solution.
+///////////////////////////////////////////////////////////////////////////////
+{
+	debug(2, "LinearEquations::Downdate rows=%d  LastRow=%d  LastCol=%d\n", rows, LastRow, LastCol);
+	assert(rows <= MaxDowndate);
+	if (LastRow != LastCol)
+		return Error("LinearEquations::Downdate - equations haven't been solved\n");
+
+	// Calculate W and the residuals for each of the rows
+	double W[MaxDowndate][Cols], r[MaxDowndate];
+	for (int i=0; i<rows; i++) {
+		ForwardSubstitute(A, LastCol, D[i], W[i]);
+		r[i] = d[i];
+		for (int c=0; c<=LastCol; c++)
+			r[i] -= D[i][c] * X[c];
+	}
+
+	// Cholesky factor M = L * transpose(L), skipping the rows which fit exactly
+	double L[MaxDowndate][MaxDowndate];
+	bool Keep[MaxDowndate];
+	for (int i=0; i<rows; i++) {
+		for (int j=0; j<=i; j++) {
+			if (j < i && !Keep[j]) continue;
+			double sum = (i == j)? 1: 0;
+			for (int c=0; c<=LastCol; c++)
+				sum -= W[i][c] * W[j][c];
+			for (int k=0; k<j; k++)
+				if (Keep[k]) sum -= L[i][k] * L[j][k];
+			if (j < i)
+				L[i][j] = sum / L[j][j];
+			else if ( (Keep[i] = (sum > DowndateEps)) )
+				L[i][i] = sqrt(sum);
+		}
+	}
+
+	// Solve M * u = r, removing the rows' contribution to the residuals as we go
+	double u[MaxDowndate];
+	for (int i=0; i<rows; i++) {
+		if (!Keep[i]) continue;
+		u[i] = r[i];
+		for (int k=0; k<i; k++)
+			if (Keep[k]) u[i] -= L[i][k] * u[k];
+		u[i] = u[i] / L[i][i];
+		R2 -= u[i] * u[i];
+		Count--;
+	}
+	for (int i=rows-1; i>=0; i--) {
+		if (!Keep[i]) continue;
+		for (int k=i+1; k<rows; k++)
+			if (Keep[k]) u[i] -= L[k][i] * u[k];
+		u[i] = u[i] / L[i][i];
+	}
+	if (R2 < 0) R2 = 0;
+
+	// Adjust the solution by inverse(A) * transpose(W) * u
+	double v[Cols], dX[Cols];
+	for (int c=0; c<=LastCol; c++) {
+		v[c] = 0;
+		for (int i=0; i<rows; i++)
+			if (Keep[i]) v[c] += W[i][c] * u[i];
+	}
+	if (BackSubstitute(A, LastCol, LastCol, v, dX) != OK)
+		return Error("Can't downdate equations\n");
+	for (int c=0; c<=LastCol; c++)
+		X[c] -= dX[c];
+
+	debug(2, "LinearEquations::Downdate  Count=%d  resid**2=%.3f\n", Count, R2);
+	return OK;
+}
+
+
+template <int Rows, int Cols>
+bool LinearEquations<Rows,Cols>::Restore()
+// Discard any downdates, returning to the solution of the factored equations
+{
+	Count = SolvedCount;  R2 = SolvedR2;
+	return BackSubstitute(A, LastCol, LastCol, B, X);
+}
+
+
+template <int Rows, int Cols>
+double LinearEquations<Rows,Cols>::GetFit()
 {
 	// See how the current residuals compare against the previous ones
 	//   This ratio is useful for detecting errors in the data.
@@ -149,7 +264,8 @@ double LinearEquations::GetFit()
 	return (R2/Count) / (TotalR2/TotalCount);
 	}
 
-double LinearEquations::Trace2()
+template <int Rows, int Cols>
+double LinearEquations<Rows,Cols>::Trace2()
 // Takes the trace of the covariance matrix.
 {
 	if (LastRow < LastCol)
@@ -162,13 +278,15 @@ double LinearEquations::Trace2()
 }
 
 
-void LinearEquations::Debug(const char* s)
+template <int Rows, int Cols>
+void LinearEquations<Rows,Cols>::Debug(const char* s)
 {
 	debug(2,"Linear Equations%s\n", s);
 	DebugArray(A, 0, LastRow, 0, LastCol, B, s);
 }
 
-LinearEquations& LinearEquations::operator=(LinearEquations& src)
+template <int Rows, int Cols>
+LinearEquations<Rows,Cols>& LinearEquations<Rows,Cols>::operator=(LinearEquations& src)
 {
 	LastRow = src.LastRow;
 	LastCol = src.LastCol;
@@ -177,17 +295,28 @@ LinearEquations& LinearEquations::operator=(LinearEquations& src)
 		for (int c=0; c<=LastCol; c++)
 			A[r][c] = src.A[r][c];
 	}
+	for (int c=0; c<=LastCol; c++)
+		X[c] = src.X[c];
 
 	TotalR2 = src.TotalR2;
 	TotalCount = src.TotalCount;
 	R2 = src.R2;
 	Count = src.Count;
+	SolvedR2 = src.SolvedR2;
+	SolvedCount = src.SolvedCount;
 	return *this;
 }
 
-LinearEquations::LinearEquations(LinearEquations& src)
+template <int Rows, int Cols>
+LinearEquations<Rows,Cols>::LinearEquations(LinearEquations& src)
 {
 	*this = src;
 }
 
 
+
+// The sizes used by GpsEquations<Channels>, ie. <3*Channels, 3+Channels>
+template class LinearEquations<24,11>;
+template class LinearEquations<36,15>;
+template class LinearEquations<72,27>;
+template class LinearEquations<144,51>;
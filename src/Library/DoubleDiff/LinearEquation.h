@@ -24,15 +24,32 @@
 #include "Householder.h"
 
 
-static const int MaxRows = 3*MaxChannels;
-static const int MaxCols = 3+MaxChannels;
+static const double DowndateEps = 1e-9;  // Pivot below which a removed row fits exactly
 
-class LinearEquations  // probably should be a template
+// How many equations can be removed by a single downdate, and how wide they can be.
+//   The width is enough for the largest GpsEquations.
+static const int MaxDowndate = 4;
+static const int MaxDowndateCols = 3+48;
+
+
+// The dimensions are template parameters so the compiler knows the loop strides
+//   and copies only carry the storage the equations actually need.
+//   Instantiated (in LinearEquation.cpp) for the sizes used by GpsEquations.
+template <int Rows, int Cols>
+class LinearEquations
 {
 public:
-	double A[MaxRows][MaxCols], B[MaxRows], X[MaxCols];
+	static const int MaxRows = Rows;
+	static const int MaxCols = Cols;
+
+	// Rows are padded to a multiple of 4 doubles (32 bytes) for the vector kernels
+	static const int Stride = (Cols+3)/4*4;
+
+	double A[Rows][Stride], B[Rows], X[Cols];
 	double R2, TotalR2;
 	int Count, TotalCount;
+	double SolvedR2;       // Residuals of the factored equations, before any downdates
+	int SolvedCount;
 
 	int LastRow;
 	int LastCol;
@@ -51,10 +68,36 @@ public:
 
 	bool Eliminate(int col, int row);
 	bool Solve();
+	bool Downdate(int rows, double D[][MaxDowndateCols], double* d);
+	bool Restore();
 	double GetFit();
 
 	LinearEquations& operator=(LinearEquations& src);
 	LinearEquations(LinearEquations& src);
+
+	// Copy equations of a different size. They must fit.
+	template <int R, int C>
+	LinearEquations& Assign(LinearEquations<R,C>& src)
+	{
+		assert(src.LastRow < Rows && src.LastCol < Cols);
+		LastRow = src.LastRow;
+		LastCol = src.LastCol;
+		for (int r=0; r<=LastRow; r++) {
+			B[r] = src.B[r];
+			for (int c=0; c<=LastCol; c++)
+				A[r][c] = src.A[r][c];
+		}
+		for (int c=0; c<=LastCol; c++)
+			X[c] = src.X[c];
+
+		TotalR2 = src.TotalR2;
+		TotalCount = src.TotalCount;
+		R2 = src.R2;
+		Count = src.Count;
+		SolvedR2 = src.SolvedR2;
+		SolvedCount = src.SolvedCount;
+		return *this;
+	}
 };
 
 #endif
@@ -0,0 +1,224 @@
+// MultiRover processes several rovers against one base
+//    Part of Kinematic, a utility for GPS positioning
+//
+// Copyright (C) 2006  John Morris    www.precision-gps.org
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation, version 2.
+
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+
+#include "MultiRover.h"
+
+
+
+//////////////////////////////////////////////////////////////////////////
+//
+// RoverLane runs one rover's DoubleDiff over the shared base epochs.
+//
+//////////////////////////////////////////////////////////////////////////
+
+class RoverLane : public Thread
+{
+public:
+	bool ErrCode;
+	int32 Positions;
+
+	RoverLane(MultiRover& multi, int lane, DoubleDiff& dbl, RoverOutput& out);
+	inline bool GetError() {return ErrCode;}
+
+protected:
+	void Run();
+
+	MultiRover& Multi;
+	int Index;
+	DoubleDiff& Dbl;
+	RoverOutput& Out;
+};
+
+
+RoverLane::RoverLane(MultiRover& multi, int lane, DoubleDiff& dbl, RoverOutput& out)
+: Multi(multi), Index(lane), Dbl(dbl), Out(out)
+{
+	ErrCode = OK;
+	Positions = 0;
+}
+
+
+void RoverLane::Run()
+{
+	for (int32 epoch=0; ; epoch++) {
+
+		// Wait for the base epoch. None means the base is finished.
+		BaseEpoch* b = Multi.TakeEpoch(Index, epoch);
+		if (b == NULL) break;
+
+		// Solve. The rover running out of data is the normal way to finish.
+		Time t; Position pos; double cep, fit; bool common;
+		bool ok = Dbl.NextPosition(*b, common, t, pos, cep, fit);
+		Multi.ReleaseEpoch(Index, epoch);
+		if (ok != OK) break;
+
+		if (!common) continue;
+		if (Out.Write(Dbl, t, pos, cep, fit) != OK) {ErrCode = Error(); break;}
+		Positions++;
+	}
+
+	Multi.Finished(Index);
+}
+
+
+
+
+MultiRover::MultiRover(Ephemerides& eph, RawReceiver& base)
+: Eph(eph), Base(base)
+{
+	NrRovers = 0;
+	Ring = new BaseEpoch[RingSize];
+	NrProduced = 0;
+	BaseDone = false;
+	End = MaxTime;
+}
+
+
+bool MultiRover::AddRover(DoubleDiff& dbl, RoverOutput& out)
+{
+	if (NrRovers >= MaxRovers)
+		return Error("MultiRover: no more than %d rovers\n", MaxRovers);
+
+	Lane[NrRovers] = new RoverLane(*this, NrRovers, dbl, out);
+	NrReleased[NrRovers] = 0;
+	LaneDone[NrRovers] = false;
+	NrRovers++;
+
+	return OK;
+}
+
+
+
+bool MultiRover::Run()
+///////////////////////////////////////////////////////////////////////////
+// Read the base and feed its epochs to the rovers until either the base
+//   or all the rovers run out of data.
+///////////////////////////////////////////////////////////////////////////
+{
+	// Start the rovers
+	bool err = OK;
+	int started;
+	for (started=0; started<NrRovers; started++)
+		if (Lane[started]->Start() != OK) {err = Error(); break;}
+	if (err != OK) {
+		m.Lock(); BaseDone = true; WakeRovers(); m.Unlock();
+		for (int i=0; i<started; i++)
+			Lane[i]->Join();
+		return Error("MultiRover: couldn't start the rovers\n");
+	}
+
+	// Do for each base epoch
+	for (;;) {
+
+		// Wait until the slowest rover is done with the oldest slot
+		m.Lock();
+		while (NrProduced - OldestInUse() >= RingSize)
+			RoomReady.Wait(m);
+		bool AllDone = true;
+		for (int i=0; i<NrRovers; i++)
+			AllDone = AllDone && LaneDone[i];
+		m.Unlock();
+		if (AllDone) break;
+
+		// Read the base and figure out the satellites. No rover is using the slot.
+		if (Base.NextEpoch() != OK || Base.GpsTime > End) break;
+		BaseEpoch& b = Ring[NrProduced % RingSize];
+		b.Init(Base, Eph);
+		if (b.GetError() != OK) {err = Error(); break;}
+
+		// Pass it along
+		m.Lock();
+		NrProduced++;
+		WakeRovers();
+		m.Unlock();
+	}
+
+	// Tell the rovers there is no more, and wait for them to finish
+	m.Lock();
+	BaseDone = true;
+	WakeRovers();
+	m.Unlock();
+
+	for (int i=0; i<NrRovers; i++)
+		if (Lane[i]->Join() != OK || Lane[i]->GetError() != OK) err = Error();
+	if (err != OK) return Error("MultiRover: processing failed\n");
+
+	return OK;
+}
+
+
+
+BaseEpoch* MultiRover::TakeEpoch(int lane, int32 epoch)
+// Wait for a base epoch. NULL if there won't be any more.
+{
+	m.Lock();
+	while (epoch >= NrProduced && !BaseDone)
+		EpochReady[lane].Wait(m);
+	BaseEpoch* b = (epoch < NrProduced)? &Ring[epoch % RingSize]: NULL;
+	m.Unlock();
+
+	return b;
+}
+
+
+void MultiRover::ReleaseEpoch(int lane, int32 epoch)
+// The rover is done with the epoch, so its slot may be reused
+{
+	m.Lock();
+	NrReleased[lane] = epoch+1;
+	RoomReady.Wake();
+	m.Unlock();
+}
+
+
+void MultiRover::Finished(int lane)
+// The rover won't be taking any more epochs
+{
+	m.Lock();
+	LaneDone[lane] = true;
+	RoomReady.Wake();
+	m.Unlock();
+}
+
+
+int32 MultiRover::OldestInUse()
+// The oldest epoch any rover may still be looking at. (must hold the lock)
+{
+	int32 oldest = NrProduced;
+	for (int i=0; i<NrRovers; i++)
+		if (!LaneDone[i])
+			oldest = min(oldest, NrReleased[i]);
+	return oldest;
+}
+
+
+void MultiRover::WakeRovers()
+// Wake every waiting rover. (must hold the lock)
+{
+	for (int i=0; i<NrRovers; i++)
+		EpochReady[i].Wake();
+}
+
+
+MultiRover::~MultiRover()
+{
+	for (int i=0; i<NrRovers; i++)
+		delete Lane[i];
+	delete[] Ring;
+}
@@ -0,0 +1,98 @@
+#ifndef MULTIROVER_INCLUDED
+#define MULTIROVER_INCLUDED
+// Part of Kinematic, a utility for GPS positioning
+//
+// Copyright (C) 2006  John Morris    www.precision-gps.org
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation, version 2.
+
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+
+
+#include "Util.h"
+#include "Thread.h"
+#include "DoubleDiff.h"
+
+
+//////////////////////////////////////////////////////////////////////////////
+//
+// MultiRover processes several rovers against a single base.
+//
+// The base is read once. Each of its epochs, along with the satellite
+//   positions, is put in a ring of BaseEpochs shared by all the rovers.
+//
+// Each rover has its own DoubleDiff (so its own Solution and Policy) and
+//   runs in its own thread, taking the base epochs from the ring at its
+//   own pace. The base is only held up when the slowest rover falls a
+//   whole ring behind.
+//
+// The positions go to each rover's RoverOutput, from the rover's thread.
+//
+//////////////////////////////////////////////////////////////////////////////
+
+
+class RoverOutput
+{
+public:
+	virtual bool Write(DoubleDiff& dbl, Time t, Position& pos, double cep, double fit) = 0;
+	virtual ~RoverOutput() {}
+};
+
+
+class RoverLane;
+
+class MultiRover
+{
+public:
+	static const int MaxRovers = 64;
+
+	MultiRover(Ephemerides& eph, RawReceiver& base);
+	bool AddRover(DoubleDiff& dbl, RoverOutput& out);
+	void SetEnd(Time end) {End = end;}   // stop after the base passes this time
+	bool Run();
+	virtual ~MultiRover();
+
+protected:
+	friend class RoverLane;
+	BaseEpoch* TakeEpoch(int lane, int32 epoch);
+	void ReleaseEpoch(int lane, int32 epoch);
+	void Finished(int lane);
+
+private:
+	Ephemerides& Eph;
+	RawReceiver& Base;
+	Time End;
+
+	int NrRovers;
+	RoverLane* Lane[MaxRovers];
+
+	// The base epochs. Epoch i is in Ring[i%RingSize].
+	static const int RingSize = 64;
+	BaseEpoch* Ring;
+	int32 NrProduced;             // epochs put in the ring
+	int32 NrReleased[MaxRovers];  // epochs each rover is done with
+	bool LaneDone[MaxRovers];
+	bool BaseDone;
+
+	// One condition per rover. A Condition wakes whoever is waiting on its
+	//   semaphore, so rovers sharing one could take each other's wakeups.
+	Mutex m;
+	Condition EpochReady[MaxRovers];
+	Condition RoomReady;    // for the base
+
+	int32 OldestInUse();
+	void WakeRovers();
+};
+
+
+#endif // MULTIROVER_INCLUDED
@@ -31,6 +31,7 @@ Observations::Observations()
 		obs[s].ValidPhase = false;
 		obs[s].Slip = true;
 		obs[s].SatPos = 0;
+		obs[s].Elevation = 0;
 	}
 
 }
@@ -40,12 +41,40 @@ Observations::Observations(RawReceiver& base, RawReceiver& rover, Ephemerides& e
 	Init(base, rover, eph);
 }
 
+
+Observations::Observations(Observations& src)
+{
+	*this = src;
+}
+
+
+Observations& Observations::operator=(Observations& src)
+{
+	ErrCode = src.ErrCode;
+	for (int s=0; s<MaxSats; s++)
+		obs[s] = src.obs[s];
+	BasePos = src.BasePos;
+	RoverPos = src.RoverPos;
+	GpsTime = src.GpsTime;
+
+	return *this;
+}
+
 void Observations::Init(RawReceiver& base, RawReceiver& rover, Ephemerides& eph)
 {
 	GpsTime = base.GpsTime;
 	RoverPos = rover.Pos;   // These are approximations and are not used in the solution
 	BasePos = base.Pos;
 
+	// Get the states of the satellites both receivers are tracking
+	SatelliteStateCache& states = eph.States();
+	int32 station = states.Station(BasePos);
+	bool Wanted[MaxSats];
+	for (int s=0; s<MaxSats; s++)
+		Wanted[s] = base.obs[s].Valid && rover.obs[s].Valid;
+	ErrCode = states.Fill(GpsTime, Wanted);
+	if (ErrCode != OK) return;
+
 	// Do for each satellite
 	for (int s=0; s<MaxSats; s++) {
 
@@ -56,44 +85,13 @@ void Observations::Init(RawReceiver& base, RawReceiver& rover, Ephemerides& eph)
 		o.ValidPhase = false;
 		o.Slip = true;
 
-		// If either of the receivers aren't tracking, then we are done with this sat
-		if (!base.obs[s].Valid || !rover.obs[s].Valid || !eph[s].Valid(GpsTime)) 
+		// If we don't have a satellite position, then we are done with this sat
+		const SatelliteState& st = states[s];
+		if (!Wanted[s] || !st.Valid) 
 			continue;
 
-		// Get the satellite's position
-		double Adjust;
-		ErrCode = eph[s].SatPos(GpsTime, o.SatPos, Adjust);
-		if (ErrCode != OK) return;
-		debug(2, "Observations  s=%d  SatPos=(%.3f, %.3f, %.3f)\n",s, o.SatPos.x, o.SatPos.y, o.SatPos.z);
-
-		// Adjust the satellite's position to compensate for the earth's rotation
-		//  during the signal's transit
-		double TransitTime = Range(o.SatPos-RoverPos) / C;
-		o.SatPos = RotateEarth(o.SatPos, -TransitTime);
-		
-		// Make sure we have valid measurements.
-		o.ValidCode   = base.obs[s].PR != 0    && rover.obs[s].PR != 0;
-		o.ValidPhase  = base.obs[s].Phase != 0 && rover.obs[s].Phase != 0;
-		o.Slip        = base.obs[s].Slip       || rover.obs[s].Slip;
-
-
-#ifdef NotNow
-            // solve integer mseconds, but we seem to know if it is 0-8.
-            double range = Range(BasePos - o.SatPos);
-            double adjust = round((range - base.obs[s].PR), C/1000);
-            base.obs[s].PR += adjust;
-            debug("  s=%d  range=%.3f  adjust=%.3f  PR=%.3f\n", s, range, adjust, base.obs[s].PR);
-#endif
-		// Keep track of pseudorange and phase differences for generating equations
-		o.PR = rover.obs[s].PR - base.obs[s].PR;
-		o.Phase = rover.obs[s].Phase - base.obs[s].Phase;
-		debug("Observations: s=%d  b.PR=%.3f  b.range=%.3f  r.PR=%.3f  r.range=%.3f\n",
-                s, base.obs[s].PR, Range(o.SatPos-BasePos), 
-                   rover.obs[s].PR, Range(o.SatPos-RoverPos));
-
-		// Calculate the default weights to use.
-		o.CodeWeight = .01;
-		o.PhaseWeight = 1;
+		Position SatPos = st.Pos;
+		InitSat(s, base.obs[s], rover.obs[s], SatPos, st.Elevation[station]);
 	}
 
 #ifndef TESTING
@@ -120,6 +118,101 @@ void Observations::Init(RawReceiver& base, RawReceiver& rover, Ephemerides& eph)
 
 }
 
+
+
+void Observations::Init(BaseEpoch& base, RawReceiver& rover)
+//////////////////////////////////////////////////////////////////////
+// Same as above, but the base side was already done
+//////////////////////////////////////////////////////////////////////
+{
+	GpsTime = base.GpsTime;
+	RoverPos = rover.Pos;
+	BasePos = base.BasePos;
+	ErrCode = OK;
+
+	for (int s=0; s<MaxSats; s++) {
+		Observation& o = obs[s];
+		o.Sat = s;
+		o.ValidCode = false;
+		o.ValidPhase = false;
+		o.Slip = true;
+
+		if (!base.ValidSat[s] || !rover.obs[s].Valid)
+			continue;
+		InitSat(s, base.obs[s], rover.obs[s], base.SatPos[s], base.Elevation[s]);
+	}
+}
+
+
+
+void Observations::InitSat(int s, RawObservation& base, RawObservation& rover, 
+                           Position& SatPos, double Elevation)
+// Fill in the differences for one satellite which both receivers are tracking
+{
+	Observation& o = obs[s];
+	o.Elevation = Elevation;
+	debug(2, "Observations  s=%d  SatPos=(%.3f, %.3f, %.3f)\n",s, SatPos.x, SatPos.y, SatPos.z);
+
+	// Adjust the satellite's position to compensate for the earth's rotation
+	//  during the signal's transit
+	double TransitTime = Range(SatPos-RoverPos) / C;
+	o.SatPos = RotateEarth(SatPos, -TransitTime);
+	
+	// Make sure we have valid measurements.
+	o.ValidCode   = base.PR != 0    && rover.PR != 0;
+	o.ValidPhase  = base.Phase != 0 && rover.Phase != 0;
+	o.Slip        = base.Slip       || rover.Slip;
+
+#ifdef NotNow
+            // solve integer mseconds, but we seem to know if it is 0-8.
+            double range = Range(BasePos - o.SatPos);
+            double adjust = round((range - base.PR), C/1000);
+            base.PR += adjust;
+            debug("  s=%d  range=%.3f  adjust=%.3f  PR=%.3f\n", s, range, adjust, base.PR);
+#endif
+	// Keep track of pseudorange and phase differences for generating equations
+	o.PR = rover.PR - base.PR;
+	o.Phase = rover.Phase - base.Phase;
+	debug("Observations: s=%d  b.PR=%.3f  b.range=%.3f  r.PR=%.3f  r.range=%.3f\n",
+            s, base.PR, Range(o.SatPos-BasePos), 
+               rover.PR, Range(o.SatPos-RoverPos));
+
+	// Calculate the default weights to use.
+	o.CodeWeight = .01;
+	o.PhaseWeight = 1;
+}
+
+
+
+void BaseEpoch::Init(RawReceiver& base, Ephemerides& eph)
+//////////////////////////////////////////////////////////////////////
+// Save the base's measurements and find the satellite positions
+//////////////////////////////////////////////////////////////////////
+{
+	GpsTime = base.GpsTime;
+	BasePos = base.Pos;
+	ErrCode = OK;
+
+	for (int s=0; s<MaxSats; s++) {
+		obs[s] = base.obs[s];
+		ValidSat[s] = base.obs[s].Valid;
+	}
+
+	SatelliteStateCache& states = eph.States();
+	int32 station = states.Station(BasePos);
+	ErrCode = states.Fill(GpsTime, ValidSat);
+	if (ErrCode != OK) return;
+
+	for (int s=0; s<MaxSats; s++) {
+		if (!ValidSat[s]) continue;
+		const SatelliteState& st = states[s];
+		ValidSat[s] = st.Valid;
+		SatPos[s] = st.Pos;
+		Elevation[s] = st.Elevation[station];
+	}
+}
+
+
 		
 Observations::~Observations()
 {
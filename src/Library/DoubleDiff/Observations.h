@@ -21,11 +21,13 @@
 
 #include "RawReceiver.h"
 #include "Ephemeris.h"
+#include "SatelliteStateCache.h"
 
 struct Observation
 {
 	// Satellite info
 	Position SatPos;
+	double Elevation;    // radians, as seen from the base
 	bool ValidCode;
 	bool ValidPhase;
 	bool Slip;
@@ -41,6 +43,23 @@ struct Observation
 	int Sat;  // more for debugging than any computational need
 };
 
+// The part of an epoch which depends only on the base and the ephemerides.
+//   When several rovers share a base, it is calculated once for all of them.
+struct BaseEpoch
+{
+	Time GpsTime;
+	Position BasePos;
+	RawObservation obs[MaxSats];
+	bool ValidSat[MaxSats];     // does the satellite have a position?
+	Position SatPos[MaxSats];   // not yet adjusted for the earth's rotation
+	double Elevation[MaxSats];  // radians, as seen from the base
+	bool ErrCode;
+
+	void Init(RawReceiver& base, Ephemerides& eph);
+	inline bool GetError() {return ErrCode;}
+};
+
+
 class Observations
 {
 public:
@@ -54,10 +73,16 @@ public:
 	Observations();
 	Observations(RawReceiver& base, RawReceiver& rover, Ephemerides& eph);
 	void Init(RawReceiver&  base, RawReceiver& rover, Ephemerides& eph);
+	void Init(BaseEpoch& base, RawReceiver& rover);
 	inline Observation& operator[](int sat) {return obs[sat];}
 	inline bool GetError(){return ErrCode;}
-	Observations& operator=(Observations& obs);
+	Observations(Observations& src);
+	Observations& operator=(Observations& src);
 	virtual ~Observations();
+
+private:
+	void InitSat(int s, RawObservation& base, RawObservation& rover, 
+	             Position& SatPos, double Elevation);
 };
 
 
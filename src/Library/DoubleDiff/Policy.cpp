@@ -1,6 +1,7 @@
 
 #include "Policy.h"
 bool CodeOnly = false;
+bool Robust = false;
 
 
 
@@ -10,7 +11,7 @@ Policy::Policy()
 	FitThreshhold = 4;
 	CodeResidualThreshhold = 8;
 	PhaseResidualThreshhold = .1;
-	SinMinElev = sin(DegToRad(15));  // Elevation mask
+	MinElevation = DegToRad(15);     // Elevation mask
 	Delay = 10*NsecPerSec;           // How long to wait before trying again
 	PhaseErrorTolerance = 5;         // Allowable noise (m) pseudo-range VS phase
 
@@ -18,6 +19,15 @@ Policy::Policy()
 		SelectTime[s] = -1;
 
 	CodeOnly = ::CodeOnly;
+
+	// Robust estimation. (standardized residuals, IGG-III)
+	Robust = ::Robust;
+	//   Beyond K1 sigmas is the same as beyond the residual threshholds.
+	RobustParms.K0 = 1.5;
+	RobustParms.K1 = 4.0;
+	RobustParms.CodeSigma = CodeResidualThreshhold / RobustParms.K1;
+	RobustParms.PhaseSigma = PhaseResidualThreshhold / RobustParms.K1;
+	RobustParms.Iterations = 4;
 }
 
 bool Policy::SelectSatellites(Observations& obs, Observations& prev)
@@ -32,14 +42,10 @@ bool Policy::SelectSatellites(Observations& obs, Observations& prev)
 		// Ignore satellites with no data
 		if (!o.ValidCode && !o.ValidPhase) continue;
 
-		// Must be 15 degrees above horizon. 
-		//    This assumes a spherical earth, but good enough.
-		Position& pos = obs.BasePos;
-		Position satpos = o.SatPos - pos;
-		double SinElev = (pos * satpos) / ( Range(pos) * Range(satpos));
-	        debug("Select: s=%d SinElev=%.3f  SinMinElev=%.3f  ValidCode=%d ValidPhase=%d\n", 
-			s,SinElev, SinMinElev, o.ValidCode, o.ValidPhase);
-		if (SinElev < SinMinElev)
+		// Must be 15 degrees above the base's horizon. 
+	        debug("Select: s=%d Elevation=%.1f  MinElevation=%.1f  ValidCode=%d ValidPhase=%d\n", 
+			s, RadToDeg(o.Elevation), RadToDeg(MinElevation), o.ValidCode, o.ValidPhase);
+		if (o.Elevation < MinElevation)
 			o.ValidCode = o.ValidPhase = false;
 
 		// Don't use phase if a CodeOnly solution
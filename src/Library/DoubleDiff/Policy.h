@@ -13,11 +13,15 @@ protected:
 	double CodeResidualThreshhold;  // largest allowable code residual (meters)
 	double PhaseResidualThreshhold; // largest allowable phase residual (meters0
 
-	double SinMinElev;           // Sin of the minimum elevation
+	double MinElevation;         // elevation mask (radians)
 	Time   Delay;                // How long to wait before reconsidering a dropped sat
 	double PhaseErrorTolerance;  // How much discrepency to allow between code+phase (m)
 	bool CodeOnly;
 
+	// Reweight the observations (IRLS) rather than trying to drop satellites
+	bool Robust;
+	RobustParameters RobustParms;
+
 	// When to reconsider bad satellites
 	Time SelectTime[MaxSats];
 	Time GpsTime;
@@ -28,6 +32,8 @@ public:
 	bool Acceptable(Observations& obs, Solution& sol);
 	bool EliminateWorst(Observations& obs, Solution& sol);
 	void MarkBad(Observations& obs, int sat);
+	bool IsRobust() {return Robust;}
+	RobustParameters& GetRobustParameters() {return RobustParms;}
 	virtual ~Policy();
 
 private:
@@ -0,0 +1,295 @@
+// Smoother refines earlier positions with the final ambiguities
+//    Part of Kinematic, a utility for GPS positioning
+//
+// Copyright (C) 2006  John Morris    www.precision-gps.org
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation, version 2.
+
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+
+//////////////////////////////////////////////////////////////////////////////
+//
+// Side file format.  Each epoch is one record:
+//     the PositionFactor up to its ambiguities,
+//     NrAmbiguities entries of Amb[],
+//     the length of the whole record, so the file can be read backwards.
+//
+// Smoothed file format. Fixed size records, indexed by epoch.
+//
+// Going backwards through a segment, each arc's value is taken from the
+//   last epoch it appears in, relative to that epoch's reference arc.
+//   The reference outlives every arc which uses it, so its value is
+//   already known, except when it is the reference's own last epoch.
+//   Then its value comes from the satellite which took over as reference.
+//   The segment's final reference arc is zero.
+//
+//////////////////////////////////////////////////////////////////////////////
+
+#include "Smoother.h"
+#include "MappedFile.h"
+#include <stddef.h>
+
+static const size_t FixedSize = offsetof(PositionFactor, Amb);
+static const size_t AmbSize = sizeof(((PositionFactor*)0)->Amb[0]);
+
+struct SmoothedRecord
+{
+	Time GpsTime;
+	int32 Valid;
+	double Pos[3];
+	double Cep, Fit;
+};
+
+
+
+Smoother::Smoother()
+{
+	Side = Smoothed = NULL;
+	Completed = End = 0;
+	Done = false;
+	LastSegment = -1;
+
+	// Both files go in the temporary directory, with names of their own
+	SideName[0] = SmoothedName[0] = '\0';
+	if (MappedFile::TempFile(SideName, sizeof(SideName), "smoothing") != OK
+		|| MappedFile::TempFile(SmoothedName, sizeof(SmoothedName), "smoothed") != OK) {
+		ErrCode = Error("Smoother: can't create its temporary files\n");
+		return;
+	}
+
+	Side = fopen(SideName, "wb");
+	if (Side == NULL) {
+		ErrCode = Error("Smoother: can't create side file %s\n", SideName);
+		return;
+	}
+
+	Smoothed = fopen(SmoothedName, "w+b");
+	if (Smoothed == NULL) {
+		ErrCode = Error("Smoother: can't create file %s\n", SmoothedName);
+		return;
+	}
+
+	// The backward pass waits for segments in its own thread
+	ErrCode = Start();
+}
+
+
+
+bool Smoother::Forward(PositionFactor& f)
+{
+	// A new segment means the previous one is ready to go backwards
+	if (f.Segment != LastSegment && LastSegment != -1)
+		if (Publish(false) != OK) return Error();
+	LastSegment = f.Segment;
+
+	// Append the record, followed by its length
+	int64 len = FixedSize + max(f.NrAmbiguities, (int32)0) * AmbSize + sizeof(int64);
+	if (fwrite(&f, FixedSize, 1, Side) != 1
+		|| (f.NrAmbiguities > 0 && fwrite(f.Amb, AmbSize, f.NrAmbiguities, Side) != (size_t)f.NrAmbiguities)
+		|| fwrite(&len, sizeof(len), 1, Side) != 1)
+		return Error("Smoother: can't write to side file %s\n", SideName);
+	End += len;
+
+	return OK;
+}
+
+
+
+bool Smoother::Publish(bool done)
+{
+	// Make sure the other thread can read what we have written
+	if (fflush(Side) != 0)
+		return Error("Smoother: can't write to side file %s\n", SideName);
+
+	Lock.Lock();
+	Completed = End;
+	Done = done;
+	Lock.Unlock();
+	Ready.Wake();
+
+	return OK;
+}
+
+
+
+bool Smoother::Finish()
+{
+	// The last segment is complete. Wait for it to be smoothed.
+	if (Publish(true) != OK) return Error();
+	if (Join() != OK) return Error();
+	if (ErrCode != OK) return Error();
+
+	// Get ready to read the smoothed positions back
+	fflush(Smoothed);
+	rewind(Smoothed);
+	return OK;
+}
+
+
+
+void Smoother::Run()
+{
+	// Open our own copy of the side file
+	FILE* in = fopen(SideName, "rb");
+	if (in == NULL)
+		{ErrCode = Error("Smoother: can't read side file %s\n", SideName); return;}
+
+	// Do for each batch of finished segments
+	int64 Through = 0;
+	for (bool done = false; !done; ) {
+		Ready.Wait();
+
+		Lock.Lock();
+		int64 end = Completed;
+		done = Done;
+		Lock.Unlock();
+
+		if (end > Through && Backward(in, Through, end) != OK)
+			{ErrCode = Error(); break;}
+		Through = end;
+	}
+
+	fclose(in);
+}
+
+
+
+bool Smoother::Backward(FILE* in, int64 start, int64 end)
+///////////////////////////////////////////////////////////////////////////
+// Smooth the epochs from start to end of the side file, last epoch first.
+///////////////////////////////////////////////////////////////////////////
+{
+	// The current arc of each satellite, and the arc's value
+	int32 ArcOf[MaxSats];
+	double ValueOf[MaxSats];
+	for (int s=0; s<MaxSats; s++)
+		ArcOf[s] = -1;
+
+	int32 LaterRef = -1;
+	PositionFactor f;
+	for (int64 offset = end; offset > start; ) {
+
+		// Read the record which ends at this offset
+		int64 len;
+		if (MappedFile::Seek(in, offset - sizeof(len)) != OK
+			|| fread(&len, sizeof(len), 1, in) != 1
+			|| len < (int64)(FixedSize + sizeof(len)) || len > offset - start)
+			return Error("Smoother: side file %s is damaged\n", SideName);
+		offset -= len;
+		if (MappedFile::Seek(in, offset) != OK
+			|| fread(&f, FixedSize, 1, in) != 1
+			|| (f.NrAmbiguities > 0 && fread(f.Amb, AmbSize, f.NrAmbiguities, in) != (size_t)f.NrAmbiguities))
+			return Error("Smoother: can't read side file %s\n", SideName);
+
+		// No solution, nothing to smooth
+		Position pos = f.RoverPos;
+		if (f.NrAmbiguities == -1) {
+			if (WriteSmoothed(f.Epoch, f.GpsTime, false, pos, f.Cep, f.Fit) != OK) return Error();
+			LaterRef = -1;
+			continue;
+		}
+
+		// If this is the reference's last epoch, get its value
+		//   from the satellite which took over as reference.
+		double RefValue = 0;
+		int32 r = f.RefSat;
+		if (r != -1 && ArcOf[r] != f.RefArc) {
+			for (int k=0; k<f.NrAmbiguities; k++) {
+				int32 s = f.Amb[k].Sat;
+				if (ArcOf[s] != f.Amb[k].Arc) continue;
+				RefValue = ValueOf[s] - f.Amb[k].Value;
+				if (s == LaterRef) break;
+			}
+			ArcOf[r] = f.RefArc; ValueOf[r] = RefValue;
+		}
+		else if (r != -1)
+			RefValue = ValueOf[r];
+
+		// Arcs seen for the first time are at their final values
+		for (int k=0; k<f.NrAmbiguities; k++) {
+			int32 s = f.Amb[k].Sat;
+			if (ArcOf[s] == f.Amb[k].Arc) continue;
+			ArcOf[s] = f.Amb[k].Arc;
+			ValueOf[s] = RefValue + f.Amb[k].Value;
+		}
+
+		// Move the ambiguities to the right hand side
+		double b[3], x[3];
+		for (int i=0; i<3; i++) {
+			b[i] = f.B[i];
+			for (int k=0; k<f.NrAmbiguities; k++)
+				b[i] -= f.Amb[k].Coef[i] * (ValueOf[f.Amb[k].Sat] - RefValue);
+		}
+
+		// Back substitute for the position
+		for (int i=2; i>=0; i--) {
+			x[i] = b[i];
+			for (int j=i+1; j<3; j++)
+				x[i] -= f.R[i][j] * x[j];
+			x[i] /= f.R[i][i];
+		}
+		pos = Position(pos.x + x[0], pos.y + x[1], pos.z + x[2]);
+
+		if (WriteSmoothed(f.Epoch, f.GpsTime, true, pos, f.Cep, f.Fit) != OK) return Error();
+		LaterRef = r;
+	}
+
+	return OK;
+}
+
+
+
+bool Smoother::WriteSmoothed(int32 epoch, Time t, bool valid, Position& pos, double cep, double fit)
+{
+	SmoothedRecord rec;
+	rec.GpsTime = t;
+	rec.Valid = valid;
+	rec.Pos[0] = pos.x; rec.Pos[1] = pos.y; rec.Pos[2] = pos.z;
+	rec.Cep = cep; rec.Fit = fit;
+
+	if (MappedFile::Seek(Smoothed, (int64)epoch * sizeof(rec)) != OK
+		|| fwrite(&rec, sizeof(rec), 1, Smoothed) != 1)
+		return Error("Smoother: can't write smoothed position\n");
+	return OK;
+}
+
+
+
+bool Smoother::NextPosition(Time& t, Position& pos, double& cep, double& fit)
+// Read the next smoothed position. cep is -1 if there was no solution.
+{
+	SmoothedRecord rec;
+	if (fread(&rec, sizeof(rec), 1, Smoothed) != 1)
+		return Error();
+
+	t = rec.GpsTime;
+	pos = Position(rec.Pos[0], rec.Pos[1], rec.Pos[2]);
+	cep = rec.Valid? rec.Cep: -1;
+	fit = rec.Fit;
+	return OK;
+}
+
+
+
+Smoother::~Smoother()
+{
+	// Don't leave the backward pass waiting
+	if (!Done && Side != NULL)
+		Publish(true);
+	Join();
+
+	if (Side != NULL)     fclose(Side);
+	if (Smoothed != NULL) fclose(Smoothed);
+	if (SideName[0] != '\0')     remove(SideName);
+	if (SmoothedName[0] != '\0') remove(SmoothedName);
+}
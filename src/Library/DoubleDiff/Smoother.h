@@ -0,0 +1,106 @@
+#ifndef SMOOTHER_INCLUDED
+#define SMOOTHER_INCLUDED
+// Part of Kinematic, a utility for GPS positioning
+//
+// Copyright (C) 2006  John Morris    www.precision-gps.org
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation, version 2.
+
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+
+
+#include "Util.h"
+#include "Position.h"
+#include "Thread.h"
+#include <stdio.h>
+
+
+//////////////////////////////////////////////////////////////////////////////
+//
+// Smoother goes back and refines earlier positions using the final
+//   estimates of the phase ambiguities.
+//
+// After each epoch, the X, Y, Z rows of the triangular equations are about
+//   to be thrown away. Instead, the forward pass appends them to a binary
+//   side file. When a segment is finished (the solution starts over, or the
+//   data runs out) its final ambiguities are known, and a second thread reads
+//   the segment backwards, back substituting them into every epoch's position.
+//
+// The smoothed positions go into a second file of fixed size records,
+//   indexed by epoch, and are read back in order once both passes are done.
+//   Only one epoch and a table of ambiguities are in memory at a time,
+//   so a full day of data is no problem.
+//
+//////////////////////////////////////////////////////////////////////////////
+
+
+// What the forward pass saves from one epoch.
+//   An "arc" is an unbroken stretch of phase tracking for a satellite, and
+//   has its own ambiguity. The ambiguities are double differences against
+//   the reference satellite's arc.
+struct PositionFactor
+{
+	int32 Epoch;            // index of the epoch in the output
+	Time GpsTime;
+	int32 Segment;          // changes when the solution starts over
+	double Cep, Fit;
+	Position RoverPos;      // the offset is relative to this position
+	double R[3][3];         // upper triangular X, Y, Z rows
+	double B[3];
+	int32 RefSat, RefArc;
+	int32 NrAmbiguities;    // -1 if there was no solution
+	struct {
+		int32 Sat, Arc;
+		double Coef[3];     // coefficients in the X, Y, Z rows
+		double Value;       // estimate at this epoch
+	} Amb[MaxSats];
+};
+
+
+class Smoother : public Thread
+{
+public:
+	Smoother();
+	bool GetError() {return ErrCode;}
+	bool Forward(PositionFactor& f);    // save an epoch from the forward pass
+	bool Finish();                      // the forward pass is done. Wait for the backward pass.
+	bool NextPosition(Time& t, Position& pos, double& cep, double& fit);  // smoothed, in order
+	virtual ~Smoother();
+
+protected:
+	void Run();
+
+private:
+	bool ErrCode;
+	char SideName[260];  // temporary files
+	char SmoothedName[260];
+	FILE* Side;          // written by the forward pass
+	FILE* Smoothed;      // written by the backward pass, then read back
+
+	// Shared by the two passes
+	Mutex Lock;
+	Semaphore Ready;     // more of the side file is complete
+	int64 Completed;     // side file offset of the last complete segment's end
+	bool Done;           // no more segments are coming
+
+	// Forward pass
+	int64 End;
+	int32 LastSegment;
+
+	bool Publish(bool done);
+	bool Backward(FILE* in, int64 start, int64 end);
+	bool WriteSmoothed(int32 epoch, Time t, bool valid, Position& pos, double cep, double fit);
+};
+
+
+#endif // SMOOTHER_INCLUDED
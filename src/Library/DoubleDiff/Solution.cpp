@@ -1,11 +1,79 @@
 #include "Solution.h"
 
 
+static const double HoldWeight = 100;   // weight of a fixed ambiguity (1/cycles)
+static const int32 FixEpochs = 5;       // epochs the same integers must come up before we trust them
+static const double MinRobustFactor = .001; // least weight kept by an observation which can't be rejected
+
+
 
 Solution::Solution(Position& basepos, Position& roverpos)
 : RoverPos(roverpos), BasePos(basepos)
 {
 	ReferenceSat = -1;
+	eqn = NewGpsEquations(EquationChannels[0]);
+
+	for (int s=0; s<MaxSats; s++)
+		Arc[s] = -1;
+	NextArc = 0;
+	Segment = 0;
+
+	// Nothing fixed yet
+	for (int s=0; s<MaxSats; s++) {
+		Pending[s] = Held[s] = false;
+		Agreed[s] = 0;
+	}
+	Fixed = SegmentFixed = false;
+	SegmentStart = -1;
+	memset(&Stats, 0, sizeof(Stats));
+}
+
+
+Solution::Solution(Solution& src)
+{
+	eqn = NULL;
+	*this = src;
+}
+
+
+Solution& Solution::operator=(Solution& src)
+{
+	RoverPos = src.RoverPos;
+	BasePos = src.BasePos;
+	CodeClock = src.CodeClock;
+	PhaseClock = src.PhaseClock;
+	for (int s=0; s<MaxSats; s++) {
+		e[s] = src.e[s];
+		CodeB[s] = src.CodeB[s];
+		PhaseB[s] = src.PhaseB[s];
+	}
+	ReferenceSat = src.ReferenceSat;
+	for (int s=0; s<MaxSats; s++)
+		Arc[s] = src.Arc[s];
+	NextArc = src.NextArc;
+	Segment = src.Segment;
+
+	Resolver = src.Resolver;
+	Fixed = src.Fixed;
+	for (int s=0; s<MaxSats; s++) {
+		Pending[s] = src.Pending[s];
+		Held[s] = src.Held[s];
+		Agreed[s] = src.Agreed[s];
+		FixedValue[s] = src.FixedValue[s];
+	}
+	SegmentStart = src.SegmentStart;
+	SegmentFixed = src.SegmentFixed;
+	Stats = src.Stats;
+
+	// Reuse our equations if they are the same size
+	if (eqn != NULL && eqn->GetChannels() == src.eqn->GetChannels())
+		eqn->CopyFrom(*src.eqn);
+	else {
+		delete eqn;
+		eqn = src.eqn->Clone();
+	}
+
+	return *this;
 }
 
 
@@ -15,14 +83,19 @@ bool Solution::Update(Observations& obs, Position& pos, double& cep, double& fit
 	debug("Solution::Update BasePos=(%.3f, %.3f, %.3f)  RoverPos=(%.3f, %.3f, %.3f)\n",
 		BasePos.x, BasePos.y, BasePos.z, RoverPos.x, RoverPos.y, RoverPos.z);
 
+	// Make sure the equations are the right size for the satellites
+	if (Resize(obs) != OK) return Error();
+	Fixed = false;
+
 	// We are starting a new epoch and need new clock error variables
-	eqn.NewEpoch();
+	eqn->NewEpoch();
 
 	// Figure which satellies we are now tracking
 	if (UpdateSatellites(obs) != OK) return Error();
 
-    // Append the current epoch to the equations
+    // Append the current epoch to the equations, along with any newly fixed ambiguities
 	AppendDoubleDifference(obs);
+	AppendHeld();
 
 	// Get the solution if any 
 	if (Solve(pos, cep, fit) != OK)
@@ -33,6 +106,199 @@ bool Solution::Update(Observations& obs, Position& pos, double& cep, double& fit
 
 
 
+bool Solution::UpdateRobust(Observations& obs, RobustParameters& p, Position& pos, double& cep, double& fit)
+///////////////////////////////////////////////////////////////////////////
+// Update using iteratively reweighted least squares.
+//   Rather than trying to drop each satellite (and pair) in turn, solve with
+//   everything and reweight the observations by their residuals. Each
+//   iteration starts again from the previous epoch's equations, so the cost
+//   is at most p.Iterations solves however many observations are bad.
+// Observations beyond p.K1 are rejected, so they don't take part afterwards.
+///////////////////////////////////////////////////////////////////////////
+{
+	debug("Solution::UpdateRobust\n");
+
+	// Every iteration starts from here, with the a priori weights
+	Solution start(*this);
+	double CodeWeight[MaxSats], PhaseWeight[MaxSats];
+	for (int s=0; s<MaxSats; s++) {
+		CodeWeight[s] = obs[s].CodeWeight;
+		PhaseWeight[s] = obs[s].PhaseWeight;
+	}
+
+	for (int iteration=1; ; iteration++) {
+		if (Update(obs, pos, cep, fit) != OK) return Error();
+		if (cep == -1 || iteration >= p.Iterations) break;
+
+		bool changed;
+		if (Reweight(obs, p, CodeWeight, PhaseWeight, changed) != OK) return Error();
+		if (!changed) break;
+		*this = start;
+	}
+
+	return OK;
+}
+
+
+
+inline static double IggFactor(double v, RobustParameters& p)
+// How much of its weight an observation keeps, given its standardized residual
+{
+	v = abs(v);
+	if (v <= p.K0) return 1;
+	if (v > p.K1)  return 0;
+	double taper = (p.K1 - v) / (p.K1 - p.K0);
+	return p.K0 / v * taper * taper;
+}
+
+
+
+bool Solution::Reweight(Observations& obs, RobustParameters& p, double* CodeWeight, double* PhaseWeight,
+						bool& changed)
+///////////////////////////////////////////////////////////////////////////
+// Set the observations' weights from the residuals of the current solution.
+//   An observation which is rejected outright becomes invalid, but only while
+//   at least four code and four phase observations remain.
+///////////////////////////////////////////////////////////////////////////
+{
+	// The residuals, standardized by their a priori sigmas
+	double CodeRes[MaxSats], PhaseRes[MaxSats];
+	int NrCode = 0, NrPhase = 0;
+	for (int s=0; s<MaxSats; s++) {
+		if (obs[s].ValidCode)  {CodeRes[s] = GetCodeResidual(s); NrCode++;}
+		if (obs[s].ValidPhase) {PhaseRes[s] = GetPhaseResidual(s); NrPhase++;}
+	}
+
+	// Reweight each observation
+	changed = false;
+	for (int s=0; s<MaxSats; s++) {
+		if (obs[s].ValidCode) {
+			double w = CodeWeight[s] * IggFactor(CodeRes[s]/p.CodeSigma, p);
+			changed |= abs(w - obs[s].CodeWeight) > .001 * CodeWeight[s];
+			obs[s].CodeWeight = w;
+		}
+		if (obs[s].ValidPhase) {
+			double w = PhaseWeight[s] * IggFactor(PhaseRes[s]/p.PhaseSigma, p);
+			changed |= abs(w - obs[s].PhaseWeight) > .001 * PhaseWeight[s];
+			obs[s].PhaseWeight = w;
+		}
+	}
+
+	// Reject the worst observation with no weight left. Only one at a time,
+	//   since a single bad observation can drag good ones out with it.
+	int worst = -1; bool code = false; double WorstRes = 0;
+	for (int s=0; s<MaxSats; s++) {
+		if (obs[s].ValidCode && obs[s].CodeWeight == 0 && NrCode > 4 
+			       && abs(CodeRes[s])/p.CodeSigma > WorstRes)
+			{worst = s; code = true; WorstRes = abs(CodeRes[s])/p.CodeSigma;}
+		if (obs[s].ValidPhase && obs[s].PhaseWeight == 0 && NrPhase > 4 
+			       && abs(PhaseRes[s])/p.PhaseSigma > WorstRes)
+			{worst = s; code = false; WorstRes = abs(PhaseRes[s])/p.PhaseSigma;}
+	}
+	if (worst != -1) {
+		if (code)  obs[worst].ValidCode = false;
+		else       obs[worst].ValidPhase = false;
+		Event("Residuals out of bounds, rejecting %s of satellite %d.  residual=%.1f sigma\n",
+			code? "code": "phase", worst, WorstRes);
+	}
+
+	// Whatever couldn't be rejected keeps a little weight
+	for (int s=0; s<MaxSats; s++) {
+		if (obs[s].ValidCode && obs[s].CodeWeight == 0)    obs[s].CodeWeight = CodeWeight[s] * MinRobustFactor;
+		if (obs[s].ValidPhase && obs[s].PhaseWeight == 0)  obs[s].PhaseWeight = PhaseWeight[s] * MinRobustFactor;
+	}
+
+	return OK;
+}
+
+
+
+bool Solution::Exclude(Observations& obs, int sat1, int sat2, double& fit)
+///////////////////////////////////////////////////////////////////////////
+// Try the current solution without one or two of its satellites.
+//   The satellites' equations are downdated out of the solved equations,
+//   so we don't have to copy the solution and solve it again. 
+//   Call Restore() when done with the trial.
+// The reference satellite can't be excluded this way (see CanExclude), since
+//   every double difference depends on it. Those trials need a full update.
+// A fit of -1 means there is no solution without the satellites.
+////////////////////////////////////////////////////////////////////////////
+{
+	debug("Solution::Exclude sat1=%d  sat2=%d\n", sat1, sat2);
+	fit = -1;
+	if (!CanExclude(sat1, sat2))
+		return Error("Solution::Exclude - can't downdate reference satellite %d\n", ReferenceSat);
+	if (eqn->GetLastRow() < 0) return OK;
+
+	// Make sure enough satellites are left. (same test as AppendDoubleDifference)
+	int MCode = 0; int MPhase = 0;
+	for (int s=0; s<MaxSats; s++) {
+		if (s == sat1 || s == sat2) continue;
+		if (obs[s].ValidCode) MCode++;
+		if (obs[s].ValidPhase) MPhase++;
+	}
+	if (MCode < 4 && MPhase < 4) return OK;
+
+	// Rebuild the equations the satellites contributed to this epoch
+	double D[MaxDowndate][MaxDowndateCols], d[MaxDowndate];
+	int rows = 0;
+	int sats[2] = {sat1, sat2};
+	for (int i=0; i<2; i++) {
+		int s = sats[i];
+		if (s == -1) continue;
+		if (obs[s].ValidCode) {
+			eqn->CodeRow(e[s], CodeB[s], obs[s].CodeWeight, D[rows], d[rows]);
+			rows++;
+		}
+		if (obs[s].ValidPhase) {
+			eqn->PhaseRow(e[s], PhaseB[s], s, L1WaveLength, 0, obs[s].PhaseWeight, D[rows], d[rows]);
+			rows++;
+		}
+	}
+
+	// Remove them from the solution
+	if (eqn->Downdate(rows, D, d) != OK) return Error();
+	fit = eqn->GetFit();
+
+	return OK;
+}
+
+
+bool Solution::Restore()
+{
+	return eqn->Restore();
+}
+
+
+
+bool Solution::Resize(Observations& obs)
+///////////////////////////////////////////////////////////////////
+// Switch to the smallest equations which hold this epoch.
+//   Each satellite can add a phase column along with a code and a phase row.
+//   The current columns must fit too, since lost satellites are dropped later.
+///////////////////////////////////////////////////////////////////
+{
+	int sats = 0;
+	for (int s=0; s<MaxSats; s++)
+		if (obs[s].ValidCode || obs[s].ValidPhase) sats++;
+
+	int channels = GpsEquationsSize(max(sats+2, eqn->GetLastCol()-2));
+	if (channels == -1) 
+		return Error("Solution::Resize - too many satellites (%d)\n", sats);
+	if (channels == eqn->GetChannels())
+		return OK;
+
+	debug("Solution::Resize  sats=%d  channels %d --> %d\n", sats, eqn->GetChannels(), channels);
+	GpsEquationsBase* resized = NewGpsEquations(channels);
+	resized->CopyFrom(*eqn);
+	delete eqn;
+	eqn = resized;
+
+	return OK;
+}
+
+
+
 bool Solution::UpdateSatellites(Observations& obs)
 {
 	debug("UpdateSatellites: ReferenceSat=%d\n", ReferenceSat);
@@ -40,17 +306,23 @@ bool Solution::UpdateSatellites(Observations& obs)
 	//  If we aren't currently tracking, losing it again is a NOP
 	for (int s=0; s<MaxSats; s++)
 		if ((!obs[s].ValidPhase || obs[s].Slip) && s != ReferenceSat)
-			eqn.DropPhase(s);
+			eqn->DropPhase(s);
 
 	// Switch reference satellites if it was lost
 	if (ReferenceSat != -1 && (!obs[ReferenceSat].ValidPhase || obs[ReferenceSat].Slip))
 	    DropReference(obs);
 
-	// Gain the new and slipped satellites
+	// Gain the new and slipped satellites, each starting a new arc
 	//   If we are already tracking, gaining it again is a NOP
 	for (int s=0; s<MaxSats; s++)
-		if (obs[s].ValidPhase && s != ReferenceSat)
-			eqn.AddPhase(s);
+		if (obs[s].ValidPhase && s != ReferenceSat) {
+			if (!eqn->PhaseDefined(s)) {
+				Arc[s] = NextArc++;
+				Pending[s] = Held[s] = false;
+				Agreed[s] = 0;
+			}
+			eqn->AddPhase(s);
+		}
 
 	// If we are starting fresh, need to pick a new reference
 	if (ReferenceSat == -1)
@@ -84,19 +356,19 @@ bool Solution::AppendDoubleDifference(Observations& obs)
 
 		// Add in the code and phase equations
 		if (o.ValidCode)
-			eqn.AppendCode(e[s], CodeB[s], o.CodeWeight);
+			eqn->AppendCode(e[s], CodeB[s], o.CodeWeight);
 		if (o.ValidPhase)
-			eqn.AppendPhase(e[s], PhaseB[s], s, L1WaveLength, 0, o.PhaseWeight);
+			eqn->AppendPhase(e[s], PhaseB[s], s, L1WaveLength, 0, o.PhaseWeight);
 	}
 
 	// Append dummy equations if there are no code or phase equations
 	//   These assign zero to the clock variables and keeps the equations solvable
 	//   Alternatively, we could delete and renumber the columns.
-	// if (MCode == 0)   eqn.AppendCode(Triple(0), 0, 1);
-	// if (MPhase == 0)  eqn.AppendPhase(Triple(0), 0, 0, 0, 0, 1);
+	// if (MCode == 0)   eqn->AppendCode(Triple(0), 0, 1);
+	// if (MPhase == 0)  eqn->AppendPhase(Triple(0), 0, 0, 0, 0, 1);
 	Triple GnuTemp(0);
-	if (MCode == 0)   eqn.AppendCode(GnuTemp, 0, 1);
-	if (MPhase == 0)  eqn.AppendPhase(GnuTemp, 0, 0, 0, 0, 1);
+	if (MCode == 0)   eqn->AppendCode(GnuTemp, 0, 1);
+	if (MPhase == 0)  eqn->AppendPhase(GnuTemp, 0, 0, 0, 0, 1);
 
 
 	// debug - show the double difference phase values
@@ -114,7 +386,7 @@ bool Solution::AppendDoubleDifference(Observations& obs)
 bool Solution::Solve(Position& pos, double& cep, double& fit)
 {
     // If not enough satellites being tracked, then the equations were reset earlier
-	if (eqn.LastRow < 0) {
+	if (eqn->GetLastRow() < 0) {
 		pos = RoverPos;
 		cep = -1;
 		fit = -1;
@@ -123,7 +395,7 @@ bool Solution::Solve(Position& pos, double& cep, double& fit)
 
     // Calculate the new position
 	Position offset;
-	if (eqn.SolvePosition(offset, cep, fit) != OK) return Error();
+	if (eqn->SolvePosition(offset, cep, fit) != OK) return Error();
 	pos = RoverPos + offset;
 
 	return OK;
@@ -141,10 +413,23 @@ bool Solution::DropReference(Observations& obs)
 	if (ReferenceSat == -1) return OK;
 
 	// Switch to the new reference satellite.
-	if (eqn.ChangeReference(OldRef, ReferenceSat) != OK) return Error();
+	if (eqn->ChangeReference(OldRef, ReferenceSat) != OK) return Error();
+
+	// The ambiguities are now relative to the new reference. The constraints
+	//   carry over only if the new reference was held as well, and then
+	//   their integers are relative to it too.
+	bool RefHeld = Held[ReferenceSat];
+	double RefValue = FixedValue[ReferenceSat];
+	for (int s=0; s<MaxSats; s++) {
+		Pending[s] = false;
+		Held[s] = Held[s] && RefHeld;
+		Agreed[s] = 0;
+		if (Held[s] && s != ReferenceSat)
+			FixedValue[s] -= RefValue;
+	}
 
 	// Drop the old reference satellite
-	if (eqn.DropPhase(OldRef) != OK) return Error();
+	if (eqn->DropPhase(OldRef) != OK) return Error();
 
 	return OK;
 }
@@ -157,7 +442,7 @@ bool Solution::PickNewReference(Observations& obs)
 	if (ReferenceSat == -1) return OK;
 
 	// Simply get rid of this satellite's phase column. (TODO: review)
-	return eqn.DeletePhase(ReferenceSat);
+	return eqn->DeletePhase(ReferenceSat);
 }
 
 int Solution::BestReference(Observations& obs)
@@ -170,7 +455,7 @@ int Solution::BestReference(Observations& obs)
 
 		// A reference satellite must be tracked now and be part of previous solution
 		if (!obs[s].ValidPhase) continue;
-		if (!eqn.PhaseDefined(s)) continue;
+		if (!eqn->PhaseDefined(s)) continue;
 
 		// Pick the one with the highest elevation
 		Position& pos = obs.BasePos;
@@ -212,13 +497,13 @@ bool Solution::NewPosition(Position& pos)
 	//    simply removing the top 3 equations.
 	debug("Solution::NewPosition: pos=(%.3f, %.3f, %.3f)\n", pos.x, pos.y, pos.z);
 	RoverPos = pos;
-	return eqn.NewPosition();
+	return eqn->NewPosition();
 }
 
 
 Position Solution::GetPosition()
 {
-	return RoverPos + eqn.GetOffset();
+	return RoverPos + eqn->GetOffset();
 }
 
 double Solution::GetCep()
@@ -228,22 +513,220 @@ double Solution::GetCep()
 
 double Solution::GetCodeResidual(int sat)
 {
-	return eqn.GetTc() + e[sat]*eqn.GetOffset() - CodeB[sat];
+	return eqn->GetTc() + e[sat]*eqn->GetOffset() - CodeB[sat];
 }
 
 double Solution::GetPhaseResidual(int sat)
 {
-	return eqn.GetTp() + e[sat]*eqn.GetOffset() + eqn.GetAmbiguity(sat)*L1WaveLength
+	return eqn->GetTp() + e[sat]*eqn->GetOffset() + eqn->GetAmbiguity(sat)*L1WaveLength
 		     - PhaseB[sat];
 }
 
+double Solution::GetAmbiguity(int sat)
+// The integer value if fixed, otherwise the float value
+{
+	if (Fixed && eqn->PhaseDefined(sat)) return FixedValue[sat];
+	else                                 return eqn->GetAmbiguity(sat);
+}
+
 bool Solution::Reset()
 {
-	eqn.Reset(); 
+	eqn->Reset(); 
 	ReferenceSat = -1;
+	Segment++;
+
+	for (int s=0; s<MaxSats; s++) {
+		Pending[s] = Held[s] = false;
+		Agreed[s] = 0;
+	}
+	Fixed = SegmentFixed = false;
+	SegmentStart = -1;
+	return OK;
+}
+
+
+
+bool Solution::AppendHeld()
+// Constrain the newly fixed ambiguities to their integer values
+{
+	for (int s=0; s<MaxSats; s++) {
+		if (!Pending[s]) continue;
+
+		// Lost since it was fixed. The next arc starts over.
+		if (!eqn->PhaseDefined(s))
+			{Pending[s] = false; continue;}
+
+		// Leave it for the next epoch if the equations are full
+		if (eqn->GetLastRow() < 0 || eqn->GetLastRow()+1 >= eqn->GetMaxRows()) 
+			continue;
+
+		if (eqn->AppendAmbiguity(s, FixedValue[s], HoldWeight) != OK) return Error();
+		Pending[s] = false;
+		Held[s] = true;
+	}
+	return OK;
+}
+
+
+
+bool Solution::Fix(Observations& obs, Position& pos)
+///////////////////////////////////////////////////////////////////////////
+// Try to fix the phase ambiguities of the current solution at integers.
+//   If they pass the ratio test, and the same integers have come up for 
+//   several epochs, pos becomes the position with the fixed ambiguities.
+//   They are then added to the equations at the next update.
+///////////////////////////////////////////////////////////////////////////
+{
+	Fixed = false;
+	if (eqn->GetLastRow() < GpsEquationsBase::ZCol) return OK;
+
+	// Keep track of when the segment started, for time to first fix
+	if (SegmentStart == -1) {
+		SegmentStart = obs.GpsTime;
+		Stats.Segments++;
+	}
+	Stats.Epochs++;
+
+	// The ambiguities are the last block of the triangular equations
+	const int First = GpsEquationsBase::FirstPhase;
+	int n = eqn->GetLastCol() - First + 1;
+	if (n <= 0) return OK;
+	assert(n <= MaxAmbiguities);
+
+	int sat[MaxAmbiguities];
+	for (int s=0; s<MaxSats; s++)
+		if (eqn->GetColumn(s) != -1)
+			sat[eqn->GetColumn(s)-First] = s;
+
+	static const int N = MaxAmbiguities;
+	double R[N][N], a[N], fixed[N];
+	for (int i=0; i<n; i++) {
+		a[i] = eqn->GetAmbiguity(sat[i]);
+		for (int j=0; j<n; j++)
+			R[i][j] = (j < i)? 0: eqn->GetCoefficient(First+i, First+j);
+	}
+
+	// Search for the integers
+	double ratio;
+	if (Resolver.Resolve(n, R, a, fixed, ratio) != Lambda::FIXED) {
+		for (int s=0; s<MaxSats; s++)
+			Agreed[s] = 0;
+		return OK;
+	}
+
+	// Only trust integers which come up the same several epochs running.
+	//   The held ones are already in the equations, so they must not change.
+	bool trusted = true;
+	for (int i=0; i<n; i++) {
+		int s = sat[i];
+		if (Held[s]) {
+			if (FixedValue[s] != fixed[i])
+				trusted = false;
+			continue;
+		}
+		if (Agreed[s] > 0 && FixedValue[s] == fixed[i])
+			Agreed[s]++;
+		else
+			{Agreed[s] = 1; FixedValue[s] = fixed[i];}
+		if (Agreed[s] < FixEpochs)
+			trusted = false;
+	}
+	if (!trusted) return OK;
+
+	// Back substitute them into the position rows
+	const int XCol = GpsEquationsBase::XCol;
+	double x[3];
+	for (int r=2; r>=0; r--) {
+		double sum = eqn->GetRhs(XCol+r);
+		for (int j=0; j<n; j++)
+			sum -= eqn->GetCoefficient(XCol+r, First+j) * fixed[j];
+		for (int c=r+1; c<3; c++)
+			sum -= eqn->GetCoefficient(XCol+r, XCol+c) * x[c];
+		x[r] = sum / eqn->GetCoefficient(XCol+r, XCol+r);
+	}
+	pos = RoverPos + Position(x[0], x[1], x[2]);
+	Fixed = true;
+	Stats.FixedEpochs++;
+
+	// Make note of the first fix in the segment
+	if (!SegmentFixed) {
+		SegmentFixed = true;
+		double ttff = S(obs.GpsTime - SegmentStart);
+		if (Stats.FixedSegments == 0 || ttff < Stats.MinTtff) Stats.MinTtff = ttff;
+		if (Stats.FixedSegments == 0 || ttff > Stats.MaxTtff) Stats.MaxTtff = ttff;
+		Stats.TotalTtff += ttff;
+		Stats.FixedSegments++;
+		Event("Fixed %d ambiguities after %.0f seconds. ratio=%.1f\n", n, ttff, ratio);
+	}
+
+	// Constrain the newly fixed ones at the next update
+	for (int i=0; i<n; i++)
+		if (!Held[sat[i]])
+			Pending[sat[i]] = true;
+
 	return OK;
 }
 
-Solution::~Solution(){}
+
+
+void Solution::SetFixing(double ratio, Time budget)
+{
+	Resolver.RatioThreshhold = ratio;
+	Resolver.Budget = budget;
+}
+
+
+void Solution::GetFixStatistics(FixStatistics& st)
+{
+	st = Stats;
+	st.Searches = Resolver.Searches;
+	st.Timeouts = Resolver.Timeouts;
+	st.MaxSearchTime = Resolver.MaxSearchTime;
+}
+
+
+
+bool Solution::GetFactor(PositionFactor& f)
+///////////////////////////////////////////////////////////////////////////
+// Save the X, Y, Z rows of the solved equations so the position can be 
+//   recalculated later with better ambiguities. (See Smoother)
+///////////////////////////////////////////////////////////////////////////
+{
+	f.Segment = Segment;
+	f.RoverPos = RoverPos;
+	f.NrAmbiguities = -1;
+	if (eqn->GetLastRow() < GpsEquationsBase::ZCol)
+		return OK;
+
+	// The upper triangle of the position rows
+	const int XCol = GpsEquationsBase::XCol;
+	for (int r=0; r<3; r++) {
+		for (int c=0; c<3; c++)
+			f.R[r][c] = (c < r)? 0: eqn->GetCoefficient(XCol+r, XCol+c);
+		f.B[r] = eqn->GetRhs(XCol+r);
+	}
+
+	// The ambiguities, named by arc so they can be matched up later
+	f.RefSat = ReferenceSat;
+	f.RefArc = (ReferenceSat == -1)? -1: Arc[ReferenceSat];
+	f.NrAmbiguities = 0;
+	for (int s=0; s<MaxSats; s++) {
+		int col = eqn->GetColumn(s);
+		if (col == -1) continue;
+		int k = f.NrAmbiguities++;
+		f.Amb[k].Sat = s;
+		f.Amb[k].Arc = Arc[s];
+		for (int r=0; r<3; r++)
+			f.Amb[k].Coef[r] = eqn->GetCoefficient(XCol+r, col);
+		f.Amb[k].Value = eqn->GetAmbiguity(s);
+	}
+
+	return OK;
+}
+
+Solution::~Solution()
+{
+	delete eqn;
+}
 
 
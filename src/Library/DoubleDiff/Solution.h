@@ -3,6 +3,32 @@
 
 #include "GpsEquations.h"
 #include "Observations.h"
+#include "Smoother.h"
+#include "Lambda.h"
+
+
+// How quickly the integer ambiguities get fixed.
+//   A segment starts with the first solution after the solution starts over.
+struct FixStatistics
+{
+	int32 Segments, FixedSegments;      // segments, and how many of them got a fix
+	double TotalTtff, MinTtff, MaxTtff; // time to first fix (seconds)
+	int32 Epochs, FixedEpochs;
+	int32 Searches, Timeouts;           // from the integer search
+	Time MaxSearchTime;
+};
+
+
+// How the robust mode reweights the observations. (IGG-III)
+//   Residuals are standardized by the sigmas. Up to K0 keeps full weight,
+//   beyond K1 is rejected, and in between the weight tapers off.
+struct RobustParameters
+{
+	double K0, K1;
+	double CodeSigma, PhaseSigma;    // meters
+	int32 Iterations;                // most solves per epoch
+};
+
 
 class Solution
 {
@@ -21,28 +47,62 @@ protected:
 	// Reference satellite used for double differencing
 	int ReferenceSat;
 
-	// The resulting linear gps equations
-	GpsEquations eqn;
+	// Each unbroken stretch of phase tracking is an "arc" with its own ambiguity.
+	//   Segment changes every time the solution starts over. (for smoothing)
+	int32 Arc[MaxSats];
+	int32 NextArc;
+	int32 Segment;
+
+	// The resulting linear gps equations, sized for the satellites in view
+	GpsEquationsBase* eqn;
+
+	// Integer ambiguities. Once fixed, an arc's value is added to the equations
+	//   as a constraint (Pending until the next update), and is then Held.
+	Lambda Resolver;
+	bool Fixed;
+	bool Pending[MaxSats];
+	bool Held[MaxSats];
+	double FixedValue[MaxSats];
+	int32 Agreed[MaxSats];      // epochs running FixedValue has come up
+	Time SegmentStart;          // -1 until the segment has a solution
+	bool SegmentFixed;
+	FixStatistics Stats;
 
 
 public:
 	Solution(Position& basepos, Position& roverpos);
 	bool NewPosition(Position& pos);
 	bool Update(Observations& obs, Position& pos, double& cep, double& fit);
+	bool UpdateRobust(Observations& obs, RobustParameters& p, Position& pos, double& cep, double& fit);
+	bool CanExclude(int sat1, int sat2) {return sat1 != ReferenceSat && sat2 != ReferenceSat;}
+	bool Exclude(Observations& obs, int sat1, int sat2, double& fit);
+	bool Restore();
 	bool Reset();
+	bool Fix(Observations& obs, Position& pos);
+	void SetFixing(double ratio, Time budget);
+	void GetFixStatistics(FixStatistics& st);
+	bool IsFixed() {return Fixed;}
 
 	Position GetPosition();
 	double GetCep();
-	double GetFit() {return eqn.GetFit();}
+	double GetFit() {return eqn->GetFit();}
 	double GetCodeResidual(int sat);
 	double GetPhaseResidual(int sat);
+	double GetAmbiguity(int sat);
+	bool GetFactor(PositionFactor& f);
 
+	Solution(Solution& src);
+	Solution& operator=(Solution& src);
 	virtual ~Solution();
 
 private:
 	bool AppendDoubleDifference(Observations& obs);
 	bool AppendDoublePhase(Observations& obs);
 	bool AppendDoubleCode(Observations& obs);
+	bool AppendHeld();
+	bool Reweight(Observations& obs, RobustParameters& p, double* CodeWeight, double* PhaseWeight,
+		          bool& changed);
+	bool Resize(Observations& obs);
 	bool UpdateSatellites(Observations& obs);
 	bool Solve(Position& pos, double& cep, double& fit);
 	bool SingleDifference(Observation& o, Triple& e, double& CodeB, double& PhaseB);
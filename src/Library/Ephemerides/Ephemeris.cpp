@@ -18,6 +18,8 @@
 // Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
 
 #include "Ephemeris.h"
+#include "EphemerisXmit.h"
+#include "SatelliteStateCache.h"
 
 
 
@@ -39,8 +41,31 @@ Ephemeris::Ephemeris(int Sat, const char* description)
     ErrCode = Error();
     SatIndex = Sat;
     Description = description;
+    MinTime = MaxTime = 0;
 }
 
+bool Ephemeris::SatState(Time t, Position& XmitPos, Position& Velocity, 
+                         double& Adjust, double& Drift)
+/////////////////////////////////////////////////////////////////////////
+// Get the satellite's position and clock, along with how fast they change
+//   (m/sec and sec/sec). The ephemerides which can should do it directly.
+//   Here we difference the positions a half second either side.
+/////////////////////////////////////////////////////////////////////////
+{
+	Position Before, After;
+	double AdjustBefore, AdjustAfter;
+	if (SatPos(t, XmitPos, Adjust) != OK
+	 || SatPos(t - NsecPerSec/2, Before, AdjustBefore) != OK
+	 || SatPos(t + NsecPerSec/2, After, AdjustAfter) != OK)
+		return Error();
+
+	Velocity = After - Before;
+	Drift = AdjustAfter - AdjustBefore;
+
+	return OK;
+}
+
+
 Ephemeris::~Ephemeris()
 {
 	Description = "";
@@ -51,10 +76,60 @@ Ephemerides::Ephemerides()
 {
     for (int s = 0; s<MaxSats; s++)
         eph[s] = NULL;
+    StateCache = NULL;
 }
 
+bool Ephemerides::SatPosAll(Time t, bool valid[MaxSats], Position pos[MaxSats], double adjust[MaxSats])
+///////////////////////////////////////////////////////////////////////////
+// Find the positions of all the satellites at once.
+//   On entry, valid[s] says whether we want satellite s.
+//   On exit, it says whether the satellite has a position.
+//
+// The ones Broadcast() hands over are done together in a single batch.
+///////////////////////////////////////////////////////////////////////////
+{
+	EphemerisXmit* xmit[MaxSats];
+	Position xmitPos[MaxSats];
+	double xmitAdjust[MaxSats];
+	int sat[MaxSats];
+	int n = 0;
+
+	for (int s=0; s<MaxSats; s++) {
+		if (!valid[s]) continue;
+		valid[s] = eph[s] != NULL && eph[s]->Valid(t);
+		if (!valid[s]) continue;
+
+		// Save the broadcast ones for later, and do the others now
+		EphemerisXmit* x = Broadcast(s);
+		if (x != NULL) {
+			xmit[n] = x; sat[n] = s; n++;
+		} else if (eph[s]->SatPos(t, pos[s], adjust[s]) != OK)
+			return Error();
+	}
+
+	EphemerisXmit::SatPosBatch(n, xmit, t, xmitPos, xmitAdjust);
+	for (int i=0; i<n; i++) {
+		pos[sat[i]] = xmitPos[i];
+		adjust[sat[i]] = xmitAdjust[i];
+	}
+
+	return OK;
+}
+
+
+SatelliteStateCache& Ephemerides::States()
+// The cache is made when first needed
+{
+	if (StateCache == NULL)
+		StateCache = new SatelliteStateCache(*this);
+	return *StateCache;
+}
+
+
 Ephemerides::~Ephemerides()
 {
+	if (StateCache != NULL)
+		delete StateCache;
     for (int s=0; s<MaxSats; s++) {
         if (eph[s] != NULL)
             delete eph[s];
@@ -32,6 +32,8 @@ public:
 	Ephemeris(int Sat, const char* description = "");
 	virtual ~Ephemeris();
 	virtual bool SatPos(Time t, Position& XmitPos, double& Adjust) = 0;
+	virtual bool SatState(Time t, Position& XmitPos, Position& Velocity, 
+	                      double& Adjust, double& Drift);
 	virtual double Accuracy(Time time) = 0; 
 	virtual bool Valid(Time time) = 0;
 	
@@ -68,14 +70,27 @@ public:
 
 
 
+class SatelliteStateCache;
+class EphemerisXmit;
+
 class Ephemerides
 {
 public:
 	Ephemerides();
 	Ephemeris& operator[](int s) {return *eph[s];}
+	virtual bool SatPosAll(Time t, bool valid[MaxSats], Position pos[MaxSats], double adjust[MaxSats]);
+
+	// Sets which hold broadcast ephemerides hand them over here,
+	//   so SatPosAll can do them in one batch
+	virtual EphemerisXmit* Broadcast(int s) {return NULL;}
+
+	SatelliteStateCache& States();   // the satellite states for the current epoch
 	virtual ~Ephemerides();
 //protected: needed for simulation. Maybe make it a friend?
 	Ephemeris* eph[MaxSats];
+
+private:
+	SatelliteStateCache* StateCache;
 };
 
 
@@ -0,0 +1,195 @@
+// EphemerisAnchored interpolates the ephemerides between anchors
+//    Part of Kinematic, a utility for GPS positioning
+//
+// Copyright (C) 2006  John Morris    www.precision-gps.org
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation, version 2.
+
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+
+
+#include "EphemerisAnchored.h"
+
+
+EphemerisAnchored::EphemerisAnchored(int sat, Ephemerides& source, Time step)
+: Ephemeris(sat, "Anchored Ephemeris"), Source(source), Step(step)
+{
+	ErrCode = OK;
+	StepSecs = S(Step);
+	PerStep = 1.0 / Step;
+	From = NULL;
+	FromMin = FromMax = 0;
+	Before.GpsTime = After.GpsTime = -1;
+}
+
+
+
+bool EphemerisAnchored::SatPos(Time t, Position& XmitPos, double& Adjust)
+{
+	Ephemeris* e = Source.eph[SatIndex];
+	if (e == NULL)
+		return Error("EphemerisAnchored: no ephemeris for sat %d\n", SatIndex);
+
+	// If we can't get anchors (eg. near the end of the data), do it directly
+	if (!Current(t, e) && Anchors(t, e) != OK)
+		return e->SatPos(t, XmitPos, Adjust);
+
+	Interpolate(t, XmitPos, Adjust);
+	return OK;
+}
+
+
+
+bool EphemerisAnchored::SatState(Time t, Position& XmitPos, Position& Velocity, 
+                                 double& Adjust, double& Drift)
+{
+	Ephemeris* e = Source.eph[SatIndex];
+	if (e == NULL)
+		return Error("EphemerisAnchored: no ephemeris for sat %d\n", SatIndex);
+
+	if (!Current(t, e) && Anchors(t, e) != OK)
+		return e->SatState(t, XmitPos, Velocity, Adjust, Drift);
+
+	Interpolate(t, XmitPos, Adjust, &Velocity, &Drift);
+	return OK;
+}
+
+
+
+inline void EphemerisAnchored::Interpolate(Time t, Position& pos, double& adjust, 
+                                           Position* vel, double* drift)
+/////////////////////////////////////////////////////////////////////////
+// Cubic Hermite interpolation between the anchors on either side
+/////////////////////////////////////////////////////////////////////////
+{
+	// The Hermite basis functions
+	double h = StepSecs;
+	double s = (t - Before.GpsTime) * PerStep;
+	double s2 = s*s, s3 = s2*s;
+	double h00 = 2*s3 - 3*s2 + 1,   h01 = 1 - h00;
+	double h10 = (s3 - 2*s2 + s)*h, h11 = (s3 - s2)*h;
+
+	Anchor& b = Before; Anchor& a = After;
+	pos.x = b.Pos.x*h00 + b.Velocity.x*h10 + a.Pos.x*h01 + a.Velocity.x*h11;
+	pos.y = b.Pos.y*h00 + b.Velocity.y*h10 + a.Pos.y*h01 + a.Velocity.y*h11;
+	pos.z = b.Pos.z*h00 + b.Velocity.z*h10 + a.Pos.z*h01 + a.Velocity.z*h11;
+	adjust = b.Adjust*h00 + b.Drift*h10 + a.Adjust*h01 + a.Drift*h11;
+	if (vel == NULL) return;
+
+	// and their derivatives
+	double d00 = (6*s2 - 6*s)/h,    d01 = -d00;
+	double d10 = 3*s2 - 4*s + 1,    d11 = 3*s2 - 2*s;
+	vel->x = b.Pos.x*d00 + b.Velocity.x*d10 + a.Pos.x*d01 + a.Velocity.x*d11;
+	vel->y = b.Pos.y*d00 + b.Velocity.y*d10 + a.Pos.y*d01 + a.Velocity.y*d11;
+	vel->z = b.Pos.z*d00 + b.Velocity.z*d10 + a.Pos.z*d01 + a.Velocity.z*d11;
+	*drift = b.Adjust*d00 + b.Drift*d10 + a.Adjust*d01 + a.Drift*d11;
+}
+
+
+
+bool EphemerisAnchored::Anchors(Time t, Ephemeris* e)
+// Get the anchors on either side of t
+{
+	if (!e->Valid(t))
+		return Error();
+
+	Time first = t - ((t % Step) + Step) % Step;
+
+	// Moving ahead by a step reuses an anchor
+	if (Same(e) && After.GpsTime == first)
+		Before = After;
+	else if (SetAnchor(Before, first, e) != OK)
+		return Error();
+
+	From = e; FromMin = e->MinTime; FromMax = e->MaxTime;
+	if (SetAnchor(After, first+Step, e) != OK)
+		return Error();
+
+	// Don't interpolate across a change of ephemeris (eg. a composite
+	//   switching sources between the anchors)
+	if (!Same(e))
+		return Error();
+	return OK;
+}
+
+
+
+bool EphemerisAnchored::SetAnchor(Anchor& a, Time t, Ephemeris* e)
+{
+	a.GpsTime = -1;
+	if (!e->Valid(t) || e->SatState(t, a.Pos, a.Velocity, a.Adjust, a.Drift) != OK)
+		return Error();
+	a.GpsTime = t;
+	return OK;
+}
+
+
+
+bool EphemerisAnchored::Valid(Time t)
+{
+	Ephemeris* e = Source.eph[SatIndex];
+	return e != NULL && e->Valid(t);
+}
+
+
+
+double EphemerisAnchored::Accuracy(Time t)
+{
+	Ephemeris* e = Source.eph[SatIndex];
+	if (e == NULL) return INFINITY;
+	return e->Accuracy(t);
+}
+
+
+
+EphemerisAnchored::~EphemerisAnchored()
+{
+}
+
+
+
+
+EphemeridesAnchored::EphemeridesAnchored(Ephemerides& source, Time step)
+{
+	for (int s=0; s<MaxSats; s++)
+		eph[s] = new EphemerisAnchored(s, source, step);
+}
+
+
+bool EphemeridesAnchored::SatPosAll(Time t, bool valid[MaxSats], Position pos[MaxSats], double adjust[MaxSats])
+///////////////////////////////////////////////////////////////////////////
+// Same as the usual one, but without the virtual calls when the
+//   satellite is between its anchors
+///////////////////////////////////////////////////////////////////////////
+{
+	for (int s=0; s<MaxSats; s++) {
+		if (!valid[s]) continue;
+		EphemerisAnchored& a = *(EphemerisAnchored*)eph[s];
+		Ephemeris* e = a.Source.eph[s];
+
+		if (e != NULL && a.Current(t, e))
+			a.Interpolate(t, pos[s], adjust[s]);
+		else {
+			valid[s] = a.Valid(t);
+			if (valid[s] && a.SatPos(t, pos[s], adjust[s]) != OK)
+				return Error();
+		}
+	}
+
+	return OK;
+}
+
+
+EphemeridesAnchored::~EphemeridesAnchored()
+{
+}
@@ -0,0 +1,106 @@
+#ifndef EPHEMERISANCHORED_INCLUDED
+#define EPHEMERISANCHORED_INCLUDED
+// Part of Kinematic, a utility for GPS positioning
+//
+// Copyright (C) 2006  John Morris    www.precision-gps.org
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation, version 2.
+
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+
+
+
+
+#include "Util.h"
+#include "Ephemeris.h"
+
+
+//////////////////////////////////////////////////////////////////////////////
+//
+// EphemeridesAnchored speeds up receivers running faster than 1 Hz.
+//   The full ephemerides are only calculated at "anchors", every 15
+//   seconds by default, and positions in between come from cubic Hermite
+//   interpolation of the positions and velocities at the two anchors.
+//
+// The orbit is smooth, so the error is small. For anchors h seconds apart
+//   it is at most h^4/384 times the largest 4th derivative of the position.
+//   In earth fixed coordinates the 4th derivative is under r*(n+we)^4,
+//   about 6e-8 m/s^4, so the error is under 1.6e-10*h^4 meters:
+//   well under a nanometer at 1 second, under 10 micrometers at 15 s,
+//   and under a millimeter up to 50 s. At short steps, the velocities
+//   from the ephemerides limit it to about 1e-7 m. The clock is done the
+//   same way with its drift.
+//
+// At 20 Hz, 15 s anchors make the positions about 10x faster than the
+//   ephemerides alone, with errors of 2-6 micrometers (BenchEphemeris).
+//   1 s anchors only give 4-6x, since the anchors themselves dominate.
+//
+// It wraps another set of ephemerides, and follows it as that one
+//   picks up new broadcast ephemerides.
+//
+//////////////////////////////////////////////////////////////////////////////
+
+class EphemerisAnchored: public Ephemeris
+{
+public:
+	EphemerisAnchored(int sat, Ephemerides& source, Time step);
+	virtual ~EphemerisAnchored();
+	virtual bool SatPos(Time t, Position& XmitPos, double& Adjust);
+	virtual bool SatState(Time t, Position& XmitPos, Position& Velocity, 
+	                      double& Adjust, double& Drift);
+	virtual bool Valid(Time t);
+	virtual double Accuracy(Time t);
+
+private:
+	struct Anchor
+	{
+		Time GpsTime;
+		Position Pos, Velocity;
+		double Adjust, Drift;
+	};
+
+	Ephemerides& Source;
+	Time Step;
+	double StepSecs, PerStep;
+	Ephemeris* From;       // the ephemeris the anchors were calculated with
+	Time FromMin, FromMax; // and its range, which changes when it is updated
+	Anchor Before, After;
+
+	bool Anchors(Time t, Ephemeris* e);
+	bool SetAnchor(Anchor& a, Time t, Ephemeris* e);
+	void Interpolate(Time t, Position& pos, double& adjust, 
+	                 Position* vel = NULL, double* drift = NULL);
+
+	// Receivers update their ephemerides in place, so a new one
+	//   shows up as a change in its time range.
+	inline bool Same(Ephemeris* e)
+		{return e == From && e->MinTime == FromMin && e->MaxTime == FromMax;}
+	inline bool Current(Time t, Ephemeris* e)
+		{return Before.GpsTime <= t && t < After.GpsTime && Same(e);}
+
+	friend class EphemeridesAnchored;
+};
+
+
+
+class EphemeridesAnchored: public Ephemerides
+{
+public:
+	static const Time DefaultStep = 15*NsecPerSec;
+	EphemeridesAnchored(Ephemerides& source, Time step = DefaultStep);
+	virtual bool SatPosAll(Time t, bool valid[MaxSats], Position pos[MaxSats], double adjust[MaxSats]);
+	virtual ~EphemeridesAnchored();
+};
+
+
+#endif // EPHEMERISANCHORED_INCLUDED
@@ -0,0 +1,239 @@
+// EphemerisArchive keeps all the broadcast ephemerides, indexed by time
+//    Part of Kinematic, a utility for GPS positioning
+//
+// Copyright (C) 2006  John Morris    www.precision-gps.org
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation, version 2.
+
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+
+
+#include "EphemerisArchive.h"
+
+
+// A reader must see all of a list before it sees the pointer to it
+#if defined(WINDOWS)
+template <typename T> static inline T* LoadAcquire(T* volatile& p)
+    {T* x = p; MemoryBarrier(); return x;}
+template <typename T> static inline void StoreRelease(T* volatile& p, T* x)
+    {MemoryBarrier(); p = x;}
+#else
+template <typename T> static inline T* LoadAcquire(T* volatile& p)
+    {return __atomic_load_n(&p, __ATOMIC_ACQUIRE);}
+template <typename T> static inline void StoreRelease(T* volatile& p, T* x)
+    {__atomic_store_n(&p, x, __ATOMIC_RELEASE);}
+#endif
+
+
+EphemerisArchive::EphemerisArchive()
+{
+	for (int s=0; s<MaxSats; s++) {
+		Lists[s] = NULL;
+		eph[s] = new EphemerisArchived(s, *this);
+	}
+}
+
+
+
+bool EphemerisArchive::Add(EphemerisXmit& e)
+/////////////////////////////////////////////////////////////////////////
+// Add a copy of the ephemeris, keeping the list in order of t_oe.
+//   Readers may be using the current list, so we make a new one.
+//   The satellite's time range grows to cover it, which is how
+//   EphemeridesComposite knows we have something new.
+/////////////////////////////////////////////////////////////////////////
+{
+	int32 sat = e.SatIndex;
+	if (sat < 0 || sat >= MaxSats || e.sqrt_a < 1 || e.MaxTime < e.MinTime)
+		return Error("EphemerisArchive: ephemeris for sat %d isn't usable\n", sat);
+
+	// Our copy is never changed, so calculate its constants now
+	EphemerisXmit* copy = new EphemerisXmit(e);
+	copy->CheckPrecomputed();
+
+	Lock.Lock();
+	List* old = Lists[sat];
+	int32 i = After(old, e.t_oe);
+
+	// If we already have it, it is just before where it would go
+	for (int32 j=i-1; j>=0 && old->Eph[j]->t_oe == e.t_oe; j--) {
+		EphemerisXmit& x = *old->Eph[j];
+		if (x.iode == e.iode && x.iodc == e.iodc && x.t_oc == e.t_oc) {
+			Lock.Unlock();
+			delete copy;
+			return OK;
+		}
+	}
+
+	// Make a new list with the ephemeris inserted
+	List* l = new List;
+	l->Size = (old == NULL)? 1: old->Size+1;
+	l->Eph = new EphemerisXmit*[l->Size];
+	for (int32 j=0; j<i; j++)
+		l->Eph[j] = old->Eph[j];
+	l->Eph[i] = copy;
+	for (int32 j=i+1; j<l->Size; j++)
+		l->Eph[j] = old->Eph[j-1];
+	l->Older = old;
+	StoreRelease(Lists[sat], l);
+
+	Ephemeris& a = *eph[sat];
+	if (old == NULL || e.MinTime < a.MinTime) a.MinTime = e.MinTime;
+	if (old == NULL || e.MaxTime > a.MaxTime) a.MaxTime = e.MaxTime;
+	Lock.Unlock();
+
+	debug("EphemerisArchive::Add sat=%d iode=%d t_oe=%.0f  (%d for sat)\n", 
+		sat, e.iode, GpsTow(e.t_oe), l->Size);
+	return OK;
+}
+
+
+EphemerisXmit* EphemerisArchive::Find(int32 sat, Time t)
+{
+	return Closest(Current(sat), t);
+}
+
+
+int32 EphemerisArchive::Count(int32 sat)
+{
+	List* l = Current(sat);
+	return (l == NULL)? 0: l->Size;
+}
+
+
+
+bool EphemerisArchive::SatPosAll(Time t, bool valid[MaxSats], Position pos[MaxSats], double adjust[MaxSats])
+// Find the ephemerides, then do them all as a batch
+{
+	EphemerisXmit* xmit[MaxSats];
+	Position xmitPos[MaxSats];
+	double xmitAdjust[MaxSats];
+	int sat[MaxSats];
+	int n = 0;
+	for (int s=0; s<MaxSats; s++) {
+		if (!valid[s]) continue;
+		EphemerisXmit* x = Closest(Current(s), t);
+		valid[s] = (x != NULL);
+		if (x != NULL) {xmit[n] = x; sat[n] = s; n++;}
+	}
+
+	EphemerisXmit::SatPosBatch(n, xmit, t, xmitPos, xmitAdjust);
+	for (int i=0; i<n; i++) {
+		pos[sat[i]] = xmitPos[i];
+		adjust[sat[i]] = xmitAdjust[i];
+	}
+
+	return OK;
+}
+
+
+
+EphemerisArchive::List* EphemerisArchive::Current(int32 sat)
+{
+	return LoadAcquire(Lists[sat]);
+}
+
+
+int32 EphemerisArchive::After(List* list, Time t)
+// Index of the first ephemeris with t_oe after t
+{
+	if (list == NULL) return 0;
+	int32 lo = 0, hi = list->Size;
+	while (lo < hi) {
+		int32 mid = (lo + hi) / 2;
+		if (list->Eph[mid]->t_oe <= t) lo = mid+1;
+		else                           hi = mid;
+	}
+	return lo;
+}
+
+
+EphemerisXmit* EphemerisArchive::Closest(List* list, Time t)
+// Of the ephemerides on either side of t, the closest valid one
+{
+	int32 i = After(list, t);
+	EphemerisXmit* before = (i > 0)? list->Eph[i-1]: NULL;
+	EphemerisXmit* after = (list != NULL && i < list->Size)? list->Eph[i]: NULL;
+
+	if (before != NULL && !before->Valid(t)) before = NULL;
+	if (after != NULL && !after->Valid(t)) after = NULL;
+	if (before == NULL) return after;
+	if (after == NULL) return before;
+	return (after->t_oe - t < t - before->t_oe)? after: before;
+}
+
+
+
+EphemerisArchive::~EphemerisArchive()
+{
+	for (int s=0; s<MaxSats; s++) {
+		List* l = Lists[s];
+
+		// The latest list has all the ephemerides
+		if (l != NULL)
+			for (int32 i=0; i<l->Size; i++)
+				delete l->Eph[i];
+
+		while (l != NULL) {
+			List* older = l->Older;
+			delete[] l->Eph;
+			delete l;
+			l = older;
+		}
+	}
+}
+
+
+
+
+EphemerisArchived::EphemerisArchived(int sat, EphemerisArchive& archive)
+: Ephemeris(sat, "Archived Ephemeris"), Archive(archive)
+{
+}
+
+
+bool EphemerisArchived::SatPos(Time t, Position& XmitPos, double& Adjust)
+{
+	EphemerisXmit* x = Archive.Find(SatIndex, t);
+	if (x == NULL)
+		return Error("EphemerisArchive: no ephemeris for sat %d\n", SatIndex);
+	return x->SatPos(t, XmitPos, Adjust);
+}
+
+
+bool EphemerisArchived::SatState(Time t, Position& XmitPos, Position& Velocity, 
+                                 double& Adjust, double& Drift)
+{
+	EphemerisXmit* x = Archive.Find(SatIndex, t);
+	if (x == NULL)
+		return Error("EphemerisArchive: no ephemeris for sat %d\n", SatIndex);
+	return x->SatState(t, XmitPos, Velocity, Adjust, Drift);
+}
+
+
+bool EphemerisArchived::Valid(Time t)
+{
+	return Archive.Find(SatIndex, t) != NULL;
+}
+
+
+double EphemerisArchived::Accuracy(Time t)
+{
+	EphemerisXmit* x = Archive.Find(SatIndex, t);
+	return (x == NULL)? INFINITY: x->Accuracy(t);
+}
+
+
+EphemerisArchived::~EphemerisArchived()
+{
+}
@@ -0,0 +1,100 @@
+#ifndef EPHEMERISARCHIVE_INCLUDED
+#define EPHEMERISARCHIVE_INCLUDED
+// Part of Kinematic, a utility for GPS positioning
+//
+// Copyright (C) 2006  John Morris    www.precision-gps.org
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation, version 2.
+
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+
+
+
+
+#include "Util.h"
+#include "Ephemeris.h"
+#include "EphemerisXmit.h"
+#include "Thread.h"
+
+
+//////////////////////////////////////////////////////////////////////////////
+//
+// EphemerisArchive keeps every broadcast ephemeris it is given, rather 
+//   than just the latest one for each satellite. The ones for a satellite
+//   are kept in order of t_oe, and a lookup finds the one which is valid
+//   and closest to the time with a binary search.
+//
+// It is filled in by receivers as they decode ephemerides, whether from
+//   RTCM 1019 messages or nav frames (see RawReceiver::SetArchive), and
+//   from RINEX navigation files (see RinexNav.h).
+//
+// An ephemeris is never changed once it is in the archive. Adding one
+//   makes a new list for the satellite and publishes it with a single
+//   pointer store, so lookups don't take a lock and any number of threads
+//   may look things up while another adds to it. Adders take a lock
+//   between themselves. The old lists are kept until the archive goes away.
+//
+//////////////////////////////////////////////////////////////////////////////
+
+class EphemerisArchive;
+
+class EphemerisArchived: public Ephemeris
+{
+public:
+	EphemerisArchived(int sat, EphemerisArchive& archive);
+	virtual ~EphemerisArchived();
+	virtual bool SatPos(Time t, Position& XmitPos, double& Adjust);
+	virtual bool SatState(Time t, Position& XmitPos, Position& Velocity, 
+	                      double& Adjust, double& Drift);
+	virtual bool Valid(Time t);
+	virtual double Accuracy(Time t);
+
+private:
+	EphemerisArchive& Archive;
+};
+
+
+
+class EphemerisArchive: public Ephemerides
+{
+public:
+	EphemerisArchive();
+	virtual ~EphemerisArchive();
+
+	// Add a copy of an ephemeris. Ones we already have are ignored.
+	bool Add(EphemerisXmit& e);
+
+	// The ephemeris which is valid and closest to t. NULL if none.
+	EphemerisXmit* Find(int32 sat, Time t);
+	int32 Count(int32 sat);
+
+	virtual bool SatPosAll(Time t, bool valid[MaxSats], Position pos[MaxSats], double adjust[MaxSats]);
+
+private:
+	struct List
+	{
+		int32 Size;
+		EphemerisXmit** Eph;   // in order of t_oe
+		List* Older;           // the list this one replaced
+	};
+
+	List* volatile Lists[MaxSats];
+	Mutex Lock;                // held while adding a new list
+
+	List* Current(int32 sat);
+	static EphemerisXmit* Closest(List* list, Time t);
+	static int32 After(List* list, Time t);
+};
+
+
+#endif // EPHEMERISARCHIVE_INCLUDED
@@ -0,0 +1,252 @@
+// EphemerisComposite gets each satellite from the best of several sources
+//    Part of Kinematic, a utility for GPS positioning
+//
+// Copyright (C) 2006  John Morris    www.precision-gps.org
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation, version 2.
+
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+
+
+#include "EphemerisComposite.h"
+
+
+EphemerisComposite::EphemerisComposite(int sat, EphemeridesComposite& composite)
+: Ephemeris(sat, "Composite Ephemeris"), Composite(composite)
+{
+	ErrCode = OK;
+	Chosen = -1;
+	From = NULL;
+	ChosenAt = Until = 0;
+}
+
+
+
+inline bool EphemerisComposite::Current(Time t)
+// Is the last choice still good?
+{
+	if (t < ChosenAt || t >= Until)
+		return false;
+
+	for (int i=0; i<Composite.NrSources; i++) {
+		Ephemeris* e = Composite.Source[i]->eph[SatIndex];
+		if (e == NULL) continue;
+		if (e->MinTime != SourceMin[i] || e->MaxTime != SourceMax[i])
+			return false;
+	}
+
+	return From == NULL || From->Valid(t);
+}
+
+
+
+Ephemeris* EphemerisComposite::Choose(Time t)
+/////////////////////////////////////////////////////////////////////////
+// Pick the most accurate of the valid sources.
+//   Our own time range changes whenever the choice does, so anyone
+//   following us (eg. the anchors) knows to start over.
+/////////////////////////////////////////////////////////////////////////
+{
+	int32 best = -1;
+	double bestAcc = INFINITY;
+	bool changed = false;
+
+	for (int i=0; i<Composite.NrSources; i++) {
+		Ephemeris* e = Composite.Source[i]->eph[SatIndex];
+		if (e == NULL) continue;
+
+		// A new ephemeris for the one we were using is a change too
+		if (i == Chosen && (e->MinTime != SourceMin[i] || e->MaxTime != SourceMax[i]))
+			changed = true;
+		SourceMin[i] = e->MinTime;
+		SourceMax[i] = e->MaxTime;
+
+		if (!e->Valid(t)) continue;
+		double acc = e->Accuracy(t);
+		if (best == -1 || acc < bestAcc) {
+			best = i;  bestAcc = acc;
+		}
+	}
+
+	Ephemeris* e = (best == -1)? NULL: Composite.Source[best]->eph[SatIndex];
+	if (best != Chosen || e != From || changed) {
+		debug(2, "EphemerisComposite: sat %d from %s at %.0f\n", SatIndex,
+			(best == -1)? "nowhere": Composite.Name[best], GpsTow(t));
+		if (best != -1)
+			Composite.Chosen[best]++;
+		MinTime = t;
+		MaxTime = (e == NULL)? t: e->MaxTime;
+	}
+	Chosen = best;
+	From = e;
+
+	// Good until the next recheck, or until the ephemeris runs out
+	ChosenAt = t;
+	Until = t + Composite.Recheck;
+	if (e == NULL)
+		Until = t + 1;
+	else if (e->MaxTime > t)
+		Until = min(Until, e->MaxTime + 1);
+
+	// or until another source might become valid
+	for (int i=0; i<Composite.NrSources; i++) {
+		Ephemeris* o = Composite.Source[i]->eph[SatIndex];
+		if (o == NULL || i == best) continue;
+		if (o->MinTime > t)
+			Until = min(Until, o->MinTime);
+		else if (t <= o->MaxTime && !o->Valid(t))   // eg. near the edge of sp3 data
+			Until = min(Until, t + NsecPerSec);
+	}
+
+	return e;
+}
+
+
+
+bool EphemerisComposite::SatPos(Time t, Position& XmitPos, double& Adjust)
+{
+	Ephemeris* e = Current(t)? From: Choose(t);
+	if (e == NULL)
+		return Error("EphemerisComposite: no ephemeris for sat %d\n", SatIndex);
+	return e->SatPos(t, XmitPos, Adjust);
+}
+
+
+
+bool EphemerisComposite::SatState(Time t, Position& XmitPos, Position& Velocity,
+                                  double& Adjust, double& Drift)
+{
+	Ephemeris* e = Current(t)? From: Choose(t);
+	if (e == NULL)
+		return Error("EphemerisComposite: no ephemeris for sat %d\n", SatIndex);
+	return e->SatState(t, XmitPos, Velocity, Adjust, Drift);
+}
+
+
+
+bool EphemerisComposite::Valid(Time t)
+{
+	Ephemeris* e = Current(t)? From: Choose(t);
+	return e != NULL;
+}
+
+
+
+double EphemerisComposite::Accuracy(Time t)
+{
+	Ephemeris* e = Current(t)? From: Choose(t);
+	return (e == NULL)? INFINITY: e->Accuracy(t);
+}
+
+
+
+EphemerisComposite::~EphemerisComposite()
+{
+}
+
+
+
+
+EphemeridesComposite::EphemeridesComposite()
+{
+	NrSources = 0;
+	Recheck = 60*NsecPerSec;
+	for (int i=0; i<EphemerisComposite::MaxSources; i++)
+		Chosen[i] = 0;
+	for (int s=0; s<MaxSats; s++)
+		eph[s] = new EphemerisComposite(s, *this);
+}
+
+
+
+bool EphemeridesComposite::Add(Ephemerides& source, const char* name)
+{
+	if (NrSources >= EphemerisComposite::MaxSources)
+		return Error("EphemeridesComposite: no more than %d sources\n",
+		              EphemerisComposite::MaxSources);
+	Source[NrSources] = &source;
+	Name[NrSources] = name;
+	NrSources++;
+	return OK;
+}
+
+
+
+bool EphemeridesComposite::SatPosAll(Time t, bool valid[MaxSats], Position pos[MaxSats], double adjust[MaxSats])
+///////////////////////////////////////////////////////////////////////////
+// Pass each source the satellites it serves, so it can do them
+//   together in its own way.
+///////////////////////////////////////////////////////////////////////////
+{
+	bool want[EphemerisComposite::MaxSources][MaxSats];
+	int32 from[MaxSats];
+	for (int i=0; i<NrSources; i++)
+		for (int s=0; s<MaxSats; s++)
+			want[i][s] = false;
+
+	for (int s=0; s<MaxSats; s++) {
+		from[s] = -1;
+		if (!valid[s]) continue;
+		EphemerisComposite& c = *(EphemerisComposite*)eph[s];
+		valid[s] = c.Current(t) || c.Choose(t) != NULL;
+		if (!valid[s]) continue;
+		from[s] = c.Chosen;
+		want[c.Chosen][s] = true;
+	}
+
+	for (int i=0; i<NrSources; i++) {
+		int s;
+		for (s=0; s<MaxSats && !want[i][s]; s++)
+			;
+		if (s == MaxSats) continue;
+
+		if (Source[i]->SatPosAll(t, want[i], pos, adjust) != OK)
+			return Error();
+		for (s=0; s<MaxSats; s++)
+			if (from[s] == i) valid[s] = want[i][s];
+	}
+
+	return OK;
+}
+
+
+
+int32 EphemeridesComposite::SourceOf(int32 sat)
+{
+	return ((EphemerisComposite*)eph[sat])->Chosen;
+}
+
+
+const char* EphemeridesComposite::SourceName(int32 sat)
+{
+	int32 i = SourceOf(sat);
+	return (i == -1)? "none": Name[i];
+}
+
+
+
+void EphemeridesComposite::Display(const char* str)
+{
+	debug("EphemeridesComposite %s\n", str);
+	for (int i=0; i<NrSources; i++)
+		debug("   %-12s chosen %d times\n", Name[i], Chosen[i]);
+	for (int s=0; s<MaxSats; s++)
+		if (SourceOf(s) != -1)
+			debug("   sat %d from %s\n", s, SourceName(s));
+}
+
+
+
+EphemeridesComposite::~EphemeridesComposite()
+{
+}
@@ -0,0 +1,110 @@
+#ifndef EPHEMERISCOMPOSITE_INCLUDED
+#define EPHEMERISCOMPOSITE_INCLUDED
+// Part of Kinematic, a utility for GPS positioning
+//
+// Copyright (C) 2006  John Morris    www.precision-gps.org
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation, version 2.
+
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+
+
+
+
+#include "Util.h"
+#include "Ephemeris.h"
+
+
+//////////////////////////////////////////////////////////////////////////////
+//
+// EphemeridesComposite gets each satellite from the best of several
+//   sources, eg. an sp3 file, the base's broadcast ephemerides and
+//   the rover's. Of the sources which are valid, the one with the
+//   smallest Accuracy() wins, and ties go to the source added first.
+//
+// The choice is remembered for each satellite, so most of the time
+//   a position costs no more than going to the source directly.
+//   It is made again when
+//     - one of the sources picks up a new ephemeris for the satellite,
+//       or an sp3 file is read further along, which shows up as a
+//       change in its time range,
+//     - the chosen ephemeris runs out, or
+//     - Recheck has passed. A source may be invalid inside its range
+//       (eg. near the edge of the sp3 points read so far), so this
+//       catches it becoming valid.
+//
+//////////////////////////////////////////////////////////////////////////////
+
+class EphemeridesComposite;
+
+class EphemerisComposite: public Ephemeris
+{
+public:
+	EphemerisComposite(int sat, EphemeridesComposite& composite);
+	virtual ~EphemerisComposite();
+	virtual bool SatPos(Time t, Position& XmitPos, double& Adjust);
+	virtual bool SatState(Time t, Position& XmitPos, Position& Velocity,
+	                      double& Adjust, double& Drift);
+	virtual bool Valid(Time t);
+	virtual double Accuracy(Time t);
+
+	static const int MaxSources = 6;
+
+private:
+	EphemeridesComposite& Composite;
+	int32 Chosen;                 // which source, -1 if none is valid
+	Ephemeris* From;              // and its ephemeris for the satellite
+	Time ChosenAt, Until;         // the choice is good for this time
+	Time SourceMin[MaxSources];   // the sources' ranges when we chose
+	Time SourceMax[MaxSources];
+
+	bool Current(Time t);
+	Ephemeris* Choose(Time t);
+
+	friend class EphemeridesComposite;
+};
+
+
+
+class EphemeridesComposite: public Ephemerides
+{
+public:
+	EphemeridesComposite();
+	virtual ~EphemeridesComposite();
+
+	// Add a source. The name is for diagnostics.
+	bool Add(Ephemerides& source, const char* name);
+
+	virtual bool SatPosAll(Time t, bool valid[MaxSats], Position pos[MaxSats], double adjust[MaxSats]);
+
+	// Which source is serving a satellite, -1 if none
+	int32 SourceOf(int32 sat);
+	const char* SourceName(int32 sat);
+
+	// How many times each source was chosen, and a summary in the debug log
+	int32 Chosen[EphemerisComposite::MaxSources];
+	void Display(const char* str);
+
+	// Choose again at least this often
+	Time Recheck;
+
+private:
+	int32 NrSources;
+	Ephemerides* Source[EphemerisComposite::MaxSources];
+	const char* Name[EphemerisComposite::MaxSources];
+
+	friend class EphemerisComposite;
+};
+
+
+#endif // EPHEMERISCOMPOSITE_INCLUDED
@@ -28,6 +28,7 @@ EphemerisXmit::EphemerisXmit(int Sat, const char* description)
 {
       iode = -1;
       iodc = -1;
+      PreSqrtA = NAN;   // nothing precomputed yet
 }
 
 
@@ -40,76 +41,191 @@ bool EphemerisXmit::SatPos(Time xmitTime, Position& XmitPos, double& adjust)
 	if (!Valid(xmitTime))
 		return Error("Ephemeris is not valid\n");
 
-	// Calculate the satellite position, as described in ICD200.
-	
-	// Semi-major axis
-	double a = sqrt_a * sqrt_a;
-
-	// Computed mean motion (rad/sec)
-	double n_0 = sqrt(mu)/(a*sqrt_a);
-
-	// time from ephemeris reference epoch
-	double t = S(xmitTime - t_oe);
-
-	// corrected mean motion
-	double n = n_0 + delta_n;
-
-	// mean anomaly
-	double M = m_0 + n*t;
-
-	// Calculate E, Ecentric anomaly, using fix point of Kepler's equation
-	double E = M;
-	for (int i=0; i<20; i++) 
-		E = M + e*sin(E);
-
-	// True anomaly
-	double S_nu = sqrt(1-e*e) * sin(E) / (1 - e * cos(E));
-	double c_nu = (cos(E) - e) / (1 - e *cos(E));
-	double nu = atan2(S_nu, c_nu);
-	debug("  S_nu=%.6f  c_nu=%.6f  nu=%.6f\n", S_nu, c_nu, nu);
-
-	// argument of latitude
-	double phi = nu + omega;
-
-	// Second harmonic perturbations (latitude, radius, inclination)
-	double du = c_uc*cos(2*phi) + c_us*sin(2*phi);
-	double dr = c_rc*cos(2*phi) + c_rs*sin(2*phi);
-	double di = c_ic*cos(2*phi) + c_is*sin(2*phi);
-	debug("  du=%.6f  dr=%.6f  di=%.6f\n", du, dr, di);
-
-	// Corrected latitude, radius, inclination
-	double u = phi + du;
-	double r = a * (1 - e*cos(E)) + dr;
-	double i = i_0 + idot*t + di;
-	debug("  u=%.6f  r=%.6f  i=%.6f\n", u, r, i);
-
-	// Positions in orbital plane
-	double xdash = r * cos(u);
-	double ydash = r * sin(u);
-	debug("  xdash = %.3f  ydash=%.3f\n", xdash, ydash); 
-
-	// Corrected longitude of ascending node, including transit time
-	double omega_c = omega_0 - GpsTow(t_oe)*OmegaEDot 
-		           + (omegadot - OmegaEDot)*t;
-	debug("omega_c=%g  omega_0=%g  omegadot=%g  OmegaEDot=%g  t=%g Tow=%g\n",
-		omega_c, omega_0, omegadot, OmegaEDot, t, GpsTow(t));
-
-	debug("  ToW*OmegaEDot=%.3f  (O-Oe)*t=%.3f\n", GpsTow(t_oe)*OmegaEDot, (omegadot-OmegaEDot)*t);
-	
+	EphemerisXmit* self = this;
+	SatPosBatch(1, &self, xmitTime, &XmitPos, &adjust);
+	debug("EphemerisXmit::SatPos s=%d  XmitPos=(%.3f, %.3f, %.3f)  adjust=%g\n",
+		SatIndex, XmitPos.x, XmitPos.y, XmitPos.z, adjust);
+
+	return OK;
+}
+
+
+bool EphemerisXmit::SatState(Time xmitTime, Position& XmitPos, Position& Velocity,
+                             double& adjust, double& drift)
+{
+	if (!Valid(xmitTime))
+		return Error("Ephemeris is not valid\n");
+
+	EphemerisXmit* self = this;
+	SatPosBatch(1, &self, xmitTime, &XmitPos, &adjust, &Velocity, &drift);
+	debug("EphemerisXmit::SatState s=%d  Velocity=(%.3f, %.3f, %.3f)  drift=%g\n",
+		SatIndex, Velocity.x, Velocity.y, Velocity.z, drift);
+
+	return OK;
+}
+
+
+
+// Newton's method starting from M + e*sin(M) is good to 1e-9 after one
+//   step for GPS eccentricities (< .03), and to double precision after two.
+//   The third is a margin for unusual orbits.
+static const int KeplerSteps = 3;
+
+void EphemerisXmit::SatPosBatch(int n, EphemerisXmit* eph[], Time xmitTime,
+                                Position XmitPos[], double adjust[],
+                                Position Velocity[], double drift[])
+/////////////////////////////////////////////////////////////////////////////
+// Calculate the positions of several satellites at once, as described in ICD200.
+//   The ephemerides must be valid at the given time. 
+//   If Velocity is given, the velocities and clock drifts are calculated too, 
+//   by differentiating the same equations.
+//
+// The parameters are gathered into arrays, and each step of the calculation 
+//   is a simple loop across all the satellites, with no branches inside.
+/////////////////////////////////////////////////////////////////////////////
+{
+	// Do in groups which fit in our arrays
+	for (; n > MaxSats; n -= MaxSats, eph += MaxSats, XmitPos += MaxSats, adjust += MaxSats) {
+		SatPosBatch(MaxSats, eph, xmitTime, XmitPos, adjust, Velocity, drift);
+		if (Velocity != NULL) {Velocity += MaxSats; drift += MaxSats;}
+	}
+
+	double t[MaxSats], M[MaxSats], e[MaxSats], E[MaxSats];
+	double sinE[MaxSats], cosE[MaxSats], den[MaxSats];
+	double sin_2phi[MaxSats], cos_2phi[MaxSats];
+	double cos_u[MaxSats], sin_u[MaxSats], r[MaxSats], i[MaxSats], omega_c[MaxSats];
+	double cos_i[MaxSats], sin_i[MaxSats], cos_o[MaxSats], sin_o[MaxSats];
+	int j;
+
+	// Mean anomaly, with t the time from the ephemeris reference epoch
+	for (j=0; j<n; j++) {
+		EphemerisXmit& x = *eph[j];
+		x.CheckPrecomputed();
+		t[j] = S(xmitTime - x.t_oe);
+		M[j] = x.m_0 + x.N*t[j];
+		e[j] = x.e;
+	}
+
+	// Eccentric anomaly, solving Kepler's equation  M = E - e*sin(E)
+	for (j=0; j<n; j++)
+		E[j] = M[j] + e[j]*sin(M[j]);
+	for (int k=0; k<KeplerSteps; k++)
+		for (j=0; j<n; j++)
+			E[j] -= (E[j] - e[j]*sin(E[j]) - M[j]) / (1 - e[j]*cos(E[j]));
+	for (j=0; j<n; j++) {
+		sinE[j] = sin(E[j]);
+		cosE[j] = cos(E[j]);
+		den[j] = 1 - e[j]*cosE[j];
+	}
+
+	// Corrected argument of latitude, radius and inclination
+	for (j=0; j<n; j++) {
+		EphemerisXmit& x = *eph[j];
+
+		// True anomaly. 
+		double sin_nu = x.RootOneMinusE2 * sinE[j] / den[j];
+		double cos_nu = (cosE[j] - e[j]) / den[j];
+
+		// Argument of latitude, phi = nu + omega, and twice it.
+		double sin_phi = sin_nu*x.CosOmega + cos_nu*x.SinOmega;
+		double cos_phi = cos_nu*x.CosOmega - sin_nu*x.SinOmega;
+		sin_2phi[j] = 2*sin_phi*cos_phi;
+		cos_2phi[j] = cos_phi*cos_phi - sin_phi*sin_phi;
+
+		// Second harmonic perturbations (latitude, radius, inclination)
+		double du = x.c_uc*cos_2phi[j] + x.c_us*sin_2phi[j];
+		double dr = x.c_rc*cos_2phi[j] + x.c_rs*sin_2phi[j];
+		double di = x.c_ic*cos_2phi[j] + x.c_is*sin_2phi[j];
+
+		// u = phi + du
+		cos_u[j] = cos_phi*cos(du) - sin_phi*sin(du);
+		sin_u[j] = sin_phi*cos(du) + cos_phi*sin(du);
+		r[j] = x.A * den[j] + dr;
+		i[j] = x.i_0 + x.idot*t[j] + di;
+
+		// Corrected longitude of ascending node, including transit time
+		omega_c[j] = x.OmegaToe + x.OmegaRate*t[j];
+	}
+
 	// Earth fixed coordinates
-	XmitPos.x = xdash*cos(omega_c) - ydash*cos(i)*sin(omega_c);
-	XmitPos.y = xdash*sin(omega_c) + ydash*cos(i)*cos(omega_c);
-	XmitPos.z = ydash*sin(i);
+	for (j=0; j<n; j++) {
+		double xdash = r[j] * cos_u[j];
+		double ydash = r[j] * sin_u[j];
+		cos_i[j] = cos(i[j]);  sin_i[j] = sin(i[j]);
+		cos_o[j] = cos(omega_c[j]);  sin_o[j] = sin(omega_c[j]);
+		XmitPos[j].x = xdash*cos_o[j] - ydash*cos_i[j]*sin_o[j];
+		XmitPos[j].y = xdash*sin_o[j] + ydash*cos_i[j]*cos_o[j];
+		XmitPos[j].z = ydash*sin_i[j];
+	}
 
 	// Clock adjustment
-	double tc = S(xmitTime - t_oc);
-     double adjustClock = (  (a_f2 * tc) + a_f1 ) * tc + a_f0;
-	double adjustRelativity = RelativisticConstant * e * sqrt_a * sin(E);
-	adjust = adjustClock + adjustRelativity - t_gd;
-	debug("adjustclock=%g  adjustRelativity=%g t_gd=%g adjust=%g\n",
-		adjustClock,adjustRelativity,t_gd, adjust);
-	
-	return OK;
+	for (j=0; j<n; j++) {
+		EphemerisXmit& x = *eph[j];
+		double tc = S(xmitTime - x.t_oc);
+		double adjustClock = (  (x.a_f2 * tc) + x.a_f1 ) * tc + x.a_f0;
+		double adjustRelativity = x.Relativity * sinE[j];
+		adjust[j] = adjustClock + adjustRelativity - x.t_gd;
+	}
+
+	if (Velocity == NULL) return;
+
+	// Velocity, by differentiating each of the above with respect to time
+	for (j=0; j<n; j++) {
+		EphemerisXmit& x = *eph[j];
+
+		// Rates of the eccentric and true anomalies
+		double Edot = x.N / den[j];
+		double phidot = x.RootOneMinusE2 * Edot / den[j];
+
+		// Rates of the corrected latitude, radius and inclination
+		double udot = phidot * (1 + 2*(x.c_us*cos_2phi[j] - x.c_uc*sin_2phi[j]));
+		double rdot = x.A*e[j]*sinE[j]*Edot 
+			        + 2*phidot*(x.c_rs*cos_2phi[j] - x.c_rc*sin_2phi[j]);
+		double idot = x.idot + 2*phidot*(x.c_is*cos_2phi[j] - x.c_ic*sin_2phi[j]);
+
+		// Position and velocity in the orbital plane
+		double xdash = r[j] * cos_u[j];
+		double ydash = r[j] * sin_u[j];
+		double xdashdot = rdot*cos_u[j] - ydash*udot;
+		double ydashdot = rdot*sin_u[j] + xdash*udot;
+
+		// Earth fixed velocity. The node turns at OmegaRate.
+		Velocity[j].x = xdashdot*cos_o[j] - ydashdot*cos_i[j]*sin_o[j]
+			          + ydash*sin_i[j]*sin_o[j]*idot - XmitPos[j].y*x.OmegaRate;
+		Velocity[j].y = xdashdot*sin_o[j] + ydashdot*cos_i[j]*cos_o[j]
+			          - ydash*sin_i[j]*cos_o[j]*idot + XmitPos[j].x*x.OmegaRate;
+		Velocity[j].z = ydashdot*sin_i[j] + ydash*cos_i[j]*idot;
+
+		// Clock drift
+		double tc = S(xmitTime - x.t_oc);
+		drift[j] = x.a_f1 + 2*x.a_f2*tc + x.Relativity*cosE[j]*Edot;
+	}
+}
+
+
+
+void EphemerisXmit::Precompute()
+/////////////////////////////////////////////////////////////////////
+// Calculate the parts of the orbit which don't depend on time
+/////////////////////////////////////////////////////////////////////
+{
+	// Semi-major axis and corrected mean motion (rad/sec)
+	A = sqrt_a * sqrt_a;
+	N = sqrt(mu)/(A*sqrt_a) + delta_n;
+
+	RootOneMinusE2 = sqrt(1 - e*e);
+	CosOmega = cos(omega);
+	SinOmega = sin(omega);
+
+	// Longitude of ascending node. The earth's rotation since the start of the week
+	OmegaToe = omega_0 - GpsTow(t_oe)*OmegaEDot;
+	OmegaRate = omegadot - OmegaEDot;
+
+	Relativity = RelativisticConstant * e * sqrt_a;
+
+	// Remember what the constants came from
+	PreSqrtA = sqrt_a;  PreE = e;  PreDeltaN = delta_n;  PreOmega = omega;
+	PreOmega0 = omega_0;  PreOmegaDot = omegadot;  PreToe = t_oe;
 }
 
 
@@ -125,23 +241,24 @@ bool EphemerisXmit::FromRaw(EphemerisXmitRaw& r)
     omega_0 = r.omega_0 / p2(31) * PI;
     i_0 = r.i_0 / p2(31) * PI;
     omega = r.omega / p2(31) * PI;
-    omegadot = r.omegadot / p2(23) * PI;
-    idot = r.idot / p2(43);
+    omegadot = r.omegadot / p2(43) * PI;
+    idot = r.idot / p2(43) * PI;
     c_uc = r.c_uc / p2(29);
     c_us = r.c_us / p2(29);
     c_rc = r.c_rc / p2(5);
     c_rs = r.c_rs / p2(5);
     c_ic = r.c_ic / p2(29);
-    c_is = r.c_is / p2(31);  // verify
+    c_is = r.c_is / p2(29);
     t_oe = ConvertGpsTime(r.wn, r.t_oe * p2(4));
     iode = r.iode;
 
     // Get the clock parameters
     t_gd = r.t_gd / p2(31);
-    t_oc = ConvertGpsTime(r.wn, r.t_oc * p2(5));
-    a_f0 = r.a_f0 / p2(55);
+    t_oc = ConvertGpsTime(r.wn, r.t_oc * p2(4));
+    a_f0 = r.a_f0 / p2(31);
     a_f1 = r.a_f1 / p2(43);
-    a_f2 = r.a_f2 / p2(31);
+    a_f2 = r.a_f2 / p2(55);
+    iodc = r.iodc;
 
     health = r.health;
     acc = SvaccToAcc(r.acc);
@@ -149,6 +266,7 @@ bool EphemerisXmit::FromRaw(EphemerisXmitRaw& r)
 
     MinTime = t_oe - 2*NsecPerHour;
     MaxTime = t_oe + 2*NsecPerHour;
+    Precompute();
 
     debug("  r.omegadot=%d\n", r.omegadot);
     Display("From Raw");
@@ -166,24 +284,25 @@ bool EphemerisXmit::ToRaw(EphemerisXmitRaw& r)
     r.omega_0 = omega_0 * p2(31) / PI;
     r.i_0 = i_0 * p2(31) / PI;
     r.omega = omega * p2(31) / PI;
-    r.omegadot = omegadot * p2(23) / PI;
-    r.idot = idot * p2(43);
+    r.omegadot = omegadot * p2(43) / PI;
+    r.idot = idot * p2(43) / PI;
     r.c_uc = c_uc * p2(29);
     r.c_us = c_us * p2(29);
     r.c_rc = c_rc * p2(5);
     r.c_rs = c_rs * p2(5);
     r.c_ic = c_ic * p2(29);
-    r.c_is = c_is * p2(31); 
+    r.c_is = c_is * p2(29);
     r.wn = GpsWeek(t_oe);
     r.t_oe = GpsTow(t_oe) / p2(4);
     r.iode = iode;
 
     // Get the clock parameters
     r.t_gd = t_gd * p2(31);
-    r.t_oc = GpsTow(t_oc) / p2(5);
-    r.a_f0 = a_f0 * p2(55);
+    r.t_oc = GpsTow(t_oc) / p2(4);
+    r.a_f0 = a_f0 * p2(31);
     r.a_f1 = a_f1 * p2(43);
-    r.a_f2 = a_f2 * p2(31);
+    r.a_f2 = a_f2 * p2(55);
+    r.iodc = iodc;
 
     r.health = health;
     r.acc = AccToSvacc(acc);
@@ -41,6 +41,11 @@ public:
     bool AddFrame(NavFrame& f);
 
     bool SatPos(Time t, Position& satpos, double& adjust);
+    bool SatState(Time t, Position& satpos, Position& velocity, 
+                  double& adjust, double& drift);
+    static void SatPosBatch(int n, EphemerisXmit* eph[], Time t, 
+                            Position satpos[], double adjust[],
+                            Position velocity[]=NULL, double drift[]=NULL);
 
     void Display(const char* title="");
 
@@ -55,6 +60,30 @@ protected:
     double SvaccToAcc(int svacc);
     int AccToSvacc(double acc);
 
+    // Constants which depend only on the orbit parameters. 
+    //   Some receivers fill in the parameters directly rather than through
+    //   FromRaw, so we also recalculate when the parameters don't match.
+    double A;              // semi-major axis
+    double N;              // corrected mean motion
+    double RootOneMinusE2; // sqrt(1-e*e)
+    double CosOmega;       // argument of perigee
+    double SinOmega;
+    double OmegaToe;       // longitude of ascending node at t_oe, earth fixed
+    double OmegaRate;      // omegadot - OmegaEDot
+    double Relativity;     // relativistic clock correction / sin(E)
+    double PreSqrtA, PreE, PreDeltaN, PreOmega, PreOmega0, PreOmegaDot;
+    Time   PreToe;
+    friend class EphemerisArchive;   // precomputes its copies
+
+    void Precompute();
+    inline void CheckPrecomputed() 
+    {
+        if (sqrt_a != PreSqrtA || e != PreE || delta_n != PreDeltaN 
+         || omega != PreOmega || omega_0 != PreOmega0 
+         || omegadot != PreOmegaDot || t_oe != PreToe)
+            Precompute();
+    }
+
 };
 
     static const double AccuracyIndex[16] = {2.4, 3.4, 4.85, 6.85, 9.65, 
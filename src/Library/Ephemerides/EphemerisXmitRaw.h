@@ -15,7 +15,7 @@ struct EphemerisXmitRaw
     int32  omegadot;   // 2^-43  semicircles/sec
     int16  idot;       // 2^-43  semicircles/sec
     int16  c_uc;       // 2^-29  radians
-    int16  c_us;       // 2^-23  radians
+    int16  c_us;       // 2^-29  radians
     int16  c_rc;       // 2^-5   meters
     int16  c_rs;       // 2^-5   meters
     int16  c_ic;       // 2^-29  radians
@@ -27,9 +27,9 @@ struct EphemerisXmitRaw
     uint8 iodc;
     int8   t_gd;       // 2^-31   seconds
     uint16 t_oc;       // 2^4    seconds
-    int8  a_f0;        // 2^-55 
-    int16 a_f1;        // 2^-43
-    int32 a_f2;        // 2^-31
+    int32 a_f0;        // 2^-31  seconds
+    int16 a_f1;        // 2^-43  sec/sec
+    int8  a_f2;        // 2^-55  sec/sec^2
       
     uint8  health;
     uint8  acc;  // TODO: check these out!!!
@@ -18,8 +18,8 @@
 // Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
 
 
-// NOTE: This should change to only keep a small number of reference points
-//   in memory. The SP3 file which uses it should read new data as needed.
+// NOTE: Only the points needed near the current time have to be in memory.
+//   Callers reading data as needed can add new points and drop old ones.
 
 #include "util.h"
 #include "Interpolator.h"
@@ -43,75 +43,159 @@ Interpolator<Xt,Yt>::~Interpolator()
 
 
 /////////////////////////////////////////////////////////////////
-// Interpolate using a polynomial of degree n-1
+// Interpolate, and also find the slope of the polynomial at X.
 //
-// This code is based on Neville's algorithm as described in
-//    "Numerical Recipes in C: The Art of Scientific Computing".
-//    The code has been rearranged so it computes a succession
-//    of interpolated values based on increasing degrees
-//    of polynomials, adding one datapoint at a time. If the data values 
-//    are sorted by their proximity to X,
-//    then the c[0]'s at each step should give an indication of the error.
+// This is Neville's algorithm in its direct form, where p[i] is the
+//   polynomial through points i..i+m. Differentiating each step gives
+//   the slopes alongside.
 //
 
 template<typename Tx, typename Ty>
-void Interpolator<Tx,Ty>::Interpolate(int32 n, Tx* x, Ty* y, Tx X, Ty& Y)
+void Interpolator<Tx,Ty>::Interpolate(int32 n, Tx* x, Ty* y, Tx X, Ty& Y, Ty& dYdX)
 {
-    Ty c[50], d[50];   // n must be <= 50, or dynamically allocate.
+    Ty p[50], dp[50];   // n must be <= 50, or dynamically allocate.
 
-	// Make an initial guess for the interpolated value (zero)
-	Y = Ty(0);
+	for (int i=0; i<n; i++) {
+		p[i] = y[i];
+		dp[i] = Ty(0);
+	}
 
 	// do for increasing order of polynomials
-	for (int order = 0; order < n; order++){
+	for (int m=1; m<n; m++) {
+		for (int i=0; i<n-m; i++) {
+			double a = X - x[i+m];
+			double b = x[i] - X;
+			double h = x[i] - x[i+m];
+			dp[i] = (p[i] - p[i+1] + dp[i]*a + dp[i+1]*b) / h;
+			p[i] = (p[i]*a + p[i+1]*b) / h;
+		}
+	}
 
-		// Add the next data point to interpolation
-		d[order] = c[order] = y[order];
+	Y = p[0];
+	dYdX = dp[0];
+}
 
-		// update the diagonal row of polynomial calculations
-		for (int i = order-1; i>=0; i--) {
 
-			Ty m = (c[i+1] - d[i]) / (x[i] - x[order]);
-			c[i] = (x[i]     - X) * m;
-			d[i] = (x[order] - X) * m;
-		}
 
-		// update the interpolated value 
-		Y = Y + c[0];
-	}
-}
 
+template<typename Xt, typename Yt>
+bool Interpolator<Xt,Yt>::GetY(Xt x, Yt& y, Yt& dydx)
+{
+	// Choose points
+	int32 i, n;
+	if (Choose(x, i, n))
+		return Error("Interpolator::GetY - X value out of range");
 
+	// Do the interpolation
+	Interpolate(n, &Xv[i], &Yv[i], x, y, dydx);
+
+	return OK;
+}
 
 
 
 template<typename Xt, typename Yt>
 bool Interpolator<Xt,Yt>::GetY(Xt x, Yt& y)
+{
+	InterpolatorWeights<Xt> w;
+	if (GetWeights(x, w) != OK)
+		return Error();
+
+	GetY(w, y);
+	return OK;
+}
+
+
+
+/////////////////////////////////////////////////////////////////
+// Find the weights for interpolating at x, using a polynomial of degree n-1
+//
+// This is the barycentric form of Lagrange interpolation. With equally 
+//   spaced points, the barycentric weights are just the binomial 
+//   coefficients with alternating signs, so the whole job is
+//   one pass over the points. The value is then a weighted sum,
+//   and the same weights work for any data on the same points.
+//
+
+template<typename Xt, typename Yt>
+bool Interpolator<Xt,Yt>::GetWeights(Xt x, InterpolatorWeights<Xt>& w)
 {
 	// Choose points
 	int32 i, n;
 	if (Choose(x, i, n))
-		return Error("Interpolator::GetY - X value out of range");
+		return Error("Interpolator::GetWeights - X value out of range");
+
+	w.X = x;
+	w.First = Xv[i];
+	w.Step = (n > 1)? Xv[1] - Xv[0]: 1;
+	w.n = n;
+
+	// Case: right on a point. Take it as is.
+	Xt offset = x - w.First;
+	if (offset % w.Step == 0) {
+		for (int32 k=0; k<n; k++)
+			w.L[k] = 0;
+		w.L[offset/w.Step] = 1;
+		return OK;
+	}
 
-	// Do the interpolation
-	Interpolate(n, &Xv[i], &Yv[i], x, y);
+	// Position of x, measured in steps from the first point
+	double u = (double)offset / (double)w.Step;
+
+	// L[k] = b[k]/(u-k) / sum(b[j]/(u-j)),  b[k] = (-1)^k (n-1 choose k)
+	double b = 1, sum = 0;
+	for (int32 k=0; k<n; k++) {
+		w.L[k] = b / (u - k);
+		sum += w.L[k];
+		b = -b * (n-1-k) / (k+1);
+	}
+	for (int32 k=0; k<n; k++)
+		w.L[k] /= sum;
 
 	return OK;
 }
 
 
 
+template<typename Xt, typename Yt>
+bool Interpolator<Xt,Yt>::SameGrid(InterpolatorWeights<Xt>& w)
+// Do the weights fit our points? 
+{
+	int32 size = Xv.size();
+	if (size < w.n || w.First < Xv[0])  return false;
+	if (size > 1 && Xv[1] - Xv[0] != w.Step)  return false;
+	if ((w.First - Xv[0]) % w.Step != 0)  return false;
+
+	int32 i = (w.First - Xv[0]) / w.Step;
+	return i + w.n <= size;
+}
+
+
+
+template<typename Xt, typename Yt>
+void Interpolator<Xt,Yt>::GetY(InterpolatorWeights<Xt>& w, Yt& y)
+// Interpolate with weights which fit our points
+{
+	int32 i = (w.First - Xv[0]) / w.Step;
+	y = Yv[i] * w.L[0];
+	for (int32 k=1; k<w.n; k++)
+		y = y + Yv[i+k] * w.L[k];
+}
+
+
+
 template<typename Xt, typename Yt>
 bool Interpolator<Xt,Yt>::Choose(Xt x, int32& i, int32& n)
 {
 	size_t size = Xv.size();
+	if (size == 0)
+		return Error();
 
-	// Find closest points -- Good enough for now, but may want to fix.
-	// (direct lookup since intervals are equal)
-	i = (x - Xv[0]) / (Xv[1] - Xv[0]);
+	// Find the closest point directly, since intervals are equal
+	i = (size < 2)? 0: (x - Xv[0]) / (Xv[1] - Xv[0]);
 
     // Choose points around the nearest point
-	n = 10;
+	n = NrPoints;
 	i = i-n/2;
 
     // Adjust if any points are out of bounds
@@ -145,6 +229,25 @@ bool Interpolator<Xt,Yt>::SetY(Xt x, Yt y)
 }
 
 
+template<typename Xt, typename Yt>
+void Interpolator<Xt,Yt>::DropBefore(Xt x)
+// Forget the points before x
+{
+	size_t i;
+	for (i=0; i<Xv.size() && Xv[i] < x; i++)
+		;
+	Xv.erase(Xv.begin(), Xv.begin()+i);
+	Yv.erase(Yv.begin(), Yv.begin()+i);
+}
+
+
+template<typename Xt, typename Yt>
+void Interpolator<Xt,Yt>::Clear()
+{
+	Xv.clear(); Yv.clear();
+}
+
+
 // Instantiate for the cases we know we're going to use
 template class Interpolator<Time, Position>;
 template class Interpolator<Time, Time>;
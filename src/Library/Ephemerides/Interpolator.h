@@ -25,6 +25,23 @@
 using namespace std;
 
 
+//////////////////////////////////////////////////////////////////////
+// The Lagrange weights for interpolating at X from n equally spaced
+//   points starting at First. They depend only on the spacing, so 
+//   one set serves every Interpolator with the same points.
+//////////////////////////////////////////////////////////////////////
+template<typename Tx>
+struct InterpolatorWeights
+{
+	static const int32 MaxPoints = 50;
+	Tx X;
+	Tx First;
+	Tx Step;
+	int32 n;
+	double L[MaxPoints];
+};
+
+
 template<typename Tx, typename Ty>
 class Interpolator
 {
@@ -32,14 +49,23 @@ public:
 	Interpolator();
 	virtual ~Interpolator();
 	bool GetY(Tx x, Ty& y);
+	bool GetY(Tx x, Ty& y, Ty& dydx);
 	bool SetY(Tx x, Ty y);
+	void DropBefore(Tx x);
+	void Clear();
+
+	static const int32 NrPoints = 10;  // points used for each interpolation
+
+	bool GetWeights(Tx x, InterpolatorWeights<Tx>& w);
+	bool SameGrid(InterpolatorWeights<Tx>& w);
+	void GetY(InterpolatorWeights<Tx>& w, Ty& y);
 
 private:
 	vector<Tx> Xv;
 	vector<Ty> Yv;
 
 	bool Choose(Tx x, int32& i, int32& n);
-    void Interpolate(int32 n, Tx* x, Ty* y, Tx X, Ty& Y);
+    void Interpolate(int32 n, Tx* x, Ty* y, Tx X, Ty& Y, Ty& dYdX);
 };
 
 
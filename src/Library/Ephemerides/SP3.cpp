@@ -29,62 +29,265 @@ bool SkipLine(FILE* f);
 //    sp3 files contain satellite position and clock adjustment data for 
 //    each gps satellite, updated every 15 minutes.
 //
-// Note: This code reads the entire ephemeris file and stores it in memory
-//   In practice, the data is used in time order, so it would make sense
-//   to read the sp3 data only as needed. Get rid on the unnecesary array.
+// The data is used in time order, so the file is read only as needed.
+//   Each satellite keeps the points around the current time, so memory 
+//   depends on the interpolation order rather than the length of the file.
+//   Going back to an earlier time means reading the file over again.
+//
+// The first time a file is used, it is parsed in full and saved in binary
+//   (see SP3Cache). After that, the points come from the binary copy.
+//   If the copy can't be saved, the text is read as it is needed.
 //////////////////////////////////////////////////////////////////////
 
 
+// How many points on either side of the current time we need.
+//   We keep twice as many behind, so times can back up a little.
+static const int32 NrPoints = Interpolator<Time,Position>::NrPoints;
+static const int32 Margin = NrPoints/2 + 1;
+
 
 SP3::SP3(const char* name)
 {
 	for (int s=0; s<MaxSats; s++)
-		eph[s] = new EphemerisInterpolated(s);
+		eph[s] = new EphemerisInterpolated(s, "SP3 Ephemeris", this);
+	In = NULL;
+	Cache = NULL;
 	ErrCode = Open(name);
 }
 
 
 SP3::~SP3()
 {
+	if (In != NULL)
+		delete In;
+	if (Cache != NULL)
+		delete Cache;
 }
 
 bool SP3::Open(const char* name)
 {
-	InputFile in(name);
+	strncpy(FileName, name, sizeof(FileName)-1);
+	FileName[sizeof(FileName)-1] = '\0';
+
+	// Use the binary copy, making one if needed. Otherwise read the text.
+	Cache = new SP3Cache;
+	if (Cache->Map(FileName) != OK && BuildCache() != OK) {
+		delete Cache;
+		Cache = NULL;
+		ClearError();   // the text will do
+	}
+
+	return Restart();
+}
+
+
+bool SP3::BuildCache()
+/////////////////////////////////////////////////////////////////////////
+// Parse the whole sp3 file into the cache, save it, and map the saved
+//   copy. If it can't be saved, fail, so the text is read as needed
+//   rather than the whole file kept in memory.
+/////////////////////////////////////////////////////////////////////////
+{
+	MmapInputFile in(FileName, true);
 	if (in.GetError())
-		return Error("Can't open Sp3 Ephemeris file %s", name);
+		return Error();
+
+	// Read all the points, numbering the epochs
+	struct Record {int32 epoch; int32 sat; Position pos; double adjust;};
+	vector<Record> records;
+	vector<Time> epochs;
+	Record r; Time t;
+	while (ReadPos(in, t, r.sat, r.pos, r.adjust) == OK) {
+		if (epochs.empty() || t != epochs.back())
+			epochs.push_back(t);
+		r.epoch = epochs.size() - 1;
+		records.push_back(r);
+	}
+
+	// The cache needs evenly spaced epochs
+	if (epochs.size() < 2)
+		return Error();
+	Time step = epochs[1] - epochs[0];
+	for (size_t i=1; i<epochs.size(); i++)
+		if (epochs[i] - epochs[i-1] != step) {
+			debug("SP3: %s has uneven epochs, so it won't be cached\n", FileName);
+			return Error();
+		}
+
+	if (Cache->Create(FileName, epochs.size(), epochs[0], step) != OK)
+		return Error();
+	for (size_t i=0; i<records.size(); i++)
+		Cache->Set(records[i].epoch, records[i].sat, records[i].pos, records[i].adjust);
+
+	if (Cache->Save() != OK) {
+		debug("SP3: couldn't save the cache of %s\n", FileName);
+		return Error();
+	}
+
+	// Use the saved copy, and let the one in memory go
+	SP3Cache* saved = new SP3Cache;
+	if (saved->Map(FileName) != OK) {
+		delete saved;
+		return Error();
+	}
+	delete Cache;
+	Cache = saved;
+
+	return OK;
+}
+
 
-	// Do for each satellite position record
-	Time time; double Adjust;  Position pos; int32 s;
-	while (ReadPos(in, time, s, pos, Adjust) == OK) {
-		//debug("sp3;  sat=%d  time=%.0f\n", s, S(time));
+bool SP3::Restart()
+// Start reading the file from the beginning
+{
+	if (Cache != NULL) {
+		CacheEpoch = 0;
+		CacheSat = 0;
+	} else {
+		if (In != NULL)
+			delete In;
+		In = new MmapInputFile(FileName);
+		if (In->GetError())
+			return Error("Can't open Sp3 Ephemeris file %s", FileName);
+	}
+
+	for (int s=0; s<MaxSats; s++)
+		((EphemerisInterpolated*)eph[s])->Clear();
+	Eof = false;
+	LastTime = -1;
+	Step = 0;
+	WindowStart = 0;
+
+	return OK;
+}
+
+
+
+bool SP3::Advance(Time t)
+///////////////////////////////////////////////////////////////////////////
+// Make sure we have the points needed to interpolate at time t.
+///////////////////////////////////////////////////////////////////////////
+{
+	// If we've already dropped the points we need, start over
+	if (WindowStart > 0 && t < WindowStart + Margin*Step)
+		if (Restart() != OK)
+			return Error();
+
+	// Read until we are far enough past t, or past the first full set of
+	//   points near the start. (A later record means those epochs are complete)
+	while (!Eof && (Step == 0 || LastTime <= t + Margin*Step
+	                   || LastTime <= FirstTime + NrPoints*Step)) {
+
+		Time time; double Adjust;  Position pos; int32 s;
+		if (NextRecord(time, s, pos, Adjust) != OK) {
+			Eof = true;
+			break;
+		}
+
+		// Starting a new epoch. Drop what we no longer need.
+		if (time != LastTime) {
+			if (LastTime == -1)
+				FirstTime = time;
+			else if (Step == 0)
+				Step = time - LastTime;
+			LastTime = time;
+			Forget(t);
+		}
 
 		// Add information to interpolator
 		((EphemerisInterpolated*)eph[s])->AddSatPos(time, pos, Adjust);
 	}
 
-	//for (int32 s=0; s<MaxSats; s++)
-	//	debug(4, "sp3: s=%d  MinTime=%.0f MaxTime=%.0f\n", s,eph[s]->MinTime, eph[s]->MaxTime);
+	Forget(t);
+	return OK;
+}
+
+
+void SP3::Forget(Time t)
+// Drop the points too far behind time t to be needed
+{
+	if (Step == 0) return;
+
+	Time start = t - 2*Margin*Step;
+	if (start < WindowStart + Step) return;
+
+	WindowStart = start;
+	for (int s=0; s<MaxSats; s++)
+		((EphemerisInterpolated*)eph[s])->DropBefore(WindowStart);
+}
+
+
+
+bool SP3::SatPosAll(Time t, bool valid[MaxSats], Position pos[MaxSats], double adjust[MaxSats])
+///////////////////////////////////////////////////////////////////////////
+// Find the positions of all the satellites at once.
+//   The satellites are normally listed at the same times, so the 
+//   interpolation weights are found once and used for all of them.
+///////////////////////////////////////////////////////////////////////////
+{
+	if (Advance(t) != OK)
+		return Error();
+
+	InterpolatorWeights<Time> w;
+	bool HaveWeights = false;
+
+	for (int s=0; s<MaxSats; s++) {
+		if (!valid[s]) continue;
+		EphemerisInterpolated& e = *(EphemerisInterpolated*)eph[s];
+		valid[s] = e.Valid(t);
+		if (!valid[s]) continue;
+
+		// Get the weights from the first satellite
+		if (!HaveWeights)
+			HaveWeights = e.GetWeights(t, w) == OK;
+
+		// Use them if they fit. Otherwise, the satellite must do its own.
+		if (HaveWeights && e.SameGrid(w))
+			e.SatPos(w, pos[s], adjust[s]);
+		else if (e.SatPos(t, pos[s], adjust[s]) != OK)
+			return Error();
+	}
 
 	return OK;
 }
 
-bool SP3::ReadPos(InputFile& in, Time& t, int32& sat, Position& p, double &Adjust)
+
+
+bool SP3::NextRecord(Time& t, int32& sat, Position& p, double& Adjust)
+// Get the next point, from the cache or the text
 {
-	// Repeat until a position record was read
-	char line[256];
-	while (!in.ReadLine(line)) {
+	if (Cache == NULL)
+		return ReadPos(*In, t, sat, p, Adjust);
+
+	for (; CacheEpoch < Cache->NrEpochs; CacheEpoch++, CacheSat = 0)
+		for (; CacheSat < MaxSats; CacheSat++)
+			if (Cache->Get(CacheEpoch, CacheSat, p, Adjust)) {
+				t = Cache->FirstTime + CacheEpoch*Cache->Step;
+				sat = CacheSat++;
+				return OK;
+			}
+
+	return Error();  // end of data
+}
+
 
 
+bool SP3::ReadPos(MmapInputFile& in, Time& t, int32& sat, Position& p, double &Adjust)
+{
+	// Repeat until a position record was read. The lines are parsed in place.
+	const char* line; size_t n;
+	while (!in.NextLine(line, n)) {
+		int len = (int)n;
+
 		// Case: Position. Return position data.
-		if (match(line, 0, "P")) {
+		if (match(line, len, 0, "P")) {
 
 			// Read the satellite data
-			p.x = GetDouble(line, 4, 14) * 1000;
-			p.y = GetDouble(line, 18, 14) * 1000;
-			p.z = GetDouble(line, 32, 14) * 1000;
-			Adjust = GetDouble(line, 46, 14) / 1000000;
-			int svid = ParseSvid(line, 1);
+			p.x = GetDouble(line, len, 4, 14) * 1000;
+			p.y = GetDouble(line, len, 18, 14) * 1000;
+			p.z = GetDouble(line, len, 32, 14) * 1000;
+			Adjust = GetDouble(line, len, 46, 14) / 1000000;
+			int svid = ParseSvid(line, len, 1);
 			sat = SvidToSat(svid);
 			debug(5, "svid=%d s=%d  p=(%.3f, %.3f, %.3f)  a=%.9f\n",svid,sat,p.x,p.y,p.z,Adjust);
 			if (sat == -1)
@@ -98,17 +301,17 @@ bool SP3::ReadPos(InputFile& in, Time& t, int32& sat, Position& p, double &Adjus
 		}
 
 		// Case: Time. Update GpsTime
-		else if (match(line, 0, "*")) {
+		else if (match(line, len, 0, "*")) {
 
 			// Read the time information
 			int32 year, month, day, hour, min, sec, nsec;
-			year = GetInt(line, 3, 4);
-			month = GetInt(line, 8, 2);
-			day = GetInt(line, 11, 2);
-			hour = GetInt(line, 14, 2);
-			min = GetInt(line, 17, 2);
-			sec = GetInt(line, 20, 2);
-			nsec = GetInt(line, 23, 8);
+			year = GetInt(line, len, 3, 4);
+			month = GetInt(line, len, 8, 2);
+			day = GetInt(line, len, 11, 2);
+			hour = GetInt(line, len, 14, 2);
+			min = GetInt(line, len, 17, 2);
+			sec = GetInt(line, len, 20, 2);
+			nsec = GetInt(line, len, 23, 8);
 
 			// Convert to Time
 			GpsTime = DateToTime(year, month, day) 
@@ -132,17 +335,21 @@ bool SP3::ReadPos(InputFile& in, Time& t, int32& sat, Position& p, double &Adjus
 
 
 
-EphemerisInterpolated::EphemerisInterpolated(int Sat, const char* description)
+EphemerisInterpolated::EphemerisInterpolated(int Sat, const char* description, SP3* source)
 :Ephemeris(Sat, description)
 {
 	acc = 1.0;
     MinTime = -1;
     MaxTime = -1;
 	Description = "SP3 Ephemeris";
+	Source = source;
 }
 
 bool EphemerisInterpolated::Valid(Time t)
 {
+	if (Source != NULL)
+		Source->Advance(t);
+
 	// Don't push too close to the boundary for now.
 	//  We really should read more data points instead
 	return t >= MinTime+5*NsecPerSec && t <= MaxTime-5*NsecPerSec;
@@ -154,17 +361,52 @@ double EphemerisInterpolated::Accuracy(Time t)
 }
 bool EphemerisInterpolated::SatPos(Time t, Position &XmitPos, double& Adjust)
 {
+	if (Source != NULL && Source->Advance(t) != OK)
+		return Error();
+
 	if (t < MinTime || t > MaxTime)
 		return Error("SP3::SatPos - time out of range\n");
 
-	if (xTime.GetY(t, Adjust))
-		return Error("SP3::GetXmit - couldn't interpolate clock error\n");
-
-	if (xPos.GetY(t, XmitPos))  // Question: Do we adjust for clock error?
+	// The clock and position are on the same points, so they share weights
+	InterpolatorWeights<Time> w;
+	if (xPos.GetWeights(t, w) || !xTime.SameGrid(w))
 		return Error("SP3::GetXmit - couldn't interpolate position\n");
 
+	SatPos(w, XmitPos, Adjust);  // Question: Do we adjust for clock error?
+
+	return OK;
+}
+
+
+void EphemerisInterpolated::SatPos(InterpolatorWeights<Time>& w, Position& XmitPos, double& Adjust)
+// Interpolate with weights which fit our points
+{
+	xTime.GetY(w, Adjust);
+	xPos.GetY(w, XmitPos);
+
 	debug(5, "EphemerisInterpolated: s=%d  Adjust=%g  pos=(%.3f, %.3f,%.3f)\n",
 		SatIndex, Adjust, XmitPos.x, XmitPos.y, XmitPos.z);
+}
+
+bool EphemerisInterpolated::SatState(Time t, Position &XmitPos, Position& Velocity,
+                                     double& Adjust, double& Drift)
+{
+	if (Source != NULL && Source->Advance(t) != OK)
+		return Error();
+
+	if (t < MinTime || t > MaxTime)
+		return Error("SP3::SatState - time out of range\n");
+
+	// The slopes are per nanosecond
+	if (xTime.GetY(t, Adjust, Drift))
+		return Error("SP3::SatState - couldn't interpolate clock error\n");
+	if (xPos.GetY(t, XmitPos, Velocity))
+		return Error("SP3::SatState - couldn't interpolate position\n");
+	Drift *= NsecPerSec;
+	Velocity = Velocity * NsecPerSec;
+
+	debug(5, "EphemerisInterpolated: s=%d  Drift=%g  Velocity=(%.3f, %.3f,%.3f)\n",
+		SatIndex, Drift, Velocity.x, Velocity.y, Velocity.z);
 
 	return OK;
 }
@@ -184,6 +426,22 @@ bool EphemerisInterpolated::AddSatPos(Time t, Position &XmitPos, double Adjust)
 }
 
 
+void EphemerisInterpolated::DropBefore(Time t)
+{
+	xTime.DropBefore(t);
+	xPos.DropBefore(t);
+}
+
+
+void EphemerisInterpolated::Clear()
+{
+	xTime.Clear();
+	xPos.Clear();
+	MinTime = -1;
+	MaxTime = -1;
+}
+
+
 EphemerisInterpolated::~EphemerisInterpolated()
 {
 }
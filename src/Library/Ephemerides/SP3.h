@@ -25,26 +25,40 @@
 #include "Interpolator.h"
 #include "util.h"
 #include "Parse.h"  // GetLine
-#include "InputFile.h"
+#include "MmapInputFile.h"
+#include "SP3Cache.h"
 
 
 
+class SP3;
+
 class EphemerisInterpolated: public Ephemeris
 {
 public:
-	EphemerisInterpolated(int Sat, const char* description = "SP3 Ephemeris");
+	EphemerisInterpolated(int Sat, const char* description = "SP3 Ephemeris", SP3* source = NULL);
     virtual bool Valid(Time t);
     virtual double Accuracy(Time t);
 	virtual bool SatPos(Time t, Position& XmitPos, double& Adjust);
+	virtual bool SatState(Time t, Position& XmitPos, Position& Velocity, 
+	                      double& Adjust, double& Drift);
 
 	bool AddSatPos(Time t, Position& XmitPos, double Adjust);
 	virtual ~EphemerisInterpolated();
 
+	// Interpolating with weights shared among satellites
+	bool GetWeights(Time t, InterpolatorWeights<Time>& w) {return xPos.GetWeights(t, w);}
+	bool SameGrid(InterpolatorWeights<Time>& w) {return xPos.SameGrid(w) && xTime.SameGrid(w);}
+	void SatPos(InterpolatorWeights<Time>& w, Position& XmitPos, double& Adjust);
+
+	// Keeping only the points near the current time
+	void DropBefore(Time t);
+	void Clear();
+
 private:
 	Interpolator<Time,double>   xTime;
 	Interpolator<Time,Position> xPos;
-	Time MinTime, MaxTime;
 	double acc;
+	SP3* Source;   // reads more points as time advances, if there is one
 };
 
 
@@ -55,11 +69,29 @@ public:
 	virtual ~SP3();
 	bool Open(const char* name);
 	bool GetError() { return ErrCode;}
+	virtual bool SatPosAll(Time t, bool valid[MaxSats], Position pos[MaxSats], double adjust[MaxSats]);
+	bool Advance(Time t);
 
 private:
-	bool ReadPos(InputFile& in, Time& t, int32& sat, Position& p, double& Adjust);
+	bool ReadPos(MmapInputFile& in, Time& t, int32& sat, Position& p, double& Adjust);
 	Time GpsTime;
 	bool ErrCode;
+
+	// The file is read as needed, keeping only the points near the current time.
+	//   The points come from the binary cache if there is one, or from the text.
+	char FileName[256];
+	MmapInputFile* In;
+	SP3Cache* Cache;
+	int32 CacheEpoch, CacheSat;   // the next point in the cache
+	bool Eof;
+	Time FirstTime;    // time of the first record
+	Time LastTime;     // time of the last record read
+	Time Step;         // time between records, once we know it
+	Time WindowStart;  // points before this have been dropped
+	void Forget(Time t);
+	bool Restart();
+	bool NextRecord(Time& t, int32& sat, Position& p, double& Adjust);
+	bool BuildCache();
 };
 #endif // !defined(AFX_SP3_H__F4246127_53FE_4572_BA20_2DD65F24ECAD__INCLUDED_)
 
@@ -0,0 +1,159 @@
+// SP3Cache keeps a binary copy of an sp3 file
+//    Part of Kinematic, a utility for GPS positioning
+//
+// Copyright (C) 2006  John Morris    www.precision-gps.org
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation, version 2.
+
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+
+#include "SP3Cache.h"
+
+
+static const char CacheMagic[8] = "KinSP3A";   // change when the layout changes
+
+
+SP3Cache::SP3Cache()
+{
+	File = NULL;
+	Buffer = NULL;
+	Data = NULL;
+	NrEpochs = 0;
+	FirstTime = 0;
+	Step = 0;
+}
+
+
+size_t SP3Cache::BlockSize()
+// x, y, z and clock, then the "listed" bytes, padded to keep doubles aligned
+{
+	return 4*NrEpochs*sizeof(double) + (NrEpochs+7)/8*8;
+}
+
+
+
+bool SP3Cache::Map(const char* sp3name)
+/////////////////////////////////////////////////////////////////////////
+// Use an existing cache of the sp3 file. Quietly fails if there isn't 
+//   a current one.
+/////////////////////////////////////////////////////////////////////////
+{
+	snprintf(CacheName, sizeof(CacheName), "%s.cache", sp3name);
+
+	// Is there a cache file?
+	uint64 size; int64 mtime;
+	if (MappedFile::Stat(CacheName, size, mtime) != OK || size < sizeof(Header))
+		return Error();
+
+	// Map it and check the header
+	File = new MappedFile(CacheName);
+	if (File->GetError() != OK || File->Size() < sizeof(Header))
+		return Error();
+	const Header& h = *(const Header*)File->Data();
+	if (memcmp(h.Magic, CacheMagic, sizeof(CacheMagic)) != 0
+	 || h.HeaderSize != sizeof(Header) || h.NrSats != MaxSats)
+		return Error();
+
+	NrEpochs = h.NrEpochs;
+	FirstTime = h.FirstTime;
+	Step = h.Step;
+	if (File->Size() != sizeof(Header) + MaxSats*BlockSize())
+		return Error();
+
+	// Make sure it is a copy of the current sp3 file
+	uint64 hash;
+	if (Describe(sp3name, size, mtime, hash) != OK
+	 || size != h.SourceSize || mtime != h.SourceTime || hash != h.SourceHash)
+		return Error();
+
+	Data = File->Data();
+	debug("SP3Cache: using %s  epochs=%d\n", CacheName, NrEpochs);
+	return OK;
+}
+
+
+
+bool SP3Cache::Create(const char* sp3name, int32 epochs, Time first, Time step)
+/////////////////////////////////////////////////////////////////////////
+// Make an empty cache in memory. Fill it in with Set(), then Save().
+/////////////////////////////////////////////////////////////////////////
+{
+	snprintf(CacheName, sizeof(CacheName), "%s.cache", sp3name);
+	if (File != NULL) delete File;
+	File = NULL;
+
+	NrEpochs = epochs;
+	FirstTime = first;
+	Step = step;
+	size_t size = sizeof(Header) + MaxSats*BlockSize();
+	Buffer = (byte*)calloc(size, 1);
+	if (Buffer == NULL)
+		return Error("SP3Cache: no memory for %d epochs\n", epochs);
+	Data = Buffer;
+
+	Header& h = *(Header*)Buffer;
+	memcpy(h.Magic, CacheMagic, sizeof(CacheMagic));
+	h.HeaderSize = sizeof(Header);
+	h.NrSats = MaxSats;
+	h.FirstTime = first;
+	h.Step = step;
+	h.NrEpochs = epochs;
+	return Describe(sp3name, h.SourceSize, h.SourceTime, h.SourceHash);
+}
+
+
+void SP3Cache::Set(int32 epoch, int32 sat, Position& pos, double adjust)
+{
+	double* d = Block(sat);
+	d[epoch] = pos.x;  d[NrEpochs+epoch] = pos.y;  d[2*NrEpochs+epoch] = pos.z;
+	d[3*NrEpochs+epoch] = adjust;
+	Listed(sat)[epoch] = 1;
+}
+
+
+bool SP3Cache::Save()
+{
+	if (Buffer == NULL)
+		return Error("SP3Cache: nothing to save\n");
+	return MappedFile::SaveAs(CacheName, Buffer, sizeof(Header) + MaxSats*BlockSize());
+}
+
+
+
+bool SP3Cache::Describe(const char* name, uint64& size, int64& mtime, uint64& hash)
+// Size, modification time, and a hash (64 bit FNV-1a) of a file's contents
+{
+	if (MappedFile::Stat(name, size, mtime) != OK)
+		return Error();
+
+	MappedFile f(name);
+	if (f.GetError() != OK)
+		return Error();
+
+	const byte* p = f.Data();
+	hash = 14695981039346656037ULL;
+	for (size_t i=0; i<f.Size(); i++)
+		hash = (hash ^ p[i]) * 1099511628211ULL;
+
+	return OK;
+}
+
+
+
+SP3Cache::~SP3Cache()
+{
+	if (File != NULL)
+		delete File;
+	if (Buffer != NULL)
+		free(Buffer);
+}
@@ -0,0 +1,99 @@
+#ifndef SP3CACHE_INCLUDED
+#define SP3CACHE_INCLUDED
+// Part of Kinematic, a utility for GPS positioning
+//
+// Copyright (C) 2006  John Morris    www.precision-gps.org
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation, version 2.
+
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+
+
+
+#include "util.h"
+#include "MappedFile.h"
+
+
+//////////////////////////////////////////////////////////////////////////////
+//
+// SP3Cache is a binary copy of the data in an sp3 file, kept in a file 
+//   next to it. Later runs map the copy rather than parse the text again,
+//   and runs on the same machine share its pages.
+//
+// The file is a header followed by a block for each satellite. 
+//   Each block has an array for each of x, y, z and clock, one entry per
+//   epoch, then a byte per epoch saying whether the satellite was listed.
+//
+// The header records the size, modification time and a hash of the 
+//   sp3 file, and the copy is only used if they all still match.
+//
+//////////////////////////////////////////////////////////////////////////////
+
+class SP3Cache
+{
+public:
+	SP3Cache();
+	virtual ~SP3Cache();
+
+	// Use the existing copy of the sp3 file, if there is a good one
+	bool Map(const char* sp3name);
+
+	// Or build one in memory and save it
+	bool Create(const char* sp3name, int32 epochs, Time first, Time step);
+	void Set(int32 epoch, int32 sat, Position& pos, double adjust);
+	bool Save();
+
+	// Get the data for a satellite. false if it wasn't listed.
+	inline bool Get(int32 epoch, int32 sat, Position& pos, double& adjust)
+	{
+		const double* d = Block(sat);
+		if (!Listed(sat)[epoch]) return false;
+		pos.x = d[epoch];  pos.y = d[NrEpochs+epoch];  pos.z = d[2*NrEpochs+epoch];
+		adjust = d[3*NrEpochs+epoch];
+		return true;
+	}
+
+	int32 NrEpochs;
+	Time FirstTime;
+	Time Step;
+
+private:
+	struct Header
+	{
+		char   Magic[8];
+		int32  HeaderSize;
+		int32  NrSats;
+		uint64 SourceSize;
+		int64  SourceTime;
+		uint64 SourceHash;
+		int64  FirstTime;
+		int64  Step;
+		int32  NrEpochs;
+		int32  Unused;
+	};
+
+	char CacheName[260];
+	MappedFile* File;   // an existing cache
+	byte* Buffer;       // or one we are building
+	const byte* Data;
+
+	size_t BlockSize();
+	inline double* Block(int32 sat)
+		{return (double*)(Data + sizeof(Header) + sat*BlockSize());}
+	inline byte* Listed(int32 sat) 
+		{return (byte*)(Block(sat) + 4*NrEpochs);}
+	static bool Describe(const char* name, uint64& size, int64& mtime, uint64& hash);
+};
+
+
+#endif // SP3CACHE_INCLUDED
@@ -0,0 +1,180 @@
+// SatelliteStateCache shares the satellite positions within an epoch
+//    Part of Kinematic, a utility for GPS positioning
+//
+// Copyright (C) 2006  John Morris    www.precision-gps.org
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation, version 2.
+
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+
+
+#include "SatelliteStateCache.h"
+
+
+SatelliteStateCache::SatelliteStateCache(Ephemerides& eph)
+: Eph(eph)
+{
+	Hits = Misses = 0;
+	NrStations = NextStation = 0;
+	for (int i=0; i<MaxStations; i++)
+		Enu[i] = NULL;
+	for (int s=0; s<MaxSats; s++) {
+		State[s].GpsTime = -1;
+		State[s].Valid = false;
+	}
+}
+
+
+
+int32 SatelliteStateCache::Station(Position& pos)
+/////////////////////////////////////////////////////////////////////////
+// Register a station, or find it if it is already registered.
+//   When there are too many, the oldest one is replaced.
+/////////////////////////////////////////////////////////////////////////
+{
+	// A meter or so makes no difference to the elevation
+	for (int i=0; i<NrStations; i++)
+		if (Range(pos - StationPos[i]) < 1)
+			return i;
+
+	int32 i;
+	if (NrStations < MaxStations)
+		i = NrStations++;
+	else {
+		i = NextStation;
+		NextStation = (NextStation+1) % MaxStations;
+		delete Enu[i];
+	}
+
+	StationPos[i] = pos;
+	Enu[i] = new LocalEnu(StationPos[i]);
+	for (int s=0; s<MaxSats; s++)
+		State[s].HaveLook[i] = false;
+
+	debug("SatelliteStateCache: station %d at (%.3f, %.3f, %.3f)\n", i, pos.x, pos.y, pos.z);
+	return i;
+}
+
+
+
+bool SatelliteStateCache::Fill(Time t, const bool wanted[MaxSats])
+/////////////////////////////////////////////////////////////////////////
+// Calculate the wanted satellites which aren't known yet, all at once.
+/////////////////////////////////////////////////////////////////////////
+{
+	bool valid[MaxSats];
+	bool missing[MaxSats];
+	for (int s=0; s<MaxSats; s++) {
+		missing[s] = wanted[s] && State[s].GpsTime != t;
+		valid[s] = missing[s];
+		if (!wanted[s]) continue;
+		if (missing[s]) Misses++;
+		else            Hits++;
+	}
+
+	Position pos[MaxSats];
+	double adjust[MaxSats];
+	if (Eph.SatPosAll(t, valid, pos, adjust) != OK)
+		return Error();
+
+	for (int s=0; s<MaxSats; s++) {
+		if (!wanted[s]) continue;
+		if (missing[s]) {
+			Begin(s, t);
+			State[s].Valid = valid[s];
+			State[s].Pos = pos[s];
+			State[s].Adjust = adjust[s];
+		}
+		for (int i=0; i<NrStations; i++)
+			Look(s, i);
+	}
+
+	return OK;
+}
+
+
+
+const SatelliteState& SatelliteStateCache::Get(int32 sat, Time t)
+{
+	SatelliteState& st = State[sat];
+	if (st.GpsTime == t)
+		Hits++;
+	else {
+		Misses++;
+		Begin(sat, t);
+		Ephemeris* e = Eph.eph[sat];
+		st.Valid = e != NULL && e->Valid(t) && e->SatPos(t, st.Pos, st.Adjust) == OK;
+	}
+
+	for (int i=0; i<NrStations; i++)
+		Look(sat, i);
+	return st;
+}
+
+
+
+const SatelliteState& SatelliteStateCache::GetWithVelocity(int32 sat, Time t)
+// Same as Get, but the velocity and clock drift are filled in as well
+{
+	SatelliteState& st = State[sat];
+	if (st.GpsTime == t && (st.HaveVelocity || !st.Valid))
+		Hits++;
+	else {
+		Misses++;
+		if (st.GpsTime != t) Begin(sat, t);
+		Ephemeris* e = Eph.eph[sat];
+		st.Valid = e != NULL && e->Valid(t) 
+			&& e->SatState(t, st.Pos, st.Velocity, st.Adjust, st.Drift) == OK;
+		st.HaveVelocity = st.Valid;
+	}
+
+	for (int i=0; i<NrStations; i++)
+		Look(sat, i);
+	return st;
+}
+
+
+
+void SatelliteStateCache::Begin(int32 sat, Time t)
+// Forget what we knew about the satellite at the previous time
+{
+	SatelliteState& st = State[sat];
+	st.GpsTime = t;
+	st.Valid = false;
+	st.HaveVelocity = false;
+	for (int i=0; i<MaxStations; i++)
+		st.HaveLook[i] = false;
+}
+
+
+
+void SatelliteStateCache::Look(int32 sat, int32 station)
+// Elevation and azimuth of the satellite as seen from the station
+{
+	SatelliteState& st = State[sat];
+	if (st.HaveLook[station] || !st.Valid) return;
+
+	enu v = Enu[station]->ToEnu(st.Pos);
+	st.Elevation[station] = atan2(v.u, sqrt(v.e*v.e + v.n*v.n));
+	st.Azimuth[station] = atan2(v.e, v.n);
+	if (st.Azimuth[station] < 0) st.Azimuth[station] += 2*PI;
+	st.HaveLook[station] = true;
+}
+
+
+
+SatelliteStateCache::~SatelliteStateCache()
+{
+	for (int i=0; i<NrStations; i++)
+		delete Enu[i];
+}
@@ -0,0 +1,109 @@
+#ifndef SATELLITESTATECACHE_INCLUDED
+#define SATELLITESTATECACHE_INCLUDED
+// Part of Kinematic, a utility for GPS positioning
+//
+// Copyright (C) 2006  John Morris    www.precision-gps.org
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation, version 2.
+
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+
+
+
+
+#include "Util.h"
+#include "Ephemeris.h"
+
+
+static const int32 MaxStations = 4;
+
+
+//////////////////////////////////////////////////////////////////////////////
+//
+// SatelliteState is what we know about a satellite at one time.
+//   The position and clock are the same as Ephemeris::SatPos gives.
+//   Elevation and azimuth (radians) are for each registered station.
+//
+//////////////////////////////////////////////////////////////////////////////
+
+struct SatelliteState
+{
+	Time GpsTime;           // -1 if nothing has been calculated
+	bool Valid;             // does the satellite have a position?
+	Position Pos;
+	double Adjust;
+	bool HaveVelocity;
+	Position Velocity;
+	double Drift;
+	bool HaveLook[MaxStations];
+	double Elevation[MaxStations];
+	double Azimuth[MaxStations];
+};
+
+
+//////////////////////////////////////////////////////////////////////////////
+//
+// SatelliteStateCache remembers the satellite states for the current epoch,
+//   so everyone looking at the same satellites at the same time shares
+//   the work. Each set of ephemerides has its own cache (see
+//   Ephemerides::States), so a state is known by satellite and time.
+//
+// The states are read only. A station is registered once and its 
+//   looks are calculated along with the positions.
+//
+// It is not locked, so it should be used from a single thread. 
+//   (With several rovers, only the thread reading the base uses it.)
+//
+//////////////////////////////////////////////////////////////////////////////
+
+class SatelliteStateCache
+{
+public:
+	SatelliteStateCache(Ephemerides& eph);
+	virtual ~SatelliteStateCache();
+
+	// Register a station. Returns the index for looking up elevations.
+	//   Only MaxStations are kept, so registering others may give the
+	//   index to a new station. Call this each epoch rather than keeping it.
+	int32 Station(Position& pos);
+
+	// Calculate the wanted satellites at once, ahead of the Get()s
+	bool Fill(Time t, const bool wanted[MaxSats]);
+
+	// The state of a satellite as of the last Fill
+	inline const SatelliteState& operator[](int32 sat) {return State[sat];}
+
+	// The state of a satellite, calculated if not already known
+	const SatelliteState& Get(int32 sat, Time t);
+	const SatelliteState& GetWithVelocity(int32 sat, Time t);
+
+	// How well the cache is working. Each satellite asked for by Fill or Get
+	//   is a hit if it was already known or a miss if it had to be calculated.
+	int32 Hits;
+	int32 Misses;
+
+private:
+	Ephemerides& Eph;
+	SatelliteState State[MaxSats];
+
+	int32 NrStations;
+	int32 NextStation;    // the next one to reuse when we run out
+	Position StationPos[MaxStations];
+	LocalEnu* Enu[MaxStations];
+
+	void Begin(int32 sat, Time t);
+	void Look(int32 sat, int32 station);
+};
+
+
+#endif // SATELLITESTATECACHE_INCLUDED
@@ -0,0 +1,126 @@
+
+#include "RawSqlite.h"
+
+
+RawSqlite::RawSqlite(const char* name, int station_id)
+                 : station_id(station_id)
+{
+    debug("RawSqlite::RawSqlite(%s, %d)\n", name, station_id);
+    strcpy(Description, "Sqlite");
+    snprintf(filename, sizeof(filename), "%s", name);
+    db = 0; select = 0;
+    HasRow = false;
+
+    // Create dummy ephemerides
+    for (int s=0; s<MaxSats; s++)
+        eph[s] = new EphemerisDummy(s, "Sqlite Dummy Ephemeris");
+
+    // Open the database and start at the beginning
+    ErrCode = Initialize();
+    if (ErrCode == OK) ErrCode = SeekTo(0);
+    if (ErrCode != OK) Cleanup();
+}
+
+
+bool RawSqlite::NextEpoch()
+{
+    debug("RawSqlite::NextEpoch\n");
+    for (int s=0; s<MaxSats; s++)
+        obs[s].Valid = false;
+
+    if (db == 0 || !HasRow) return Error();
+    GpsTime = sqlite3_column_int64(select, 0);
+
+    // Take rows until the time changes
+    do {
+        int s = SvidToSat(sqlite3_column_int(select, 1));
+        if (s < 0 || s >= MaxSats) continue;
+
+        RawObservation& o = obs[s];
+        o.PR = sqlite3_column_double(select, 2);
+        o.Phase = sqlite3_column_double(select, 3);
+        o.Doppler = sqlite3_column_double(select, 4);
+        o.SNR = sqlite3_column_double(select, 5);
+        o.Slip = sqlite3_column_int(select, 6) != 0;
+        o.Valid = true;
+
+    } while (Step() == OK && HasRow && sqlite3_column_int64(select, 0) == GpsTime);
+
+    return OK;
+}
+
+
+bool RawSqlite::SeekTo(Time t)
+{
+    debug("RawSqlite::SeekTo(%.3f)\n", S(t));
+    if (db == 0) return Error();
+
+    // Start a new range scan at the time
+    sqlite3_reset(select);
+    sqlite3_bind_int(select, 1, station_id);
+    sqlite3_bind_int64(select, 2, (sqlite3_int64)t);
+    if (Step() != OK) return Error();
+
+    Rewound(HasRow? sqlite3_column_int64(select, 0): t);
+    return OK;
+}
+
+
+bool RawSqlite::Step()
+{
+    int rc = sqlite3_step(select);
+    HasRow = (rc == SQLITE_ROW);
+    if (rc != SQLITE_ROW && rc != SQLITE_DONE)
+        return Error("Sqlite file %s can't read observations: %s\n", 
+                       filename, sqlite3_errmsg(db));
+    return OK;
+}
+
+
+
+RawSqlite::~RawSqlite()
+{
+    Cleanup();
+}
+
+
+
+bool RawSqlite::Initialize()
+{
+    // Open the database. Don't create it if it isn't there.
+    if (sqlite3_open_v2(filename, &db, SQLITE_OPEN_READONLY, 0) != SQLITE_OK)
+        return Error("Can't open database at %s: %s\n", filename, sqlite3_errmsg(db));
+
+    // If we weren't told the station, use the first one we find
+    const char* sql;
+    if (station_id == -1) {
+        sqlite3_stmt* first;
+        sql = "select station_id from observation limit 1;";
+        if (sqlite3_prepare_v2(db, sql, -1, &first, 0) != SQLITE_OK)
+            return Error("Sqlite file %s has no observations: %s\n", filename, sqlite3_errmsg(db));
+        if (sqlite3_step(first) == SQLITE_ROW)
+            station_id = sqlite3_column_int(first, 0);
+        sqlite3_finalize(first);
+    }
+
+    // Prepare the query. It scans the (time, station_id) index from a given time.
+    sql = "select time, svid, PR, phase, doppler, snr, slipped "
+              "from observation "
+              "where station_id = ? and time >= ? "
+              "order by time, svid;";
+    if (sqlite3_prepare_v2(db, sql, -1, &select, 0) != SQLITE_OK)
+        return Error("Unable to precompile select stmt: %s\n", sqlite3_errmsg(db));
+
+    return OK;
+}
+
+
+
+bool RawSqlite::Cleanup()
+{
+    if (select != 0) sqlite3_finalize(select);
+    if (db != 0) sqlite3_close(db);
+    select = 0; db = 0;
+
+    return OK;
+}
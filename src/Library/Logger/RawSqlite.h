@@ -0,0 +1,46 @@
+#ifndef RawSqlite_included
+#define RawSqlite_included
+
+
+#include "RawReceiver.h"
+#include "sqlite3.h"
+
+
+//////////////////////////////////////////////////////////////////////////////
+//
+// RawSqlite reads back the observations written by SqliteLogger.
+//
+// The observation table is indexed on (time, station_id), so seeking
+//   to a time is just a new range scan starting there. Each epoch is
+//   the rows with the same time, and we read one row past the end of
+//   it to find out where it ends.
+//
+// The file doesn't keep ephemerides or the station position, so like
+//   a Rinex file, it needs a navigation file to go with it.
+//
+//////////////////////////////////////////////////////////////////////////////
+
+class RawSqlite : public RawReceiver
+{
+    int station_id;
+    char filename[256];
+    sqlite3* db;
+
+    sqlite3_stmt* select;
+    bool HasRow;     // the first row of the next epoch is waiting
+
+public:
+    // A station_id of -1 means whichever station is in the file
+    RawSqlite(const char* name, int station_id = -1);
+    virtual bool NextEpoch();
+    virtual bool SeekTo(Time t);
+    virtual ~RawSqlite();
+
+private:
+    bool Initialize();
+    bool Cleanup();
+    bool Step();
+};
+
+
+#endif
@@ -1,5 +1,6 @@
 
 #include "SqliteLogger.h"
+#include "SatelliteStateCache.h"
 
 
 SqliteLogger::SqliteLogger(const char* filename, RawReceiver& gps, int station_id)
@@ -17,13 +18,18 @@ bool SqliteLogger::OutputEpoch()
 {
     debug("SqliteLogger::OutputEpoch\n");
 
-    // Calculate the satellite positions, but outside the transaction
-    Position pos[MaxSats];
-    double adjust[MaxSats];
-    for (int s=0; s<MaxSats; s++) {
-        adjust[s] = 0;  pos[s] = Position(0);
-        if (gps.obs[s].Valid && gps[s].Valid(gps.GpsTime)) 
-           gps[s].SatPos(gps.GpsTime, pos[s], adjust[s]);
+    // Calculate the satellite positions, but outside the transaction.
+    //   If that fails, log the observations without them rather than
+    //   with what the cache had from before.
+    SatelliteStateCache& states = gps.States();
+    bool valid[MaxSats];
+    for (int s=0; s<MaxSats; s++)
+        valid[s] = gps.obs[s].Valid;
+    bool HavePositions = states.Fill(gps.GpsTime, valid) == OK;
+    if (!HavePositions) {
+        debug("SqliteLogger: no satellite positions at %.3f, logging the observations alone\n",
+              S(gps.GpsTime));
+        ClearError();
     }
 
     // Make it a transaction to improve performance
@@ -46,10 +52,13 @@ bool SqliteLogger::OutputEpoch()
         sqlite3_bind_int(insert, 8, gps.obs[s].Slip);
 
         // Include the satellite information as well
-        sqlite3_bind_double(insert, 9, pos[s].x);
-        sqlite3_bind_double(insert, 10, pos[s].y);
-        sqlite3_bind_double(insert, 11, pos[s].z);
-        sqlite3_bind_double(insert, 12, adjust[s]);
+        const SatelliteState& st = states[s];
+        bool known = HavePositions && st.Valid;
+        Position pos = known? st.Pos: Position(0);
+        sqlite3_bind_double(insert, 9, pos.x);
+        sqlite3_bind_double(insert, 10, pos.y);
+        sqlite3_bind_double(insert, 11, pos.z);
+        sqlite3_bind_double(insert, 12, known? st.Adjust: 0);
 
         // Insert the new row into the table
         debug("About to insert row: svid=%d\n", SatToSvid(s));
@@ -60,6 +60,8 @@ RawAC12::RawAC12(Stream& s)
 /// reads the next set of raw observations from the AC12 receiver
 bool RawAC12::NextEpoch()
 {
+	if (Holding()) return OK;
+
 Block b;
 
 MeasurementTag = -1; 
@@ -258,6 +260,7 @@ bool RawAC12::ProcessEphemeris(Block& blk)
     e.MaxTime = e.t_oe + 2*NsecPerHour;
     
     e.Display("AC12 Ephemeris Processed");
+    Archived(e);
     
     // If the AC12 hasn't seen a valid time yet, use the time from the ephemeris.
     //   This is where we get the initial WN.
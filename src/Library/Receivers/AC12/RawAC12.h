@@ -34,6 +34,7 @@ public:
 	RawAC12(Stream& s);
 	virtual bool NextEpoch();
 	virtual ~RawAC12();
+	virtual EphemerisXmit* Broadcast(int s) {return (EphemerisXmit*)eph[s];}
 
 private:
 	bool ProcessPosition(Block& b);
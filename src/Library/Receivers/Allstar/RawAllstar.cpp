@@ -48,6 +48,8 @@ RawAllstar::~RawAllstar()
 
 bool RawAllstar::NextEpoch()
 {
+	if (Holding()) return OK;
+
 	NavTime = -1;
 	RawTime = -2;
 
@@ -137,6 +139,7 @@ bool RawAllstar::ProcessEphemeris(Block& block)
         EphemerisXmitRaw r;
 	f.ToRaw(r);
         e.FromRaw(r);
+        Archived(e);
 
 	return OK;
 }
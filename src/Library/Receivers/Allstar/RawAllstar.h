@@ -39,6 +39,7 @@ public:
 	RawAllstar(Stream& s);
 	virtual bool NextEpoch();
 	virtual ~RawAllstar();
+	virtual EphemerisXmit* Broadcast(int s) {return (EphemerisXmit*)eph[s];}
 
 private:
 	bool Initialize();
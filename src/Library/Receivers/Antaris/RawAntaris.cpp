@@ -90,6 +90,8 @@ RawAntaris::~RawAntaris()
 /// fetches the next set of raw measurements from the Ublox receiver
 bool RawAntaris::NextEpoch()
 {
+	if (Holding()) return OK;
+
 
 	// Epoch ends when raw data processing sets GpsTime
 	for (GpsTime = -1; GpsTime < 0; ) {
@@ -282,6 +284,7 @@ bool RawAntaris::ProcessEphemeris(Block& block)
     EphemerisXmitRaw r;
     f.ToRaw(r);
     e.FromRaw(r);
+    Archived(e);
     
     return OK;
     }
@@ -40,6 +40,7 @@ public:
 	RawAntaris(Stream& s);
 	virtual bool NextEpoch();
 	virtual ~RawAntaris();
+	virtual EphemerisXmit* Broadcast(int s) {return (EphemerisXmit*)eph[s];}
 
 private:
 	bool Initialize();
@@ -45,6 +45,8 @@ RawFuruno::~RawFuruno()
 
 bool RawFuruno::NextEpoch()
 {
+	if (Holding()) return OK;
+
 	GpsTime = -1;  
 
 	// Epoch ends when raw data processing sets GpsTime
@@ -187,6 +189,7 @@ bool RawFuruno::ProcessNav(Block& block)
 	// Update the ephemeris
 	EphemerisXmit& e = *(EphemerisXmit*)eph[Sat];
 	e.AddFrame(f);
+	Archived(e);
 
 #endif
 	return OK;
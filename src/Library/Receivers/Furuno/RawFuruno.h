@@ -34,6 +34,7 @@ public:
 	RawFuruno(Stream& s);
 	virtual bool NextEpoch();
 	virtual ~RawFuruno();
+	virtual EphemerisXmit* Broadcast(int s) {return (EphemerisXmit*)eph[s];}
 
 private:
 	bool Initialize();
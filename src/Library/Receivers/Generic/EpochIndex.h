@@ -0,0 +1,82 @@
+#ifndef EPOCHINDEX_INCLUDED
+#define EPOCHINDEX_INCLUDED
+// Part of Kinematic, a utility for GPS positioning
+//
+// Copyright (C) 2006  John Morris    www.precision-gps.org
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation, version 2.
+
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+
+
+#include "util.h"
+#include "GpsTime.h"
+#include <vector>
+using namespace std;
+
+
+//////////////////////////////////////////////////////////////////////////////
+//
+// EpochIndex remembers where each epoch of a raw data file started, as
+//   the epochs are read. A receiver reading a mapped file can then go
+//   back to any epoch it has seen without decoding everything before it.
+//
+// Offset is where the reader was in the file when it started on the
+//   epoch. A reader which keeps partial bytes between frames can save
+//   them in State.
+//
+// Epochs are only added in time order. Reading an epoch a second time
+//   doesn't add it again.
+//
+//////////////////////////////////////////////////////////////////////////////
+
+class EpochIndex
+{
+public:
+	struct Mark
+	{
+		Time GpsTime;
+		uint64 Offset;
+		uint64 State;
+	};
+
+	inline void Add(Time t, uint64 offset, uint64 state = 0)
+	{
+		if (!Marks.empty() && t <= Marks.back().GpsTime) return;
+		Mark m = {t, offset, state};
+		Marks.push_back(m);
+	}
+
+	// The first epoch at or after time t, or Size() if there isn't one
+	inline size_t Find(Time t)
+	{
+		size_t lo = 0, hi = Marks.size();
+		while (lo < hi) {
+			size_t mid = (lo + hi) / 2;
+			if (Marks[mid].GpsTime < t) lo = mid + 1;
+			else                        hi = mid;
+		}
+		return lo;
+	}
+
+	inline size_t Size() {return Marks.size();}
+	inline bool Empty() {return Marks.empty();}
+	inline Mark& operator[](size_t i) {return Marks[i];}
+	inline Mark& Last() {return Marks.back();}
+
+protected:
+	vector<Mark> Marks;
+};
+
+
+#endif // EPOCHINDEX_INCLUDED
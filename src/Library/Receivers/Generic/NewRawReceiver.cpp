@@ -11,9 +11,12 @@
 //////////////////////////////////////////////////////////////////
 
 #include "NewRawReceiver.h"
+#include "MmapInputFile.h"
 #include "InputFile.h"
+#include "MappedFile.h"
 #include "OutputFile.h"
 #include "StreamCopy.h"
+#include "BufferedStream.h"
 #include "Rs232.h"
 
 #include "RawTrimble.h"
@@ -24,8 +27,10 @@
 #include "RawRtcm23.h"
 #include "RawRtcm3.h"
 #include "RawRinex.h"
+#include "RawRinexStore.h"
 #include "RawFuruno.h"
 #include "RawSSF.h"
+#include "RawSqlite.h"
 //#include "RawGarmin.h"
 //#include "CommGarminUsb.h"
 #include "CommWriteLog.h"
@@ -41,9 +46,37 @@ RawReceiver* NewRawReceiver(const char* model, const char* port, const char* raw
 
 	//if (Same(model, "GPS18")) return NewRawGarmin(port, raw);
 
+	// A Rinex file may be read whole, with several threads
+	if (Same(model, "RINEX") && RinexThreads > 0 && raw == NULL) {
+		RawReceiver* gps = new RawRinexStore(port, RinexThreads);
+		if (gps == NULL || gps->GetError() != OK) {
+			Error("Unable to initialize GPS receiver %s\n", model);
+			return NULL;
+		}
+		return gps;
+	}
+
+	// A database isn't a stream. It is read with queries.
+	if (Same(model, "SQLITE")) {
+		RawReceiver* gps = new RawSqlite(port);
+		if (gps == NULL || gps->GetError() != OK) {
+			Error("Unable to initialize GPS receiver %s\n", model);
+			return NULL;
+		}
+		return gps;
+	}
+
 	Stream* s = NewInputStream(port, raw);
 	if (s == NULL) return NULL;
 
+	// Read a pipe in large chunks rather than a byte at a time.
+	//   A mapped file is in memory already, and Rinex reads it in place.
+	//   A serial port is left alone, since it is queried for its settings.
+	if (MappedFile::Pipe(port)) {
+		s = new BufferedStream(*s);
+		if (s->GetError() != OK) return NULL;
+	}
+
 	// process according to the model of receiver
 	RawReceiver* gps = NULL;
 	if      (Same(model, "AC12"))      gps = new RawAC12(*s); 
@@ -95,11 +128,21 @@ Stream* NewOutputStream(const char* PortName)
 Stream* NewInputStream(const char* PortName, const char* RawFileName)
 {
 	// TODO: fix leaks on error exit.
-	// Open the input, either a com port or a raw input file
-	Stream* port = new Rs232(PortName);
-	ClearError();
-	if ( port == NULL || port->GetError() != OK)
+	// Open the input. A regular file is mapped, a pipe is read as
+	//   the data comes, and anything else is tried as a com port first.
+	Stream* port;
+	if (MappedFile::Mappable(PortName))
+		port = new MmapInputFile(PortName);
+	else if (MappedFile::Pipe(PortName))
 		port = new InputFile(PortName);
+	else {
+		port = new Rs232(PortName);
+		ClearError();
+		if (port == NULL || port->GetError() != OK) {
+			if (port != NULL) delete port;
+			port = new InputFile(PortName);
+		}
+	}
 	if (port == NULL || port->GetError() != OK) {
 		Error("Unable to open the GPS raw file %s\n", PortName);
 		return NULL;
@@ -18,6 +18,7 @@
 // Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
 
 #include "RawReceiver.h"
+#include "EphemerisArchive.h"
 
 int RawReceiver::HZ = 1;
 
@@ -29,6 +30,8 @@ RawReceiver::RawReceiver()
 	Adjust=0;
 	PreviousTow=0;
 	GpsTime=0;
+	Archive = NULL;
+	Held = false;
 	for (int s=0; s<MaxSats; s++) {
 		obs[s].Sat = s;
 		obs[s].Valid = false;
@@ -38,11 +41,58 @@ RawReceiver::RawReceiver()
 
 
 
+void RawReceiver::Archived(EphemerisXmit& e)
+// A new ephemeris arrived
+{
+	if (Archive != NULL)
+		Archive->Add(e);
+}
+
+
+
+bool RawReceiver::SeekTo(Time t)
+/////////////////////////////////////////////////////////////////////////
+// Move so the first epoch at or after t comes next. A receiver which
+//   can seek backs up to just before it. The rest can only read
+//   forward, so read up to the epoch and hold it for the next NextEpoch.
+/////////////////////////////////////////////////////////////////////////
+{
+	debug("RawReceiver::SeekTo: %s reads up to the time\n", Description);
+	Held = false;
+	while (GpsTime < t)
+		if (NextEpoch() != OK) return Error();
+	Held = (GpsTime != 0);
+	return OK;
+}
+
+
+void RawReceiver::Rewound(Time next)
+// We've gone back to just before the epoch at time "next"
+{
+	for (int s=0; s<MaxSats; s++)
+		obs[s].Valid = false;
+	GpsTime = next - 1;
+	Held = false;
+}
+
+
+
 bool RawReceiver::AdjustToHz(bool IncludeDoppler)
 {
 	debug("AdjustToHz: HZ=%d  IncludeDoppler=%d\n", HZ, IncludeDoppler);
 	return AdjustToTime(NearestHz(GpsTime, HZ), IncludeDoppler);
 }
+
+
+Time RawReceiver::FirstRawTime(Time t)
+// Epochs are rounded to the nearest interval, so a raw time up to half
+//   an interval before the first interval at or after t still gets there
+{
+	Time interval = NsecPerSec / HZ;
+	Time first = t + interval - 1;
+	first -= first % interval;
+	return first - interval/2;
+}
  
  
 bool RawReceiver::AdjustToTime(Time t, bool IncludeDoppler)
@@ -25,6 +25,9 @@
 #include "Ephemeris.h"
 #include "RawObservation.h"
 
+class EphemerisXmit;
+class EphemerisArchive;
+
 
 //////////////////////////////////////////////////////////////////////////
 // 
@@ -81,10 +84,31 @@ public:
 	RawReceiver();
 	virtual bool NextEpoch() = 0;
 	virtual ~RawReceiver();
+
+	// Move so the next NextEpoch() returns the first epoch at or after
+	//   time t. Receivers which only read forward read up to that epoch
+	//   and hold on to it.
+	virtual bool SeekTo(Time t);
+
+	// Also keep every broadcast ephemeris as it arrives
+	void SetArchive(EphemerisArchive* archive) {Archive = archive;}
+
 protected:
+	EphemerisArchive* Archive;
+	void Archived(EphemerisXmit& e);
+	void Rewound(Time next);
+
+	// An epoch held by the default SeekTo is handed out again. So a
+	//   NextEpoch which might use it starts with "if (Holding()) return OK;"
+	bool Held;
+	inline bool Holding() {bool held = Held; Held = false; return held;}
+
 	bool AdjustToHz(bool IncludeDoppler=true);
 	bool AdjustToTime(Time t, bool IncludeDoppler=true);
 
+	// The earliest raw time which AdjustToHz puts at t or later
+	static Time FirstRawTime(Time t);
+
 	Time AdjustToHz(Time t, double tow);  // defunct
 	void AdjustToTime(Time t, double tow);          // defunct
 };
@@ -47,6 +47,8 @@ RawSSF::RawSSF(Stream& s)
 
 bool RawSSF::NextEpoch()
 {
+	if (Holding()) return OK;
+
 	Block b;
       bool Err;
 
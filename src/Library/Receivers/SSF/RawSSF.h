@@ -35,6 +35,7 @@ public:
 	RawSSF(Stream& s);
 	virtual bool NextEpoch();
 	virtual ~RawSSF();
+	virtual EphemerisXmit* Broadcast(int s) {return (EphemerisXmit*)eph[s];}
 
 private:
 	bool ProcessStartEpoch(Block& b);
@@ -1,4 +1,5 @@
 #include "RawSimulator.h"
+#include "SatelliteStateCache.h"
 
 RawSimulator::RawSimulator(RawReceiver& rcv, Ephemerides& e, bool stationary)
 : gps(rcv), ephemerides(e), Static(stationary)
@@ -24,6 +25,8 @@ RawSimulator::RawSimulator(RawReceiver& rcv, Ephemerides& e, bool stationary)
 
 bool RawSimulator::NextEpoch()
 {
+	if (Holding()) return OK;
+
 	debug("RawSimulator::NextEpoch\n");
 	// Read an epoch from the GPS
 	if (gps.NextEpoch() != OK)
@@ -47,8 +50,9 @@ bool RawSimulator::NextEpoch()
 		if (!obs[s].Valid || !ephemerides[s].Valid(GpsTime)) continue;
 		
 		// Calculate the actual range to the satellite
-		Position SatPos; double Clock;
-		ephemerides[s].SatPos(GpsTime, SatPos, Clock);
+		const SatelliteState& st = ephemerides.States().Get(s, GpsTime);
+		if (!st.Valid) continue;
+		Position SatPos = st.Pos;
 		double range = Range(SatPos - Pos);
 		debug("Simulator: Pos=(%.3f, %.3f, %.3f)  SatPos=(%.3f, %.3f, %.3f)\n",
 			Pos.x,Pos.y,Pos.z,  SatPos.x,SatPos.y,SatPos.z);
@@ -12,6 +12,7 @@ protected:
 public:
 	bool NextEpoch();
 	RawSimulator(RawReceiver& rcv, Ephemerides& e, bool stationary=true);
+	EphemerisXmit* Broadcast(int s) {return ephemerides.Broadcast(s);}
 	virtual ~RawSimulator(void);
 };
 
@@ -108,6 +108,8 @@ RawSirf::~RawSirf()
 
 bool RawSirf::NextEpoch()
 {
+	if (Holding()) return OK;
+
 	// Sequence of messages is:
 	//    Navlib messages (raw measurements)
 	//    if tracking,
@@ -244,8 +246,10 @@ bool RawSirf::Process50Bps(Block& block)
 	}
 
 	// If the frame is complete, update the ephemeris
-	if (frame.Complete()) 
+	if (frame.Complete()) {
 		ephemeris.AddFrame(frame);
+		Archived(ephemeris);
+	}
 
 	return OK;
 }
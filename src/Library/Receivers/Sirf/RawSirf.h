@@ -40,6 +40,7 @@ public:
 	RawSirf(Stream& s);
 	virtual bool NextEpoch();
 	virtual ~RawSirf();
+	virtual EphemerisXmit* Broadcast(int s) {return (EphemerisXmit*)eph[s];}
 
 private:
 	bool Initialize();
@@ -73,6 +73,8 @@ bool RawTrimble::Initialize()
 
 bool RawTrimble::NextEpoch()
 {
+	if (Holding()) return OK;
+
 
 	MeasurementTime = -2;
  
@@ -320,6 +322,8 @@ bool RawTrimble::ProcessSatData(Block& blk)
 		return OK;
 	}
 
+	Archived(e);
+
 	// Schedule a later update
 	GotEphemeris(s);
 
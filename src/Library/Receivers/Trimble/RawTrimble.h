@@ -41,6 +41,7 @@ public:
 	RawTrimble(Stream& s);
 	virtual bool NextEpoch();
 	virtual ~RawTrimble(void);
+	virtual EphemerisXmit* Broadcast(int s) {return (EphemerisXmit*)eph[s];}
 
 private:
 	bool Initialize();
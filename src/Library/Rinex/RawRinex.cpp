@@ -21,6 +21,8 @@
 
 #include "RawRinex.h"
 #include "RinexParse.h"
+#include <vector>
+using namespace std;
 
 //////////////////////////////////////////////////////////////////////
 // Construction/Destruction
@@ -29,12 +31,19 @@
 RawRinex::RawRinex(Stream& in)
 : In(in)
 {
+	// A mapped file can be parsed in place
+	Mapped = dynamic_cast<MmapInputFile*>(&In);
+	Index = NULL;
 	ErrCode = Initialize();
 }
 
 bool RawRinex::Initialize(int baud)
 {
 	strcpy(Description, "RinexFile");
+	memset(Date, 0, sizeof(Date));
+	Day = 0;
+	EpochOffset = 0;
+	Body = 0;
 	if (In.GetError() != OK)
 		return Error("Unable to open Rinex input file\n");
 
@@ -42,7 +51,9 @@ bool RawRinex::Initialize(int baud)
 	for (int s=0; s<MaxSats; s++)
 		eph[s] = new EphemerisDummy(s, "Rinex Dummy Ephemeris");
 
-	return ReadHeader();
+	if (ReadHeader() != OK) return Error();
+	if (Mapped != NULL) Body = Mapped->Tell();
+	return OK;
 }
 
 
@@ -50,39 +61,41 @@ bool RawRinex::Initialize(int baud)
 bool RawRinex::ReadHeader()
 {
 	// Repeat for each line in the header
-	char line[128];
-	while (ReadLine(line, sizeof(line)) == OK) {
-		debug(2,"Rinex::ReadHeader: line=%s\n", line);
+	const char* line; int len;
+	while (ReadLine(line, len) == OK) {
+		debug(2,"Rinex::ReadHeader: line=%.*s\n", len, line);
 
 		// Process according to the description field
 
 		// Case: Approximate position 
-		if (match(line, 60, "APPROX POSITION XYZ")) {
-			Pos.x = GetDouble(line, 0, 14);
-			Pos.y = GetDouble(line, 14, 14);
-			Pos.z = GetDouble(line, 28, 14);
+		if (match(line, len, 60, "APPROX POSITION XYZ")) {
+			Pos.x = GetDouble(line, len, 0, 14);
+			Pos.y = GetDouble(line, len, 14, 14);
+			Pos.z = GetDouble(line, len, 28, 14);
 			debug(2,"Rinex::ReadHeader; Pos=(%.4f,%.4f,%.4f)\n",Pos.x,Pos.y,Pos.z);
 		}
 
 		// Case: types of observations
-		else if (match(line, 60, "# / TYPES OF OBSERV")) {
+		else if (match(line, len, 60, "# / TYPES OF OBSERV")) {
 
 			// Get the number of observations. (we can handle up to 9)
-			NrMeasurements = GetInt(line, 0, 6);
+			NrMeasurements = GetInt(line, len, 0, 6);
 			if (NrMeasurements < 0 || NrMeasurements > 9) 
 				return Error("Rinex error: too many types of observations (%d)\n",NrMeasurements);
 
 			// Look for the L1 observation types
 			C1Index = L1Index = D1Index = S1Index = -1;
 			for (int i=0; i<NrMeasurements; i++)
-				if (match(line, 10+i*6, "L1"))
-					L1Index = i;
-				else if (match(line, 10+i*6,"C1"))
-					C1Index = i;
-				else if (match(line, 10+i*6,"D1"))
-					D1Index = i;
-				else if (match(line, 10+i*6,"S1"))
-					S1Index = i;
+				if (match(line, len, 10+i*6, "L1"))
+					L1Index = i, Field[i] = Phase;
+				else if (match(line, len, 10+i*6,"C1"))
+					C1Index = i, Field[i] = Range;
+				else if (match(line, len, 10+i*6,"D1"))
+					D1Index = i, Field[i] = Doppler;
+				else if (match(line, len, 10+i*6,"S1"))
+					S1Index = i, Field[i] = Strength;
+				else
+					Field[i] = Unused;
 
 			debug(2,"L1Index=%d  C1Index=%d  D1Index=%d S1Index=%d\n", 
 				     L1Index, C1Index, D1Index, S1Index);
@@ -93,12 +106,12 @@ bool RawRinex::ReadHeader()
 		}
 
 		// Case: Starting time
-		else if (match(line, 60, "TIME OF FIRST OBS")) {
-			StartYear = GetInt(line, 0, 6);
+		else if (match(line, len, 60, "TIME OF FIRST OBS")) {
+			StartYear = GetInt(line, len, 0, 6);
 		}
 
 		// Case: end of header
-		else if (match(line, 60, "END OF HEADER"))
+		else if (match(line, len, 60, "END OF HEADER"))
 			return OK;
 	}
 	
@@ -111,6 +124,20 @@ bool RawRinex::ReadHeader()
 
 
 bool RawRinex::NextEpoch()
+{
+	if (Holding()) return OK;
+	if (ReadEpoch() != OK) return Error();
+	AdjustToHz();
+
+	return OK;
+}
+
+
+bool RawRinex::ReadEpoch()
+/////////////////////////////////////////////////////////////////////////
+// The next epoch of observations, as it is in the file. 
+//   Same as NextEpoch, but not adjusted to the clock.
+/////////////////////////////////////////////////////////////////////////
 {
     for (int s=0; s<MaxSats; s++)
 		obs[s].Valid = false;
@@ -119,86 +146,97 @@ bool RawRinex::NextEpoch()
 	int EpochFlag;
 	do {
 	    // Get a line from the rinexfile
-		char line[128];
-	    if (ReadLine(line, sizeof(line))) return Error();
+		const char* line; int len;
+		if (Mapped != NULL) EpochOffset = Mapped->Tell();
+	    if (ReadLine(line, len)) return Error();
 
 		// Get the type of data, and date if present
-		EpochFlag = GetInt(line, 28, 1);
-		ParseRinexTime(line, GpsTime);
-		debug("Rinex::NextEpoch GpsTime=%.3f EpochFlag=%d line=%s\n", 
-			S(GpsTime), EpochFlag, line);
+		EpochFlag = GetInt(line, len, 28, 1);
+		ParseRinexTime(line, len, GpsTime);
+		debug("Rinex::NextEpoch GpsTime=%.3f EpochFlag=%d line=%.*s\n", 
+			S(GpsTime), EpochFlag, len, line);
 
 	    // Process according to the type of header
-		if (EpochFlag == 0 || EpochFlag == 1)  {      
-			if (ProcessObservations(line) != OK) return Error();
+		if ((EpochFlag == 0 || EpochFlag == 1) && Mapped != NULL) {
+			if (DecodeObservations(line, len) != OK) return Error();
+		} else if (EpochFlag == 0 || EpochFlag == 1)  {      
+			if (ProcessObservations(line, len) != OK) return Error();
 		} else if (EpochFlag == 6) {
-			if (ProcessFixups(line) != OK) return Error();
+			if (ProcessFixups(line, len) != OK) return Error();
 		} else {
-			if (ProcessEvent(line) != OK) return Error();
+			if (ProcessEvent(line, len) != OK) return Error();
 		}
 	} while (EpochFlag > 1);
 
-	AdjustToHz();
-
 	return OK;
 }
 
 int MaxSatsPerLine = 12;  // Make it a variable cause we have to read some old files
                           //  where it was done incorrectly.
 
-bool RawRinex::ProcessObservations(char* line)
+bool RawRinex::ReadSatellites(const char* line, int len, byte sats[MaxSats], int& NrSats)
+// The satellites of the epoch, reading continuation lines as needed
 {
-	// Get the number of satellites
-	int NrSats = GetInt(line, 30, 3);
+	NrSats = GetInt(line, len, 30, 3);
+	if (NrSats > MaxSats)
+		return Error("Rinex error: too many satellites (%d)\n", NrSats);
 
-	// Get the id of the first 12 satellites
-	byte sats[MaxSats];
-	for (int i=0; i<NrSats && i<MaxSatsPerLine; i++) {
-		int svid = ParseSvid(line, 32+3*i);
-		if (svid == -1) 
-			return Error("Bad Rinex SVID: i=%d line=%s\n", i, line);
+	for (int i=0; i<NrSats; i++) {
+		if (i > 0 && (i%MaxSatsPerLine) == 0)
+		    if (ReadLine(line, len) != OK) return Error();
+		int svid = ParseSvid(line, len, 32+3*(i%MaxSatsPerLine));
+		if (svid == -1)
+		    return Error("Bad Rinex SVID: i=%d line=%.*s\n", i, len, line);
 		sats[i] = (byte)SvidToSat(svid);
 	}
 
-	// Get the remaining ids, reading continuation lines as needed
-	//  Note: merge this with previous block of code
-	for (int i=MaxSatsPerLine; i<NrSats; i++) {
-		char line[128];
-		if ( (i%MaxSatsPerLine) == 0)
-		    if (ReadLine(line, sizeof(line)) != OK) return Error();
-		int svid = ParseSvid(line, 32+3*(i%MaxSatsPerLine));
-		if (svid == -1)
-		    return Error("Bad Rinex SVID: i=$d line=%s\n", i, line);
-		sats[i] = SvidToSat(svid);
+	return OK;
+}
+
+
+
+inline void RawRinex::Store(RawObservation& o, int j, double value, char lli, char ssi)
+// Put one observation where it belongs
+{
+	switch (Field[j]) {
+	case Range:    o.PR = value;  break;
+	case Doppler:  o.Doppler = value;  break;
+	case Strength: o.SNR = value;  break;
+	case Phase:
+		o.Phase = value;
+		o.Slip = value == 0 || (IsDigit(lli) && ((lli-'0')&1) != 0);
+		break;
 	}
 
+	// The signal strength flag, if we don't have anything better
+	if (ssi != ' ' && o.SNR == 0)
+		o.SNR = LevelToSnr(IsDigit(ssi)? ssi-'0': 0);
+}
+
+
+
+bool RawRinex::ProcessObservations(const char* line, int len)
+{
+	byte sats[MaxSats];
+	int NrSats;
+	if (ReadSatellites(line, len, sats, NrSats) != OK) return Error();
+
 	// Do for each satellite in view
 	for (int i=0; i<NrSats; i++) {
-		int Sat = sats[i];
-		RawObservation& o=obs[Sat];
+		RawObservation& o=obs[sats[i]];
 
 		// Set defaults in case we don't have measurement
 		o.PR = o.Phase = o.SNR = o.Doppler = 0;
 		o.Valid = true;
 
-		// Do for each observation in the RINEX file
+		// Do for each observation, five to a line
 		for (int j=0; j<NrMeasurements; j++) {
-			char line[128];
-
-			// Read an 80 char line when needed
-			int col = (j*16)%80;
+			int col = (j%5)*16;
 			if (col == 0)
-				if (ReadLine(line, sizeof(line)) != OK) return Error();
-
-			// Process according to the measurement type
-			if (j == L1Index) 
-				ParsePhaseObservation(line, col, o.Phase, o.Slip, o.SNR);
-            else if (j == C1Index)
-				ParseObservation(line, col, o.PR, o.SNR);
-			else if (j == S1Index)
-				ParseObservation(line, col, o.SNR, o.SNR);
-			else if (j == D1Index)
-				ParseObservation(line, col, o.Doppler, o.SNR);
+				if (ReadLine(line, len) != OK) return Error();
+			if (Field[j] != Unused)
+				Store(o, j, GetFixed(line, len, col, 14, 3), 
+				      GetChar(line, len, col+14), GetChar(line, len, col+15));
 		}
 	}
 
@@ -206,93 +244,370 @@ bool RawRinex::ProcessObservations(char* line)
 }
 
 
-bool RawRinex::ProcessFixups(char* line)
+
+static inline bool IsEol(char c) {return c == '\n' || c == '\r';}
+
+static inline const char* FindEol(const char* p, const char* end)
 {
-	return Error("RawRinex - Phase fixups are not implemented yet\n");
+	const char* eol = (const char*)memchr(p, '\n', end-p);
+	return (eol != NULL)? eol: end;
 }
 
-bool RawRinex::ProcessEvent(char* line)
+
+#if defined(__GNUC__) && defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+/////////////////////////////////////////////////////////////////////////
+// Eight characters of a field at a time, loaded into a word with the
+//   first character in the low byte.
+/////////////////////////////////////////////////////////////////////////
+static const uint64 Ones = 0x0101010101010101ULL;
+
+static inline bool EightDigits(uint64 w)
+// Every byte is '0' to '9'
 {
-	// Get the number of header records which follow
-	int NrHeaders = GetInt(line, 30, 3);
-	if (NrHeaders > 999) return Error("Invalid RINEX event header\n");
+	return ((w & (0xF0*Ones)) | (((w + 0x06*Ones) & (0xF0*Ones)) >> 4)) == 0x33*Ones;
+}
 
-	// Skip the headers. (later, want to treat them as events)
-	for (int i=0; i<NrHeaders; i++) {
-		char line[128];
-		if (ReadLine(line, sizeof(line)) != OK) return Error();
+static inline uint64 EightDigitValue(uint64 w)
+// Combine the digits in pairs, then fours, then all eight
+{
+	w = (w & (0x0F*Ones)) * 2561 >> 8;
+	w = (w & 0x00FF00FF00FF00FFULL) * 6553601 >> 16;
+	return (w & 0x0000FFFF0000FFFFULL) * 42949672960001ULL >> 32;
+}
+
+
+static inline bool DecodeField(const char* f, double& value)
+/////////////////////////////////////////////////////////////////////////
+// An F14.3 observation or a blank one, as GetFixed would read it.
+//   False if the field holds anything else, including the end of line.
+/////////////////////////////////////////////////////////////////////////
+{
+	// The last eight places before the point, and the leading blanks
+	uint64 w; memcpy(&w, f+2, 8);
+	int k;
+	if (f[0] != ' ') k = 0;
+	else if (f[1] != ' ') k = 1;
+	else {
+		uint64 x = w ^ (0x20*Ones);
+		k = (x != 0)? 2 + (__builtin_ctzll(x) >> 3): 10;
+	}
+
+	// Blank
+	if (k == 10 && f[10] == ' ' && f[11] == ' ' && f[12] == ' ' && f[13] == ' ') {
+		value = 0;
+		return true;
+	}
+
+	bool negative = (k < 10 && f[k] == '-');
+	if (negative) k++;
+
+	// Everything after the blanks must be digits. Make the blanks zeros.
+	if (k > 2) {
+		uint64 m = (k >= 10)? ~(uint64)0: ((uint64)1 << (8*(k-2))) - 1;
+		w = (w & ~m) | ((0x30*Ones) & m);
+	}
+	if (!EightDigits(w)) return false;
+	int64 n = (int64)EightDigitValue(w);
+	if (k < 2) {
+		unsigned d0 = (k == 0)? (unsigned)(f[0]-'0'): 0, d1 = (unsigned)(f[1]-'0');
+		if (d0 >= 10 || d1 >= 10) return false;
+		n += (int64)(d0*10 + d1) * 100000000;
+	}
+
+	unsigned d1 = (unsigned)(f[11]-'0'), d2 = (unsigned)(f[12]-'0'), d3 = (unsigned)(f[13]-'0');
+	if (f[10] != '.' || d1 >= 10 || d2 >= 10 || d3 >= 10)
+		return false;
+
+	value = (double)(n*1000 + d1*100 + d2*10 + d3) / 1000.0;
+	if (negative) value = -value;
+	return true;
+}
+
+#else
+static inline bool DecodeField(const char* f, double& value)
+/////////////////////////////////////////////////////////////////////////
+// An F14.3 observation or a blank one, as GetFixed would read it.
+//   False if the field holds anything else, including the end of line.
+/////////////////////////////////////////////////////////////////////////
+{
+	int k = 0;
+	while (k < 10 && f[k] == ' ')
+		k++;
+
+	// Blank
+	if (k == 10 && f[10] == ' ' && f[11] == ' ' && f[12] == ' ' && f[13] == ' ') {
+		value = 0;
+		return true;
+	}
+
+	bool negative = (k < 10 && f[k] == '-');
+	if (negative) k++;
+
+	int64 n = 0;
+	for (; k < 10; k++) {
+		unsigned d = (unsigned)(f[k] - '0');
+		if (d >= 10) return false;
+		n = n*10 + d;
 	}
+
+	unsigned d1 = (unsigned)(f[11]-'0'), d2 = (unsigned)(f[12]-'0'), d3 = (unsigned)(f[13]-'0');
+	if (f[10] != '.' || d1 >= 10 || d2 >= 10 || d3 >= 10)
+		return false;
+
+	value = (double)(n*1000 + d1*100 + d2*10 + d3) / 1000.0;
+	if (negative) value = -value;
+	return true;
+}
+#endif
+
+
+bool RawRinex::DecodeObservations(const char* line, int len)
+/////////////////////////////////////////////////////////////////////////
+// The same as ProcessObservations, but decoding a mapped file in place.
+//   The observation lines are read in one pass. A whole field, number or
+//   blank, can't contain the end of the line, so we only look for the end
+//   of a line in the fields we skip, when a field is cut short, and to
+//   step over whatever follows the last field we want.
+/////////////////////////////////////////////////////////////////////////
+{
+	byte sats[MaxSats];
+	int NrSats;
+	if (ReadSatellites(line, len, sats, NrSats) != OK) return Error();
+
+	const char* p = Mapped->Next();
+	const char* end = Mapped->End();
+
+	// Do for each satellite in view
+	for (int i=0; i<NrSats; i++) {
+		RawObservation& o=obs[sats[i]];
+		o.PR = o.Phase = o.SNR = o.Doppler = 0;
+		o.Valid = true;
+
+		// Do for each line of observations
+		for (int first=0; first<NrMeasurements; first+=5) {
+			if (p >= end)
+				return Error("Rinex error: file ends in the middle of an epoch\n");
+			const char* eol = NULL;   // the end of the line, once we know it
+			const char* scan = p;     // the end of the line isn't before here
+
+			int last = min(first+5, NrMeasurements);
+			for (int j=first; j<last; j++) {
+				if (Field[j] == Unused) continue;
+				int col = (j-first)*16;
+				const char* f = p + col;
+
+				// The fields we skipped may hold the end of the line
+				if (eol == NULL && f > scan) {
+					const char* nl = (const char*)memchr(scan, '\n', min(f, end) - scan);
+					if (nl != NULL) eol = nl;
+					else            scan = min(f, end);
+				}
+
+				// The usual case: the whole field is there
+				double value;
+				if (eol == NULL && f+16 <= end && DecodeField(f, value)) {
+
+					// The flags may be cut off by the end of the line
+					char lli = f[14], ssi = f[15];
+					if (IsEol(lli))      lli = ssi = ' ', eol = f+14;
+					else if (IsEol(ssi)) ssi = ' ', eol = f+15;
+					Store(o, j, value, lli, ssi);
+					scan = f+14;
+					continue;
+				}
+
+				// Otherwise, find out where the line ends and read it carefully
+				if (eol == NULL)
+					eol = FindEol(scan, end);
+				int len = eol - p;
+				if (len > 0 && p[len-1] == '\r') len--;
+				Store(o, j, GetFixed(p, len, col, 14, 3), 
+				      GetChar(p, len, col+14), GetChar(p, len, col+15));
+			}
+
+			// On to the next line
+			if (eol == NULL || *eol != '\n')
+				eol = FindEol((eol != NULL)? eol: scan, end);
+			p = (eol < end)? eol+1: end;
+		}
+	}
+
+	Mapped->Skip(p);
 	return OK;
 }
 
 
-bool RawRinex::ParseRinexTime(char* line, Time& time)
+bool RawRinex::SeekTo(Time t)
+/////////////////////////////////////////////////////////////////////////
+// Go straight to the epoch, using the file's index. 
+//   Other streams can only read up to it.
+/////////////////////////////////////////////////////////////////////////
 {
-	// If the time fields are blank, then use existing time
-	if (match(line, 0, "     ")) return OK;
+	if (Mapped == NULL)
+		return RawReceiver::SeekTo(t);
+	if (Index == NULL && ReadIndex() != OK)
+		return Error();
+
+	// The index has the times as stamped, before AdjustToHz
+	int32 i = Index->Find(FirstRawTime(t));
+	if (i < Index->NrEpochs) {
+		Mapped->Seek(Index->Epochs[i].Offset);
+		Rewound(Index->Epochs[i].GpsTime);
+	} else {
+		Mapped->Seek(Mapped->Length());
+		Rewound(t);
+	}
 
-	// Get the date and time
-	int32 year, month, day, hour, min;
-	double sec;
-	year = GetInt(line,0, 4);
-	month = GetInt(line, 4, 3);
-	day = GetInt(line, 7, 3);
-	hour = GetInt(line, 10,3);
-	min = GetInt(line,13, 3);
-	sec = GetDouble(line, 16, 11);
+	debug("RawRinex::SeekTo: epoch=%d of %d  offset=%.0f\n", 
+		i, Index->NrEpochs, (double)Mapped->Tell());
+	return OK;
+}
 
-	// Since year is given as 2 digits, get the century from the 4 digit start time
-	int32 cent = StartYear/100;
-	if (year < StartYear%100) cent++;  // don't have to worry about this for a while
 
-	// Convert Date to time
-	time = DateToTime(cent*100+year, month, day) + TodToTime(hour, min, sec);
+
+bool RawRinex::ReadIndex()
+/////////////////////////////////////////////////////////////////////////
+// Use the index next to the file. If there isn't a current one, scan
+//   the file for the epoch lines and save what we find for next time.
+//   The scan only reads the epoch lines, and counts off the rest.
+/////////////////////////////////////////////////////////////////////////
+{
+	Index = new RinexIndex;
+	if (Index->Map(Mapped->FileName()) == OK)
+		return OK;
+
+	size_t pos = Mapped->Tell();
+	Mapped->Seek(Body);
+
+	vector<RinexIndex::Entry> entry;
+	Time time = 0;
+	for (;;) {
+		size_t offset = Mapped->Tell();
+		const char* line; int len;
+		if (ReadLine(line, len) != OK) break;
+
+		int EpochFlag = GetInt(line, len, 28, 1);
+		int count = GetInt(line, len, 30, 3);
+		ParseRinexTime(line, len, time);
+
+		// An epoch with observations has continuation lines for the
+		//   satellites, and lines of observations for each one
+		if (EpochFlag == 0 || EpochFlag == 1) {
+			int lines = (count > 0)? (count-1)/MaxSatsPerLine: 0;
+			lines += count * ((NrMeasurements+4)/5);
+			if (SkipLines(lines) != OK) break;
+			RinexIndex::Entry e = {time, offset};
+			entry.push_back(e);
+		} 
+
+		// We can't read phase fixups, so nobody gets past them
+		else if (EpochFlag == 6)
+			break;
+
+		// Any other event has "count" header records
+		else if (SkipLines(count) != OK)
+			break;
+	}
+
+	Mapped->Seek(pos);
+	debug("RawRinex::ReadIndex: %s has %d epochs\n", Mapped->FileName(), entry.size());
+
+	RinexIndex::Entry none;
+	if (Index->Create(Mapped->FileName(), entry.empty()? &none: &entry[0], entry.size()) != OK)
+		return Error();
+	if (Index->Save() != OK)
+		debug("RawRinex: couldn't save the index of %s\n", Mapped->FileName());
 
 	return OK;
 }
 
 
+bool RawRinex::SkipLines(int count)
+{
+	for (int i=0; i<count; i++) {
+		const char* line; size_t len;
+		if (Mapped->NextLine(line, len) != OK) return Error();
+	}
+	return OK;
+}
 
 
-bool RawRinex::ParsePhaseObservation(char* line, int col, double& phase, bool& slip, double& snr)
+
+bool RawRinex::ProcessFixups(const char* line, int len)
 {
-	phase = GetDouble(line, col, 14);
-	slip = phase == 0 || (GetInt(line, col+14, 1)&1) != 0;
-	if (line[col+15] != ' ' && snr == 0)
-		snr = LevelToSnr(GetInt(line, col+15, 1));
-	debug(3, "ParsePhaseObservation: col=%d phase=%.3f slip=%d\n", col, phase, slip);
-	return false;
+	return Error("RawRinex - Phase fixups are not implemented yet\n");
 }
 
-bool RawRinex::ParseObservation(char* line, int col, double& value, double& snr)
+bool RawRinex::ProcessEvent(const char* line, int len)
 {
-	value = GetDouble(line, col,14);
-	if (line[col+15] != ' ' && snr == 0)
-		snr = LevelToSnr(GetInt(line, col+15, 1));
-	debug(3, "ParseObservation: col=%d value=%.3f  snr=%.3f\n", col, value, snr);
+	// Get the number of header records which follow
+	int NrHeaders = GetInt(line, len, 30, 3);
+	if (NrHeaders > 999) return Error("Invalid RINEX event header\n");
+
+	// Skip the headers. (later, want to treat them as events)
+	for (int i=0; i<NrHeaders; i++)
+		if (ReadLine(line, len) != OK) return Error();
 	return OK;
 }
 
-bool RawRinex::ReadLine(char* line, int len)
+
+bool RawRinex::ParseRinexTime(const char* line, int len, Time& time)
 {
-	bool ret = In.ReadLine(line, len);
-	
-	// get the length of the line
-	int slen = strlen(line);
-	debug(4, "Rinex::ReadLine   len=%d  slen=%d  line=%s\n",len,slen,line);
+	// If the time fields are blank, then use existing time
+	if (match(line, len, 0, "     ")) return OK;
+
+	// Most epochs are on the same day as the one before
+	if (len < 10 || memcmp(line, Date, sizeof(Date)) != 0) {
+		int32 year, month, day;
+		year = GetInt(line, len, 0, 4);
+		month = GetInt(line, len, 4, 3);
+		day = GetInt(line, len, 7, 3);
+
+		// Since year is given as 2 digits, get the century from the 4 digit start time
+		int32 cent = StartYear/100;
+		if (year < StartYear%100) cent++;  // don't have to worry about this for a while
+
+		Day = DateToTime(cent*100+year, month, day);
+		memset(Date, 0, sizeof(Date));
+		memcpy(Date, line, min(len, (int)sizeof(Date)));
+	}
 
-	// fill in the trailing spaces
-	for (int i=slen; i<len-1; i++)
-		line[i] = ' ';
+	// Add the time of day
+	int32 hour = GetInt(line, len, 10,3);
+	int32 min = GetInt(line, len, 13, 3);
+	double sec = GetFixed(line, len, 15, 11, 7);
+	time = Day + TodToTime(hour, min, sec);
+
+	return OK;
+}
 
-	// And always terminate with a null
-	line[len-1] = '\0';
 
-	debug(4, "Rinex::ReadLine - ""%s""\n", line);
-	return ret;
+
+
+bool RawRinex::ReadLine(const char*& line, int& len)
+/////////////////////////////////////////////////////////////////////////
+// The next line, without padding. The parsers treat any columns
+//   past the end as blanks. A mapped file is read in place; anything
+//   else is copied into our buffer, good until the next line.
+/////////////////////////////////////////////////////////////////////////
+{
+	if (Mapped != NULL) {
+		size_t n;
+		if (Mapped->NextLine(line, n) != OK) return Error();
+		len = (int)n;
+	} else {
+		if (In.ReadLine(Buf, sizeof(Buf)) != OK) return Error();
+		line = Buf;
+		len = strlen(Buf);
+	}
+
+	debug(4, "Rinex::ReadLine   len=%d  line=%.*s\n", len, len, line);
+	return OK;
 }
 
 RawRinex::~RawRinex()
 {
+	if (Index != NULL)
+		delete Index;
 }
 
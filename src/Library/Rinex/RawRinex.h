@@ -22,34 +22,53 @@
 
 #include "RawReceiver.h"
 #include "Stream.h"
+#include "MmapInputFile.h"
+#include "RinexIndex.h"
 
 class RawRinex : public RawReceiver  
 {
 protected:
 	Stream& In;
+	MmapInputFile* Mapped;   // the same stream, if we can parse it in place
+	char Buf[128];           // otherwise, a copy of the current line
 	// Header Information we need to keep
 	int L1Index;
 	int C1Index;
 	int D1Index;
 	int S1Index;
 	int NrMeasurements;
+	enum {Unused, Range, Phase, Doppler, Strength};
+	byte Field[9];           // what each observation is, by the indices above
 	int StartYear;
+	char Date[10];     // the date of the last epoch, as in the file
+	Time Day;          // and its start
+	size_t Body;       // where the epochs start in a mapped file
+	RinexIndex* Index; // and where each one is, once we need to know
 public:
 	RawRinex(Stream& s);
 	virtual ~RawRinex();
 	virtual bool NextEpoch();
+	virtual bool SeekTo(Time t);
+
+	// The epoch as it is in the file, not adjusted to the clock.
+	//   For a mapped file, also where its epoch line starts.
+	bool ReadEpoch();
+	size_t EpochOffset;
 private:
 	bool Initialize(int baud=9600);
 	bool ReadHeader();
-	bool ReadLine(char* line, int len);
+	bool ReadIndex();
+	bool SkipLines(int count);
+	bool ReadLine(const char*& line, int& len);
 
-	bool ProcessObservations(char* line);
-	bool ProcessFixups(char* line);
-	bool ProcessEvent(char* line);
+	bool ReadSatellites(const char* line, int len, byte sats[MaxSats], int& NrSats);
+	bool ProcessObservations(const char* line, int len);
+	bool DecodeObservations(const char* line, int len);
+	void Store(RawObservation& o, int field, double value, char lli, char ssi);
+	bool ProcessFixups(const char* line, int len);
+	bool ProcessEvent(const char* line, int len);
 
-	bool ParseRinexTime(char* line, Time& time);
-	bool ParseObservation(char *line, int index, double& r, double& snr);
-	bool ParsePhaseObservation(char* line, int index, double& p, bool& slp, double& snr);
+	bool ParseRinexTime(const char* line, int len, Time& time);
 };
 
 
@@ -0,0 +1,365 @@
+// RawRinexStore reads a whole Rinex observation file into memory
+//    Part of Kinematic, a utility for GPS positioning
+//
+// Copyright (C) 2006  John Morris    www.precision-gps.org
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation, version 2.
+
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+
+#include "RawRinexStore.h"
+#include "RawRinex.h"
+#include "RinexIndex.h"
+#include "MmapInputFile.h"
+#include "Thread.h"
+
+int RinexThreads = 0;
+
+// Give each thread a few chunks, so they finish at about the same time,
+//   but don't bother splitting small files.
+static const int ChunksPerThread = 4;
+static const size_t MinChunkSize = 256*1024;
+static const int MaxLoaders = 64;
+
+// Smaller files are read faster than the threads can be started
+static const size_t MinThreadedSize = 4*1024*1024;
+
+
+
+//////////////////////////////////////////////////////////////////////
+// A piece of the file, and what was read from it
+//////////////////////////////////////////////////////////////////////
+
+struct RinexChunk
+{
+	size_t Begin, End;     // the epoch lines which start in here are ours
+	vector<RawRinexStore::Epoch> Epochs;
+	vector<RawRinexStore::Observation> Obs;
+	bool ErrCode;
+};
+
+
+class ChunkQueue
+{
+public:
+	ChunkQueue(RinexChunk* chunk, int count): Chunk(chunk), NrChunks(count), Next(0) {}
+
+	// Hand out the next chunk, or false if there are none left
+	bool Take(RinexChunk*& c)
+	{
+		m.Lock();
+		c = (Next < NrChunks)? &Chunk[Next++]: NULL;
+		m.Unlock();
+		return c != NULL;
+	}
+
+protected:
+	Mutex m;
+	RinexChunk* Chunk;
+	int NrChunks;
+	int Next;
+};
+
+
+
+//////////////////////////////////////////////////////////////////////
+// A thread which reads chunks with its own view of the file
+//////////////////////////////////////////////////////////////////////
+
+class RinexLoader : public Thread
+{
+public:
+	RinexLoader(const char* name, ChunkQueue& q);
+	inline bool GetError() {return ErrCode;}
+	void Work();
+
+protected:
+	void Run() {Work();}
+	bool Read(RinexChunk& c);
+
+	ChunkQueue& Queue;
+	MmapInputFile In;
+	RawRinex Rinex;
+	bool ErrCode;
+};
+
+
+RinexLoader::RinexLoader(const char* name, ChunkQueue& q)
+: Queue(q), In(name), Rinex(In)
+{
+	ErrCode = Rinex.GetError();
+}
+
+
+void RinexLoader::Work()
+{
+	RinexChunk* c;
+	while (ErrCode == OK && Queue.Take(c))
+		c->ErrCode = Read(*c);
+}
+
+
+bool RinexLoader::Read(RinexChunk& c)
+/////////////////////////////////////////////////////////////////////////
+// Read the epochs of a chunk. The last epoch may run past the end of
+//   the chunk, but an event before the next chunk's first epoch mustn't
+//   take that epoch with it.
+/////////////////////////////////////////////////////////////////////////
+{
+	In.Seek(c.Begin);
+	while (In.Tell() < c.End) {
+		if (Rinex.ReadEpoch() != OK) return Error();
+		if (Rinex.EpochOffset >= c.End) break;
+
+		RawRinexStore::Epoch e;
+		e.GpsTime = Rinex.GpsTime;
+		e.Offset = Rinex.EpochOffset;
+		e.First = c.Obs.size();
+		for (int s=0; s<MaxSats; s++) {
+			RawObservation& o = Rinex.obs[s];
+			if (!o.Valid) continue;
+			RawRinexStore::Observation so = {o.PR, o.Phase, o.SNR, o.Doppler, (byte)s, o.Slip};
+			c.Obs.push_back(so);
+		}
+		e.NrObs = c.Obs.size() - e.First;
+		c.Epochs.push_back(e);
+	}
+
+	return OK;
+}
+
+
+
+static bool IsEpochLine(const char* p, const char* end)
+/////////////////////////////////////////////////////////////////////////
+// Does the line look like the epoch line of an epoch with observations?
+//   " yy mm dd hh mm ss.sssssss  f nnn" where the flag f is 0 or 1.
+//   Blanks must be blank, 'n' is a digit or blank, 'd' is a digit.
+/////////////////////////////////////////////////////////////////////////
+{
+	static const char pattern[] = " nd nd nd nd nd nd.ddddddd  fnnd";
+	if (end - p < (int)sizeof(pattern)-1) return false;
+
+	for (int i=0; pattern[i] != 0; i++) {
+		char c = p[i];
+		bool digit = (c >= '0' && c <= '9');
+		switch (pattern[i]) {
+		case 'n': if (!digit && c != ' ') return false; break;
+		case 'd': if (!digit) return false; break;
+		case 'f': if (c != '0' && c != '1') return false; break;
+		default:  if (c != pattern[i]) return false; break;
+		}
+	}
+	return true;
+}
+
+
+static size_t FindEpochLine(const char* data, size_t pos, size_t size)
+// The start of the first epoch line after pos, or size if there isn't one
+{
+	const char* end = data + size;
+	const char* p = data + pos;
+	for (;;) {
+		p = (const char*)memchr(p, '\n', end-p);
+		if (p == NULL) return size;
+		p++;
+		if (IsEpochLine(p, end)) return p - data;
+	}
+}
+
+
+
+
+//////////////////////////////////////////////////////////////////////
+// Construction/Destruction
+//////////////////////////////////////////////////////////////////////
+
+RawRinexStore::RawRinexStore(const char* name, int threads)
+{
+	strcpy(Description, "RinexFile");
+	Next = 0;
+
+	// Create dummy ephemerides
+	for (int s=0; s<MaxSats; s++)
+		eph[s] = new EphemerisDummy(s, "Rinex Dummy Ephemeris");
+
+	ErrCode = Load(name, max(1, min(threads, MaxLoaders)));
+}
+
+
+
+bool RawRinexStore::Load(const char* name, int threads)
+{
+	// Read the header. The loaders bring in the rest of the file as they go.
+	MmapInputFile in(name);
+	RawRinex header(in);
+	if (header.GetError() != OK)
+		return Error("Unable to open Rinex input file %s\n", name);
+	Pos = header.Pos;
+
+	size_t body = in.Tell();
+	size_t size = in.Length();
+	const char* data = in.Next() - body;
+
+	// Decide where to split the file
+	RinexIndex index;
+	bool indexed = (index.Map(name) == OK);
+
+	// Only use threads on a big file, and only as many as there are processors
+	if (size - body < MinThreadedSize)
+		threads = 1;
+	threads = max(1, min(threads, Thread::Processors()));
+
+	int count = (threads == 1)? 1: max(1, min(threads*ChunksPerThread, (int)((size-body)/MinChunkSize)));
+	if (indexed)
+		count = max(1, min(count, (int)index.NrEpochs));
+
+	vector<size_t> split;
+	split.push_back(body);
+	for (int k=1; k<count; k++) {
+		size_t pos;
+		if (indexed)
+			pos = index.Epochs[(int64)k*index.NrEpochs/count].Offset;
+		else
+			pos = FindEpochLine(data, body + (size-body)/count*k, size);
+		if (pos > split.back() && pos < size)
+			split.push_back(pos);
+	}
+	split.push_back(size);
+
+	vector<RinexChunk> chunk(split.size()-1);
+	for (size_t k=0; k<chunk.size(); k++) {
+		chunk[k].Begin = split[k];
+		chunk[k].End = split[k+1];
+		chunk[k].ErrCode = OK;
+	}
+	debug("RawRinexStore: %s  chunks=%d  threads=%d  indexed=%d\n",
+		name, (int)chunk.size(), threads, indexed);
+
+	// Read the chunks, with this thread helping out
+	ChunkQueue queue(&chunk[0], chunk.size());
+	threads = min(threads, (int)chunk.size());
+	RinexLoader* loader[MaxLoaders] = {NULL};
+	bool err = OK;
+	for (int i=0; i<threads; i++) {
+		loader[i] = new RinexLoader(name, queue);
+		if (loader[i]->GetError() != OK) err = Error();
+		else if (i > 0 && loader[i]->Start() != OK) err = Error();
+	}
+	if (err == OK && loader[0] != NULL)
+		loader[0]->Work();
+
+	for (int i=0; i<threads; i++) {
+		if (i > 0 && loader[i]->Join() != OK) err = Error();
+		if (loader[i]->GetError() != OK) err = Error();
+		delete loader[i];
+	}
+	if (err != OK)
+		return Error("RawRinexStore: couldn't read %s\n", name);
+
+	// Put the chunks together. As with RawRinex, the data ends at the
+	//   first epoch we couldn't read. A single chunk is already together.
+	bool complete = true;
+	if (chunk.size() == 1) {
+		Epochs.swap(chunk[0].Epochs);
+		Obs.swap(chunk[0].Obs);
+		complete = (chunk[0].ErrCode == OK);
+	}
+
+	else {
+		size_t epochs = 0, observations = 0;
+		for (size_t k=0; k<chunk.size(); k++) {
+			epochs += chunk[k].Epochs.size();
+			observations += chunk[k].Obs.size();
+		}
+		Epochs.reserve(epochs);
+		Obs.reserve(observations);
+
+		for (size_t k=0; k<chunk.size() && complete; k++) {
+			int32 first = Obs.size();
+			for (size_t i=0; i<chunk[k].Epochs.size(); i++) {
+				Epochs.push_back(chunk[k].Epochs[i]);
+				Epochs.back().First += first;
+			}
+			Obs.insert(Obs.end(), chunk[k].Obs.begin(), chunk[k].Obs.end());
+			complete = (chunk[k].ErrCode == OK);
+		}
+	}
+	debug("RawRinexStore: epochs=%d  observations=%d  complete=%d\n",
+		(int)Epochs.size(), (int)Obs.size(), complete);
+
+	// Remember where the epochs are for next time. If the file ended
+	//   early, these are still the epochs anyone can read.
+	if (!indexed) {
+		vector<RinexIndex::Entry> entry(Epochs.size());
+		for (size_t i=0; i<Epochs.size(); i++) {
+			entry[i].GpsTime = Epochs[i].GpsTime;
+			entry[i].Offset = Epochs[i].Offset;
+		}
+		if (entry.empty() || index.Create(name, &entry[0], entry.size()) != OK
+		 || index.Save() != OK)
+			debug("RawRinexStore: couldn't save the index of %s\n", name);
+	}
+
+	return OK;
+}
+
+
+
+bool RawRinexStore::NextEpoch()
+{
+    for (int s=0; s<MaxSats; s++)
+		obs[s].Valid = false;
+
+	if (Next >= Epochs.size()) return Error();
+	Epoch& e = Epochs[Next++];
+
+	// Put the observations back where RawRinex would have them
+	GpsTime = e.GpsTime;
+	for (int i=0; i<e.NrObs; i++) {
+		Observation& so = Obs[e.First+i];
+		RawObservation& o = obs[so.Sat];
+		o.Valid = true;
+		o.PR = so.PR;  o.Phase = so.Phase;
+		o.SNR = so.SNR;  o.Doppler = so.Doppler;
+		o.Slip = so.Slip;
+	}
+
+	AdjustToHz();
+	return OK;
+}
+
+
+
+bool RawRinexStore::SeekTo(Time t)
+// Everything is in memory, so just find the first epoch at or after t.
+//   The epochs have their times as stamped, before AdjustToHz.
+{
+	Time first = FirstRawTime(t);
+	size_t lo = 0, hi = Epochs.size();
+	while (lo < hi) {
+		size_t mid = (lo + hi) / 2;
+		if (Epochs[mid].GpsTime < first) lo = mid + 1;
+		else                         hi = mid;
+	}
+
+	Next = lo;
+	Rewound((Next < Epochs.size())? Epochs[Next].GpsTime: t);
+	return OK;
+}
+
+
+
+RawRinexStore::~RawRinexStore()
+{
+}
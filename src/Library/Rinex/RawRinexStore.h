@@ -0,0 +1,86 @@
+// RawRinexStore.h: a Rinex observation file, read whole into memory
+//    Part of Kinematic, a utility for GPS positioning
+//
+// Copyright (C) 2006  John Morris    www.precision-gps.org
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation, version 2.
+
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+
+#ifndef RAWRINEXSTORE_INCLUDED
+#define RAWRINEXSTORE_INCLUDED
+
+#include "RawReceiver.h"
+#include <vector>
+using namespace std;
+
+
+//////////////////////////////////////////////////////////////////////////////
+//
+// RawRinexStore reads a whole Rinex observation file when it is opened,
+//   and then hands out the epochs as RawRinex would.
+//
+// The file is split into chunks at epoch lines, and a few threads parse
+//   the chunks at the same time, each with its own RawRinex. The split
+//   points come from the file's RinexIndex if it has one. Otherwise we
+//   look for lines shaped like an epoch line with observations, and save
+//   an index of what we read for next time. Small files, and machines
+//   with a single processor, are read by one thread.
+//
+// On one processor the store is slower than decoding the mapped file in
+//   place (65-75 vs 41-53 msec for 43200 epochs), and it hasn't yet been
+//   timed on several, so Process accepts -load but doesn't list it.
+//
+// The store keeps only the satellites actually observed, in file order.
+//   The clock adjustment depends on the epoch before, so it is still
+//   done one epoch at a time in NextEpoch.
+//
+//////////////////////////////////////////////////////////////////////////////
+
+extern int RinexThreads;   // if > 0, Rinex files are read whole with this many threads
+
+
+class RawRinexStore : public RawReceiver
+{
+public:
+	RawRinexStore(const char* name, int threads = RinexThreads);
+	virtual ~RawRinexStore();
+	virtual bool NextEpoch();
+	virtual bool SeekTo(Time t);
+
+	// A satellite's observation, as read from the file
+	struct Observation
+	{
+		double PR, Phase, SNR, Doppler;
+		byte Sat;
+		bool Slip;
+	};
+
+	// An epoch and its observations
+	struct Epoch
+	{
+		Time GpsTime;
+		uint64 Offset;     // where its epoch line is in the file
+		int32 First;       // its first observation
+		int32 NrObs;
+	};
+
+protected:
+	vector<Epoch> Epochs;
+	vector<Observation> Obs;
+	size_t Next;           // the next epoch to hand out
+
+	bool Load(const char* name, int threads);
+};
+
+#endif // RAWRINEXSTORE_INCLUDED
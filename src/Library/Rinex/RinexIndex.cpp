@@ -0,0 +1,157 @@
+// RinexIndex says where each epoch of a Rinex file starts
+//    Part of Kinematic, a utility for GPS positioning
+//
+// Copyright (C) 2006  John Morris    www.precision-gps.org
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation, version 2.
+
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+
+#include "RinexIndex.h"
+
+
+static const char IndexMagic[8] = "KinRnxA";   // change when the layout changes
+static const size_t HashedBytes = 64*1024;    // from each end of the file
+
+
+RinexIndex::RinexIndex()
+{
+	File = NULL;
+	Buffer = NULL;
+	NrEpochs = 0;
+	Epochs = NULL;
+}
+
+
+
+bool RinexIndex::Map(const char* rinexname)
+/////////////////////////////////////////////////////////////////////////
+// Use an existing index of the Rinex file. Quietly fails if there isn't
+//   a current one.
+/////////////////////////////////////////////////////////////////////////
+{
+	snprintf(IndexName, sizeof(IndexName), "%s.index", rinexname);
+
+	// Is there an index file?
+	uint64 size; int64 mtime;
+	if (MappedFile::Stat(IndexName, size, mtime) != OK || size < sizeof(Header))
+		return Error();
+
+	// Map it and check the header
+	if (File != NULL) delete File;
+	File = new MappedFile(IndexName);
+	if (File->GetError() != OK || File->Size() < sizeof(Header))
+		return Error();
+	const Header& h = *(const Header*)File->Data();
+	if (memcmp(h.Magic, IndexMagic, sizeof(IndexMagic)) != 0
+	 || h.HeaderSize != sizeof(Header) || h.NrEpochs < 0
+	 || File->Size() != sizeof(Header) + h.NrEpochs*sizeof(Entry))
+		return Error();
+
+	// Make sure it is an index of the current Rinex file
+	uint64 hash;
+	if (Describe(rinexname, size, mtime, hash) != OK
+	 || size != h.SourceSize || mtime != h.SourceTime || hash != h.SourceHash)
+		return Error();
+
+	NrEpochs = h.NrEpochs;
+	Epochs = (const Entry*)(File->Data() + sizeof(Header));
+	debug("RinexIndex: using %s  epochs=%d\n", IndexName, NrEpochs);
+	return OK;
+}
+
+
+
+bool RinexIndex::Create(const char* rinexname, const Entry* entries, int32 count)
+/////////////////////////////////////////////////////////////////////////
+// Make an index in memory from the epochs we found. Save() keeps it.
+/////////////////////////////////////////////////////////////////////////
+{
+	snprintf(IndexName, sizeof(IndexName), "%s.index", rinexname);
+	if (File != NULL) delete File;
+	if (Buffer != NULL) free(Buffer);
+	File = NULL;
+
+	size_t size = sizeof(Header) + count*sizeof(Entry);
+	Buffer = (byte*)calloc(size, 1);
+	if (Buffer == NULL)
+		return Error("RinexIndex: no memory for %d epochs\n", count);
+
+	Header& h = *(Header*)Buffer;
+	memcpy(h.Magic, IndexMagic, sizeof(IndexMagic));
+	h.HeaderSize = sizeof(Header);
+	h.NrEpochs = count;
+	memcpy(Buffer + sizeof(Header), entries, count*sizeof(Entry));
+
+	NrEpochs = count;
+	Epochs = (const Entry*)(Buffer + sizeof(Header));
+	return Describe(rinexname, h.SourceSize, h.SourceTime, h.SourceHash);
+}
+
+
+bool RinexIndex::Save()
+{
+	if (Buffer == NULL)
+		return Error("RinexIndex: nothing to save\n");
+	return MappedFile::SaveAs(IndexName, Buffer, sizeof(Header) + NrEpochs*sizeof(Entry));
+}
+
+
+
+int32 RinexIndex::Find(Time t)
+// The epochs are in time order, so do a binary search
+{
+	int32 lo = 0, hi = NrEpochs;
+	while (lo < hi) {
+		int32 mid = (lo + hi) / 2;
+		if (Epochs[mid].GpsTime < t) lo = mid + 1;
+		else                         hi = mid;
+	}
+	return lo;
+}
+
+
+
+bool RinexIndex::Describe(const char* name, uint64& size, int64& mtime, uint64& hash)
+// Size, modification time, and a hash (64 bit FNV-1a) of both ends of a file
+{
+	if (MappedFile::Stat(name, size, mtime) != OK)
+		return Error();
+
+	MappedFile f(name);
+	if (f.GetError() != OK)
+		return Error();
+
+	const byte* p = f.Data();
+	size_t len = f.Size();
+	size_t front = min(len, HashedBytes);
+	size_t back = max(front, len - min(len, HashedBytes));
+
+	hash = 14695981039346656037ULL;
+	for (size_t i=0; i<front; i++)
+		hash = (hash ^ p[i]) * 1099511628211ULL;
+	for (size_t i=back; i<len; i++)
+		hash = (hash ^ p[i]) * 1099511628211ULL;
+
+	return OK;
+}
+
+
+
+RinexIndex::~RinexIndex()
+{
+	if (File != NULL)
+		delete File;
+	if (Buffer != NULL)
+		free(Buffer);
+}
@@ -0,0 +1,85 @@
+#ifndef RINEXINDEX_INCLUDED
+#define RINEXINDEX_INCLUDED
+// Part of Kinematic, a utility for GPS positioning
+//
+// Copyright (C) 2006  John Morris    www.precision-gps.org
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation, version 2.
+
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+
+
+
+#include "util.h"
+#include "GpsTime.h"
+#include "MappedFile.h"
+
+
+//////////////////////////////////////////////////////////////////////////////
+//
+// RinexIndex says where each epoch of a Rinex observation file starts.
+//   It is kept in a file next to the observations (name.index), and
+//   has an entry for each epoch with data, giving its time and the
+//   offset of its epoch line.
+//
+// As with the SP3Cache, the header records the size, modification time
+//   and a hash of the Rinex file, and the index is only used if they
+//   still match. The hash only covers the start and end of the file,
+//   so checking doesn't cost as much as reading it.
+//
+//////////////////////////////////////////////////////////////////////////////
+
+class RinexIndex
+{
+public:
+	RinexIndex();
+	virtual ~RinexIndex();
+
+	struct Entry
+	{
+		int64  GpsTime;
+		uint64 Offset;
+	};
+
+	// Use the existing index of the Rinex file, if there is a good one
+	bool Map(const char* rinexname);
+
+	// Or make one from the epochs we found, and save it
+	bool Create(const char* rinexname, const Entry* entries, int32 count);
+	bool Save();
+
+	// The first epoch at or after time t, or NrEpochs if there isn't one
+	int32 Find(Time t);
+
+	int32 NrEpochs;
+	const Entry* Epochs;
+
+private:
+	struct Header
+	{
+		char   Magic[8];
+		int32  HeaderSize;
+		int32  NrEpochs;
+		uint64 SourceSize;
+		int64  SourceTime;
+		uint64 SourceHash;
+	};
+
+	char IndexName[260];
+	MappedFile* File;   // an existing index
+	byte* Buffer;       // or one we made
+	static bool Describe(const char* name, uint64& size, int64& mtime, uint64& hash);
+};
+
+
+#endif // RINEXINDEX_INCLUDED
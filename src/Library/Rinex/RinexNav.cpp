@@ -0,0 +1,138 @@
+// RinexNav reads the broadcast ephemerides from a RINEX file
+// RawRinex reads raw gps data from a RINEX file
+//    Part of kinematic, a collection of utilities for GPS positioning
+//
+// Copyright (C) 2005  John Morris    kinematic@precision-gps.org
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation, version 2.
+
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+
+
+#include "RinexNav.h"
+#include "RinexParse.h"
+
+
+RinexNav::RinexNav(Stream& in)
+: In(in)
+{
+	if (In.GetError() != OK)
+		ErrCode = Error("Unable to open Rinex navigation file\n");
+	else
+		ErrCode = ReadHeader();
+}
+
+
+bool RinexNav::ReadHeader()
+{
+	char line[LineSize];
+
+	// The first line says what kind of file it is
+	if (ReadLine(line, sizeof(line)) != OK) 
+		return Error("Rinex navigation file is empty\n");
+	if (!match(line, 60, "RINEX VERSION / TYPE") || line[20] != 'N' || line[5] != '2')
+		return Error("Not a Rinex 2 GPS navigation file\n");
+
+	// Skip the rest of the header
+	while (ReadLine(line, sizeof(line)) == OK)
+		if (match(line, 60, "END OF HEADER"))
+			return OK;
+
+	return Error("Rinex navigation file has no END OF HEADER\n");
+}
+
+
+
+bool RinexNav::Read(EphemerisArchive& archive)
+/////////////////////////////////////////////////////////////////
+// Add all the ephemerides in the file to the archive
+/////////////////////////////////////////////////////////////////
+{
+	if (ErrCode != OK) return Error();
+
+	char line[LineSize];
+	int32 count = 0;
+	while (ReadLine(line, sizeof(line)) == OK) {
+		if (match(line, 0, "  ")) continue;  // blank line at the end
+
+		int32 svid = GetInt(line, 0, 2);
+		EphemerisXmit e(SvidToSat(svid), "Rinex Navigation");
+		if (svid < 1 || svid > 32)
+			return Error("Bad satellite in Rinex navigation file: %s\n", line);
+		if (ReadEphemeris(line, e) != OK) return Error();
+		if (archive.Add(e) != OK) return Error();
+		count++;
+	}
+
+	debug("RinexNav::Read  %d ephemerides\n", count);
+	return OK;
+}
+
+
+
+bool RinexNav::ReadEphemeris(char* line, EphemerisXmit& e)
+// The first line is already read. Get the other seven.
+{
+	// Epoch of the clock
+	int32 year = GetInt(line, 2, 3);
+	year += (year < 80)? 2000: 1900;
+	e.t_oc = DateToTime(year, GetInt(line, 5, 3), GetInt(line, 8, 3))
+	       + TodToTime(GetInt(line, 11, 3), GetInt(line, 14, 3), GetDouble(line, 17, 5));
+	e.a_f0 = GetDouble(line, 22, 19);
+	e.a_f1 = GetDouble(line, 41, 19);
+	e.a_f2 = GetDouble(line, 60, 19);
+
+	// The rest are four to a line
+	double v[7][4];
+	for (int i=0; i<7; i++) {
+		if (ReadLine(line, LineSize) != OK) 
+			return Error("Rinex navigation file ends in an ephemeris\n");
+		for (int j=0; j<4; j++)
+			v[i][j] = GetDouble(line, 3+19*j, 19);
+	}
+
+	e.iode = (int32)v[0][0]; e.c_rs = v[0][1]; e.delta_n = v[0][2]; e.m_0 = v[0][3];
+	e.c_uc = v[1][0];    e.e = v[1][1];      e.c_us = v[1][2];    e.sqrt_a = v[1][3];
+	double toe = v[2][0]; e.c_ic = v[2][1];  e.omega_0 = v[2][2]; e.c_is = v[2][3];
+	e.i_0 = v[3][0];     e.c_rc = v[3][1];   e.omega = v[3][2];   e.omegadot = v[3][3];
+	e.idot = v[4][0];    int32 week = (int32)v[4][2];
+	e.acc = v[5][0];     e.health = (int32)v[5][1];  e.t_gd = v[5][2];  e.iodc = (int32)v[5][3];
+	double fit = v[6][1];
+
+	e.t_oe = ConvertGpsTime(week, toe);
+	if (fit <= 0) fit = 4;
+	e.MinTime = e.t_oe - (Time)(fit/2 * NsecPerHour);
+	e.MaxTime = e.t_oe + (Time)(fit/2 * NsecPerHour);
+
+	return OK;
+}
+
+
+
+bool RinexNav::ReadLine(char* line, int len)
+// A line with the trailing spaces filled in. The file is small, so
+//   we needn't bother parsing in place.
+{
+	bool ret = In.ReadLine(line, len);
+
+	int slen = strlen(line);
+	for (int i=slen; i<len-1; i++)
+		line[i] = ' ';
+	line[len-1] = '\0';
+
+	return ret;
+}
+
+
+RinexNav::~RinexNav()
+{
+}
@@ -0,0 +1,52 @@
+// RinexNav.h: reads a RINEX navigation file
+//    Part of Kinematic, a utility for GPS positioning
+//
+// Copyright (C) 2005  John Morris    www.precision-gps.org
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation, version 2.
+
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+
+#ifndef RINEXNAV_INCLUDED
+#define RINEXNAV_INCLUDED
+
+#include "Stream.h"
+#include "EphemerisArchive.h"
+
+//////////////////////////////////////////////////////////////////////
+//
+// RinexNav reads the broadcast ephemerides from a RINEX 2 GPS
+//   navigation file into an archive.
+//
+//////////////////////////////////////////////////////////////////////
+
+class RinexNav
+{
+protected:
+	Stream& In;
+	bool ErrCode;
+
+public:
+	RinexNav(Stream& in);
+	bool Read(EphemerisArchive& archive);
+	virtual ~RinexNav();
+	inline bool GetError() {return ErrCode;}
+
+private:
+	static const int LineSize = 82;
+	bool ReadHeader();
+	bool ReadEphemeris(char* line, EphemerisXmit& e);
+	bool ReadLine(char* line, int len);
+};
+
+#endif // RINEXNAV_INCLUDED
@@ -20,12 +20,12 @@
 #include "RinexParse.h"
 
 
-bool match(char* line, int column, char* pattern)
+bool match(const char* line, int len, int column, const char* pattern)
 {
-	char* l = line+column;
-	char* p = pattern;
-	for (; *p != '\0'; p++,l++)
-		if (*p != *l)
+	int i = column;
+	const char* p = pattern;
+	for (; *p != '\0'; p++,i++)
+		if (*p != GetChar(line, len, i))
 			break;
 	
 
@@ -33,19 +33,18 @@ bool match(char* line, int column, char* pattern)
 }
 
 
-bool IsDigit(int c)
-{
-	return ('0' <= c && c <= '9');
-}
-
-
-double GetDouble(char* line, int column, int width)
+double GetDouble(const char* line, int len, int column, int width)
 {
 	double d = 0;
 	double negative = 1;
 	double fraction = 0;
+	int32 exponent = 0;
 
-	for (int i=column; i < column+width; i++)
+	// Missing columns are blank, and blanks don't count
+	int end = min(column+width, len);
+
+	int i;
+	for (i=column; i < end; i++)
 		if (line[i] == '-')
 			negative = -1;
 		else if (line[i] == '.')
@@ -54,19 +53,34 @@ double GetDouble(char* line, int column, int width)
 			fraction = fraction * 10;
 			d = d*10 + (line[i] - '0');
 		}
+		else if (line[i] == 'D' || line[i] == 'E' || line[i] == 'd' || line[i] == 'e')
+			break;   // navigation files have exponents
+
+	// The exponent, if any
+	int32 sign = 1;
+	for (i++; i < end; i++)
+		if (line[i] == '-')
+			sign = -1;
+		else if (IsDigit(line[i]))
+			exponent = exponent*10 + (line[i] - '0');
+	exponent *= sign;
 
 	if (fraction == 0)
 		fraction = 1;
 
-	return d / fraction * negative;
+	d = d / fraction * negative;
+	if (exponent != 0)
+		d *= pow(10.0, exponent);
+	return d;
 }
 
-int32 GetInt(char* line, int column, int width)
+int32 GetInt(const char* line, int len, int column, int width)
 {
     int32 n = 0;
 	int32 negative = 1;
 
-	for (int i=column; i < column+width; i++)
+	int end = min(column+width, len);
+	for (int i=column; i < end; i++)
 		if (line[i]== '-')
 			negative = -1;
 		else if (IsDigit(line[i]))
@@ -77,17 +91,18 @@ int32 GetInt(char* line, int column, int width)
 
 
 
-int32 ParseSvid(char* line, int col)
+int32 ParseSvid(const char* line, int len, int col)
 /////////////////////////////////////////////////////////
 // Convert a Satellite Id string to a satellite number
 //     GPS Satellites: 1-32
 //     EGNOS           120-152
 /////////////////////////////////////////////////////////
 {
-	if (line[col] == 'S')
-		return 100 + GetInt(line, col+1, 2);
-	else if (line[col] == 'G' || line[col] == ' ')
-		return GetInt(line, col+1,2);
+	char c = GetChar(line, len, col);
+	if (c == 'S')
+		return 100 + GetInt(line, len, col+1, 2);
+	else if (c == 'G' || c == ' ')
+		return GetInt(line, len, col+1,2);
 	else 
 		return -1;
 }
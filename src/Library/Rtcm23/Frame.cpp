@@ -25,9 +25,10 @@
 inline uint32 ExtractBits(uint32 word, int32 BitNr, int32 NrBits)
 ///////////////////////////////////////////////////////////////
 // ExtractBits extracts a bit field where bit 0 is MSB
+//   (uint32 is a long, so drop whatever is shifted past 32 bits)
 //////////////////////////////////////////////////////////////
 {
-	return (word<<BitNr)>>(32-NrBits);
+	return ((word<<BitNr) & 0xffffffff) >> (32-NrBits);
 }
 
 inline int32 ExtractSigned(uint32 word, int bitnr, int nrbits)
@@ -35,13 +36,13 @@ inline int32 ExtractSigned(uint32 word, int bitnr, int nrbits)
 // ExtractSigned extracts a signed bit field where bit 0 is MSB
 ////////////////////////////////////////////////////////////////////
 {
-	return ((int32)word<<bitnr)>>(32-nrbits);
+	return (int32)((int)(word<<bitnr) >> (32-nrbits));
 }
 
 inline uint32 InsertBits(uint32 value, uint32 word, int bitnr, int nrbits)
 {
 	uint32 mask = (~0u << (32-nrbits)) >> bitnr;
-	value =       (value << (32-nrbits)) >> bitnr;
+	value =       ((value << (32-nrbits)) & 0xffffffff) >> bitnr;
 	debug("InsertBits value=0x%x mask=0x%08x word=0x%08x bitnr=%d nrbits=%d\n",
 		value, mask, word, bitnr, nrbits);
 	return (word & ~mask) | value;	
@@ -159,13 +160,16 @@ int32 Frame::GetSigned(int wordnr, int first, int last)
 }
 
 void Frame::AddWord(uint32 value)
+// A full frame drops the extra words
 {
+	if (NrWords >= MaxWords) return;
 	NrWords++;
 	PutWord(NrWords, value);
 }
 
 void Frame::PutWord(int wordnr, uint32 value)
 {
+	if (wordnr < 1 || wordnr > MaxWords) return;
 	Data[wordnr-1] = value;
 }
 
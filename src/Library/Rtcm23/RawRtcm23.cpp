@@ -26,6 +26,7 @@ RawRtcm23::RawRtcm23(Stream& in)
 {
     strcpy(Description, "Rtcm23 3.1");
     ErrCode = In.GetError();
+    Mapped = dynamic_cast<MmapInputFile*>(&in);
     for (int s=0; s<MaxSats; s++) {
         CarrierLossCount[s] = -1;
         PreviousPhase[s] = 0;
@@ -40,12 +41,18 @@ RawRtcm23::RawRtcm23(Stream& in)
 
 bool RawRtcm23::NextEpoch()
 {
+	if (Holding()) return OK;
+
 	// Clear out our observations
 	for (int s=0; s<MaxSats; s++)
 		obs[s].Valid = HasPhase[s] = false;
 	MoreToCome = true;
 	EpochTow = -1;
 
+	// Remember where the epoch started, and any bits we already have
+	size_t start = (Mapped != NULL)? Mapped->Tell(): 0;
+	uint64 state = In.GetState();
+
 	// repeat until we get measurements without the "more" bits
 	while (MoreToCome) {
 
@@ -97,9 +104,60 @@ bool RawRtcm23::NextEpoch()
 	GpsTime = ConvertGpsTime(Week, EpochTow);
 	AdjustToHz();
 
+	if (Mapped != NULL)
+		Index.Add(GpsTime, start, state);
 	return OK;
 }
 
+
+
+bool RawRtcm23::SeekTo(Time t)
+/////////////////////////////////////////////////////////////////////////
+// Go to the first epoch at or after t, reading up to it from the last
+//   epoch we know about if we haven't been that far yet.
+/////////////////////////////////////////////////////////////////////////
+{
+	if (Mapped == NULL)
+		return RawReceiver::SeekTo(t);
+
+	if (Index.Empty() || Index.Last().GpsTime < t) {
+		if (!Index.Empty()) Restart(Index.Last());
+		while (NextEpoch() == OK && GpsTime < t)
+			;
+	}
+
+	size_t i = Index.Find(t);
+	if (i < Index.Size())
+		Restart(Index[i]);
+	else {
+		Mapped->Seek(Mapped->Length());
+		Rewound(t);
+	}
+
+	debug("RawRtcm23::SeekTo: epoch=%d of %d\n", i, Index.Size());
+	return OK;
+}
+
+
+void RawRtcm23::Restart(EpochIndex::Mark& m)
+/////////////////////////////////////////////////////////////////////////
+// Start over at an epoch, as though the data began there. The time
+//   tag is the hour of the epoch, and the phases start from scratch.
+/////////////////////////////////////////////////////////////////////////
+{
+	Mapped->Seek(m.Offset);
+	In.SetState(m.State);
+	Rewound(m.GpsTime);
+
+	Week = GpsWeek(m.GpsTime);
+	HourOfWeek = (int)(GpsTow(m.GpsTime) / 3600);
+	PreviousReceiverTime = -1;
+	for (int s=0; s<MaxSats; s++) {
+		CarrierLossCount[s] = -1;
+		PreviousPhase[s] = 0;
+	}
+}
+
 bool RawRtcm23::ProcessTimeTag(Frame& f)
 {
 	Week = f.GetField(3, 1, 10);
@@ -242,7 +300,9 @@ bool RawRtcm23::ProcessEphemeris(Frame& f)
 	// update the ephemeris with the new frame
         EphemerisXmitRaw r;
         f.ToRaw(r);
-	return e.FromRaw(r);
+	if (e.FromRaw(r) != OK) return Error();
+	Archived(e);
+	return OK;
 }
 
 bool RawRtcm23::GetMeasurementTime(Frame& f)
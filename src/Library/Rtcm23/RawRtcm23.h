@@ -21,12 +21,19 @@
 
 #include "Rtcm23In.h"
 #include "RawReceiver.h"
+#include "EphemerisXmit.h"
+#include "EpochIndex.h"
+#include "MmapInputFile.h"
 
 class RawRtcm23: public RawReceiver
 {
 protected:
 	Rtcm23In In;
 
+	// A mapped file can go back to the epochs it has read
+	MmapInputFile* Mapped;
+	EpochIndex Index;
+
 	// To keep track of slips and overflows between epochs
 	int32 CarrierLossCount[MaxSats];
 	int64 PreviousPhase[MaxSats];
@@ -45,7 +52,9 @@ protected:
 public:
 	RawRtcm23(Stream& in);
 	virtual bool NextEpoch();
+	virtual bool SeekTo(Time t);
 	virtual ~RawRtcm23(void);
+	virtual EphemerisXmit* Broadcast(int s) {return (EphemerisXmit*)eph[s];}
 
 private:
 	bool ProcessTimeTag(Frame& f);
@@ -56,6 +65,7 @@ private:
 	bool ProcessEphemeris(Frame& f);
 	void Header(Frame& f, Time& t, int& type);
 	bool GetMeasurementTime(Frame& f);
+	void Restart(EpochIndex::Mark& m);
 };
 
 #endif // RAWRtcm23_INCLUDED
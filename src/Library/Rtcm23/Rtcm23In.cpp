@@ -69,9 +69,16 @@ bool Rtcm23In::ReadFrame(Frame& f, bool& slip)
 			slip=true;
 		}
 
-		// CASE: word 2, get the length
-		else if (f.NrWords == 2)
+		// CASE: word 2, get the length. A frame too long to hold
+		//   means we aren't really synchronized.
+		else if (f.NrWords == 2) {
 			Length = f.GetField(2, 17, 21);
+			if (Length > Frame::MaxWords) {
+				f.Init();
+				slip = true;
+				Length = 2;
+			}
+		}
 	}
 
 	if (slip) debug("Frame slipped!\n");
@@ -33,6 +33,10 @@ public:
 	Rtcm23In(Stream& in);
 	bool ReadFrame(Frame& f, bool& slip);
 	bool GetError() {return ErrCode;}
+
+	// The bits left over from the last word, so we can start again there
+	uint64 GetState() {return (RawWord & 0xff) | ((uint64)BitShift << 8);}
+	void SetState(uint64 state) {RawWord = state & 0xff; BitShift = (int)(state >> 8);}
 	virtual ~Rtcm23In(void);
 private:
 	bool ReadWord(uint32& word, bool& slip);
@@ -26,6 +26,7 @@ RawRtcm3::RawRtcm3(Stream& in)
 {
     strcpy(Description, "Rtcm3.1");
     ErrCode = In.GetError();
+    Mapped = dynamic_cast<MmapInputFile*>(&in);
     for (int s=0; s<MaxSats; s++) {
         PreviousPhase[s] = 0;
         PhaseAdjust[s] = 0;
@@ -42,6 +43,11 @@ RawRtcm3::RawRtcm3(Stream& in)
 
 bool RawRtcm3::NextEpoch()
 {
+	if (Holding()) return OK;
+
+    // Remember where the epoch started
+    size_t start = (Mapped != NULL)? Mapped->Tell(): 0;
+
     // repeat until we get an observation record or an error
     bool errcode;
     Block b;
@@ -58,11 +64,56 @@ bool RawRtcm3::NextEpoch()
 
     } until ( (b.Id == 1002 && GpsTime != -1) || errcode != OK);
 
+    if (errcode == OK && Mapped != NULL)
+        Index.Add(GpsTime, start);
     return errcode;
 }
 
 
 
+bool RawRtcm3::SeekTo(Time t)
+/////////////////////////////////////////////////////////////////////////
+// Go to the first epoch at or after t. We only know where the epochs
+//   are once we've read them, so if t is further on, read up to it
+//   from the last epoch we know about.
+/////////////////////////////////////////////////////////////////////////
+{
+    if (Mapped == NULL)
+        return RawReceiver::SeekTo(t);
+
+    if (Index.Empty() || Index.Last().GpsTime < t) {
+        if (!Index.Empty()) Restart(Index.Last());
+        while (NextEpoch() == OK && GpsTime < t)
+            ;
+    }
+
+    size_t i = Index.Find(t);
+    if (i < Index.Size())
+        Restart(Index[i]);
+    else {
+        Mapped->Seek(Mapped->Length());
+        Rewound(t);
+    }
+
+    debug("RawRtcm3::SeekTo: epoch=%d of %d\n", i, Index.Size());
+    return OK;
+}
+
+
+void RawRtcm3::Restart(EpochIndex::Mark& m)
+// Start over at an epoch, as though the data began there
+{
+    Mapped->Seek(m.Offset);
+    Rewound(m.GpsTime);
+    for (int s=0; s<MaxSats; s++) {
+        PhaseAdjust[s] = 0;
+        PreviousPhaseRange[s] = 0;
+        PreviousLockTime[s] = 0;
+    }
+}
+
+
+
 bool RawRtcm3::ProcessObservations(Block& blk)
 {
 
@@ -180,7 +231,7 @@ bool RawRtcm3::ProcessEphemeris(Block& blk)
     r.t_oc = b.GetBits(16);
     r.a_f2 = b.GetSignedBits(8);
     r.a_f1 = b.GetSignedBits(16);
-    r.a_f2 = b.GetSignedBits(22);
+    r.a_f0 = b.GetSignedBits(22);
     r.iodc = b.GetBits(10);
     r.c_rs = b.GetSignedBits(16);
     r.delta_n = b.GetSignedBits(16);
@@ -210,8 +261,10 @@ bool RawRtcm3::ProcessEphemeris(Block& blk)
     if (&e == 0) return Error("rtcm ephemeris isn't correct\n");
 
     // If ephemeris changed, then update it
-    if (e.iode != r.iode || e.iodc != r.iodc)
+    if (e.iode != r.iode || e.iodc != r.iodc) {
         if (e.FromRaw(r) != OK) return Error(); 
+        Archived(e);
+    }
 
     // If we guessed the time, now update it with the ephemeris time
     if (GuessTime) {
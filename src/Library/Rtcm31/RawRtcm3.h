@@ -21,12 +21,19 @@
 
 #include "CommRtcm3.h"
 #include "RawReceiver.h"
+#include "EphemerisXmit.h"
+#include "EpochIndex.h"
+#include "MmapInputFile.h"
 
 class RawRtcm3: public RawReceiver
 {
 protected:
 	CommRtcm3 In;
 
+	// A mapped file can go back to the epochs it has read
+	MmapInputFile* Mapped;
+	EpochIndex Index;
+
 	// To keep track of slips and overflows between epochs
         int32 PhaseAdjust[MaxSats];
         int32 OldPhase[MaxSats];
@@ -37,13 +44,16 @@ protected:
 public:
 	RawRtcm3(Stream& in);
 	virtual bool NextEpoch();
+	virtual bool SeekTo(Time t);
 	virtual ~RawRtcm3(void);
+	virtual EphemerisXmit* Broadcast(int s) {return (EphemerisXmit*)eph[s];}
 
 private:
 	bool ProcessStationRef(Block& b);
 	bool ProcessAntennaRef(Block& b);
 	bool ProcessObservations(Block& b);
         bool ProcessEphemeris(Block& b);
+	void Restart(EpochIndex::Mark& m);
 
         double PreviousPhaseRange[MaxSats];
         int PreviousLockTime[MaxSats];
@@ -246,7 +246,7 @@ bool Rtcm3Station::OutputEphemeris(int s, Time& NextTime)
     b.PutBits(r.iode, 8);
     b.PutBits(r.t_oc, 16);
     b.PutBits(r.a_f2, 8);
-    b.PutBits(r.a_f2, 16);
+    b.PutBits(r.a_f1, 16);
     b.PutBits(r.a_f0, 22);
     b.PutBits(r.iodc, 10);
     b.PutBits(r.c_rs, 16);
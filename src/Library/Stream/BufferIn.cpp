@@ -1,50 +1,236 @@
-#ifdef NOTYET
+// BufferIn reads a stream in its own thread
+//    Part of Kinematic, a utility for GPS positioning
+//
+// Copyright (C) 2006  John Morris    www.precision-gps.org
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation, version 2.
+
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
 
 #include "BufferIn.h"
 
+
+// Each side must see the data before it sees the index which covers it
+#if defined(WINDOWS)
+static inline size_t LoadAcquire(volatile size_t& v)
+    {size_t x = v; MemoryBarrier(); return x;}
+static inline void StoreRelease(volatile size_t& v, size_t x)
+    {MemoryBarrier(); v = x;}
+#else
+static inline size_t LoadAcquire(volatile size_t& v)
+    {return __atomic_load_n(&v, __ATOMIC_ACQUIRE);}
+static inline void StoreRelease(volatile size_t& v, size_t x)
+    {__atomic_store_n(&v, x, __ATOMIC_RELEASE);}
+#endif
+
+
+
 BufferIn::BufferIn(Stream& in, size_t size)
-    in(str), circ(size)
+: In(in), Size(size)
 {
-    ErrCode = Open(in, size);
+	Buf = NULL;
+	Head = Tail = 0;
+	Timeouts = Done = Stop = 0;
+	Pause = Paused = 0;
+	HighWater = 0;
+	Overruns = 0;
+	BytesIn = 0;
+
+	ErrCode = In.GetError();
+	if (ErrCode != OK) return;
+
+	Buf = (byte*)malloc(Size);
+	if (Buf == NULL) {
+		ErrCode = Error("BufferIn: Can't allocate %d bytes for buffer\n", (int)Size);
+		return;
+	}
+
+	// Spawn a child to read the actual stream
+	ErrCode = Start();
+	if (ErrCode != OK)
+		Error("BufferIn: Can't spawn reader thread\n");
 }
 
 
 
-BufferIn::Open(Stream& in, size_t size)
+void BufferIn::Run()
+/////////////////////////////////////////////////////////////////////////
+// The reader. Reads straight into the free part of the buffer.
+/////////////////////////////////////////////////////////////////////////
 {
-    ErrCode = in.GetError();
-    if (ErrCode != OK) return Error();
+	byte discard[512];
+	size_t head = Head;
+
+	while (LoadAcquire(Stop) == 0) {
+
+		// Stay off the port while the consumer is using it
+		if (LoadAcquire(Pause) != 0) {
+			StoreRelease(Paused, 1);
+			Sleep(1);
+			continue;
+		}
+		if (Paused != 0)
+			StoreRelease(Paused, 0);
+
+		// Read as much as fits without wrapping around
+		size_t used = head - LoadAcquire(Tail);
+		size_t room = min(Size - used, Size - head % Size);
+
+		// If full, keep the port drained anyway, and count what we lose
+		size_t actual = 0;
+		bool err;
+		if (room == 0) {
+			err = In.Read(discard, sizeof(discard), actual);
+			Overruns += actual;
+		} else
+			err = In.Read(Buf + head % Size, room, actual);
+
+		// Pass along what we got
+		if (room > 0 && actual > 0) {
+			head += actual;
+			BytesIn += actual;
+			HighWater = max(HighWater, used + actual);
+			StoreRelease(Head, head);
+		}
+
+		// An empty read is a timeout. A closed socket comes back empty
+		//   at once, so don't spin on it.
+		if (actual == 0 && err == OK) {
+			StoreRelease(Timeouts, Timeouts+1);
+			DataReady.Wake();
+			Sleep(10);
+			continue;
+		}
+
+		if (err != OK) break;
+		DataReady.Wake();
+	}
+
+	debug("BufferIn: reader done  bytes=%.0f  highwater=%d  overruns=%.0f\n",
+		(double)BytesIn, (int)HighWater, (double)Overruns);
+	StoreRelease(Done, 1);
+	DataReady.Wake();
+}
 
-    (// Initialize the input buffer
-    buf = malloc(size);
-    if (buf == 0) 
-        return Error("malloc: Can't allocate %d bytes for buffer\n", size);
 
-    // Spawn a child to read the actual stream
-    Thread t(Child);
-    if (t.GetError() != OK) return Error("Can't spawn reader thread\n");
 
-    return OK;
+bool BufferIn::Read(byte* buf, size_t len, size_t& actual)
+/////////////////////////////////////////////////////////////////////////
+// Return what is waiting, waiting for something if need be.
+//   A read which times out in the reader times us out too.
+/////////////////////////////////////////////////////////////////////////
+{
+	actual = 0;
+	if (ErrCode != OK) return Error();
+
+	size_t tail = Tail;
+	size_t timeouts = LoadAcquire(Timeouts);
+	size_t avail;
+	for (;;) {
+		avail = LoadAcquire(Head) - tail;
+		if (avail > 0) break;
+		if (LoadAcquire(Done) != 0) return Error();
+		if (LoadAcquire(Timeouts) != timeouts) return OK;
+		DataReady.Wait();
+	}
+
+	// Copy it out, in two pieces if it wraps around
+	size_t n = min(len, avail);
+	size_t first = min(n, Size - tail % Size);
+	memcpy(buf, Buf + tail % Size, first);
+	memcpy(buf + first, Buf, n - first);
+
+	actual = n;
+	StoreRelease(Tail, tail + n);
+	return OK;
 }
 
 
-void BufferIn::Child(void *param)
+
+void BufferIn::Hold()
+/////////////////////////////////////////////////////////////////////////
+// Wait for the reader to finish its read and leave the port alone,
+//   then drop whatever it had read.
+/////////////////////////////////////////////////////////////////////////
 {
+	if (ErrCode != OK) return;   // no reader
+	StoreRelease(Pause, 1);
+	while (LoadAcquire(Paused) == 0 && LoadAcquire(Done) == 0)
+		Sleep(1);
+	StoreRelease(Tail, LoadAcquire(Head));
+}
 
-    // Repeat forever
-    forever {
 
-        // Read some data 
-        byte buf[512];
-        size_t actual;
-        if (in.Read(buf, sizeof(buf), actual) != OK)
-            return Error("Child failed to read\n"); // And notify parent
 
-        for (size_t i=0; i<actual; i++)
-            circ.Push(buf[i]);
-    }
+void BufferIn::Resume()
+// Let the reader go again, once it knows it may
+{
+	if (ErrCode != OK) return;
+	StoreRelease(Pause, 0);
+	while (LoadAcquire(Paused) != 0 && LoadAcquire(Done) == 0)
+		Sleep(1);
 }
 
 
 
-#endif
+bool BufferIn::SetBaud(int baud)
+{
+	Hold();
+	bool err = In.SetBaud(baud);
+	Resume();
+	return err;
+}
+
+
+
+bool BufferIn::SetFraming(int32 DataBits, int32 Parity, int32 StopBits)
+{
+	Hold();
+	bool err = In.SetFraming(DataBits, Parity, StopBits);
+	Resume();
+	return err;
+}
+
+
+
+bool BufferIn::Purge()
+{
+	Hold();
+	bool err = In.Purge();
+	Resume();
+	return err;
+}
+
+
+
+int BufferIn::FindBaudRate(const char* query, const char* response, int* BaudRates)
+/////////////////////////////////////////////////////////////////////////
+// The port answers the queries directly, not through the buffer
+/////////////////////////////////////////////////////////////////////////
+{
+	Hold();
+	int baud = In.FindBaudRate(query, response, BaudRates);
+	Resume();
+	return baud;
+}
+
+
+
+BufferIn::~BufferIn()
+{
+	// Wait for the reader to finish its current read
+	StoreRelease(Stop, 1);
+	Join();
+	if (Buf != NULL)
+		free(Buf);
+}
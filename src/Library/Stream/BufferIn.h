@@ -21,24 +21,81 @@
 
 
 #include "Stream.h"
+#include "Thread.h"
 
-class BufferIn : public Stream
-{h
-protected:
-	Stream& s;
-        Thread t;
-        CircularSem sem;
-        byte *buf;
 
+//////////////////////////////////////////////////////////////////////////////
+//
+// BufferIn keeps a stream drained while the rest of the program is busy.
+//   A reader thread reads the stream into a circular buffer as fast as
+//   the data arrives, and Read() takes it out again. A slow database
+//   commit or network send then delays the data rather than losing it
+//   in an overflowing serial port.
+//
+// There is one reader and one consumer, so the buffer needs no lock.
+//   Each side only moves its own index (Head for the reader, Tail for the
+//   consumer) and the other side just looks at it. A semaphore wakes the
+//   consumer when it is waiting for data.
+//
+// If the buffer fills anyway, the new data is dropped and counted in
+//   Overruns. HighWater says how close we have come.
+//
+// The reader stops after its current read returns, so give the stream
+//   a timeout if the BufferIn may be deleted while the data is quiet.
+//
+// Changing the port's settings, purging it or looking for its baud rate
+//   pause the reader, so only one thread talks to the port, and drop
+//   whatever was waiting in the buffer. They must be called by the
+//   consumer, and they wait for the reader's current read too.
+//
+//////////////////////////////////////////////////////////////////////////////
+
+class BufferIn : public Stream, public Thread
+{
 public:
-	BufferIn(Stream s);
+	BufferIn(Stream& in, size_t size = 256*1024);
 	virtual ~BufferIn();
+	using Stream::Read;
+	using Stream::Write;
 
 	virtual bool Read(byte* buf, size_t len, size_t& actual);
 
-	virtual bool Write(const byte* buf, size_t len) {return OK;}
-	virtual bool ReadOnly() {return true;}
-};
+	// How the buffer has done
+	size_t HighWater;     // most bytes waiting at once
+	uint64 Overruns;      // bytes dropped because the buffer was full
+	uint64 BytesIn;
+
+	// All other operations get passed to the original stream
+	virtual bool Write(const byte* buf, size_t len) {return In.Write(buf, len);}
+	virtual bool ReadOnly() {return In.ReadOnly();}
+	virtual bool SetBaud(int baud);
+	virtual bool GetBaud(int& baud) {return In.GetBaud(baud);}
+	virtual int FindBaudRate(const char* query, const char* response, int* BaudRates);
+	virtual bool SetFraming(int32 DataBits, int32 Parity, int32 StopBits);
+	virtual bool SetTimeout(int msec) {return In.SetTimeout(msec);}
+	virtual bool Purge();
+
+protected:
+	Stream& In;
+	byte* Buf;
+	size_t Size;
 
-#endif // !defined(AFX_BufferIn_H__EED899C4_235C_4C0C_A584_4F6F7704A7ED__INCLUDED_)
+	// Shared between the reader and the consumer
+	volatile size_t Head;      // total bytes put in, moved by the reader
+	volatile size_t Tail;      // total bytes taken out, moved by the consumer
+	volatile size_t Timeouts;  // reads which came back empty
+	volatile size_t Done;      // the reader has stopped (end of data or error)
+	volatile size_t Stop;      // asks the reader to stop
+	volatile size_t Pause;     // asks the reader to leave the port alone
+	volatile size_t Paused;    // the reader has seen Pause and is waiting
+	Semaphore DataReady;
+
+	// The reader thread
+	void Run();
+
+	// Keep the reader off the port while the consumer uses it
+	void Hold();
+	void Resume();
+};
 
+#endif // BufferIn__INCLUDED
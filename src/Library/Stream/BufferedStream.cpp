@@ -0,0 +1,182 @@
+// BufferedStream reads another stream in large chunks
+//    Part of Kinematic, a utility for GPS positioning
+//
+// Copyright (C) 2006  John Morris    www.precision-gps.org
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation, version 2.
+
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+
+#include "BufferedStream.h"
+
+
+BufferedStream::BufferedStream(Stream& in, size_t size)
+: In(in), Size(size)
+{
+	Start = End = 0;
+	Eof = false;
+	Fills = 0;
+	BytesIn = 0;
+
+	Buf = (byte*)malloc(Size);
+	if (Buf == NULL)
+		ErrCode = Error("BufferedStream: can't allocate %d bytes\n", (int)Size);
+	else
+		ErrCode = In.GetError();
+}
+
+
+
+bool BufferedStream::Read(byte* buf, size_t len, size_t& actual)
+/////////////////////////////////////////////////////////////////////////
+// Like any other stream, we return what we have, even if it is less
+//   than asked for. We only go to the underlying stream when empty.
+/////////////////////////////////////////////////////////////////////////
+{
+	actual = 0;
+	if (Start == End) {
+		if (Eof) return Error();
+
+		// Big reads go directly to the caller's buffer
+		if (len >= Size) {
+			bool err = In.Read(buf, len, actual);
+			Fills++;  BytesIn += actual;
+			return err;
+		}
+
+		Start = End = 0;
+		size_t got = 0;
+		bool err = In.Read(Buf, Size, got);
+		Fills++;  BytesIn += got;
+		End = got;
+
+		// A file may end part way through. Keep what we got.
+		if (err != OK && got == 0) return Error();
+		Eof = (err != OK);
+	}
+
+	actual = min(len, End-Start);
+	memcpy(buf, Buf+Start, actual);
+	Start += actual;
+	return OK;
+}
+
+
+
+bool BufferedStream::Fill(size_t n)
+// Make sure at least n bytes are in the buffer
+{
+	if (End - Start >= n)
+		return OK;
+	if (n > Size)
+		return Error("BufferedStream: can't look ahead %d bytes\n", (int)n);
+
+	// Move what we have to the front
+	if (Start > 0) {
+		memmove(Buf, Buf+Start, End-Start);
+		End -= Start;
+		Start = 0;
+	}
+
+	while (End < n) {
+		if (Eof) return Error();
+
+		size_t got = 0;
+		bool err = In.Read(Buf+End, Size-End, got);
+		Fills++;  BytesIn += got;
+		End += got;
+
+		if (err != OK) Eof = true;
+		else if (got == 0) return Error("BufferedStream: read timed out\n");
+	}
+
+	return OK;
+}
+
+
+
+bool BufferedStream::Peek(size_t n, const byte*& p)
+{
+	if (Fill(n) != OK) return Error();
+	p = Buf + Start;
+	return OK;
+}
+
+
+void BufferedStream::Consume(size_t n)
+{
+	Start += min(n, End-Start);
+}
+
+
+
+bool BufferedStream::ReadUntil(byte delim, const byte*& p, size_t& len)
+/////////////////////////////////////////////////////////////////////////
+// The bytes up to and including the delimiter, consumed.
+//   If the buffer fills first, we return the full buffer and the caller
+//   sees the last byte isn't the delimiter.
+/////////////////////////////////////////////////////////////////////////
+{
+	for (size_t scanned = 0;;) {
+		const byte* found = (const byte*)memchr(Buf+Start+scanned, delim, End-Start-scanned);
+		if (found != NULL) {
+			len = found - (Buf+Start) + 1;
+			break;
+		}
+
+		scanned = End - Start;
+		if (scanned == Size) {
+			len = Size;
+			break;
+		}
+		if (Fill(scanned+1) != OK) return Error();
+	}
+
+	p = Buf + Start;
+	Start += len;
+	return OK;
+}
+
+
+
+bool BufferedStream::ReadLine(char* line, size_t len)
+/////////////////////////////////////////////////////////////////////////
+// Same as Stream::ReadLine, but scanning the buffer directly
+/////////////////////////////////////////////////////////////////////////
+{
+	size_t actual = 0;
+	for (;;) {
+		if (Start == End && Fill(1) != OK) return Error();
+
+		// Copy until the newline or the caller's buffer is full
+		byte c = 0;
+		while (Start < End && actual < len-1) {
+			c = Buf[Start++];
+			if (c == '\n') break;
+			if (c != '\r') line[actual++] = c;
+		}
+		if (c == '\n' || actual >= len-1) break;
+	}
+
+	line[actual] = 0;
+	debug(5,"BufferedStream::ReadLine: len=%d actual=%d buf=%s\n", (int)len, (int)actual, line);
+	return OK;
+}
+
+
+
+BufferedStream::~BufferedStream()
+{
+	if (Buf != NULL)
+		free(Buf);
+}
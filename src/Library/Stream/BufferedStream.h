@@ -0,0 +1,88 @@
+#ifndef BUFFEREDSTREAM_INCLUDED
+#define BUFFEREDSTREAM_INCLUDED
+
+// Part of Kinematic, a utility for GPS positioning
+//
+// Copyright (C) 2006  John Morris    www.precision-gps.org
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation, version 2.
+
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+
+
+#include "Stream.h"
+
+
+//////////////////////////////////////////////////////////////////////////////
+//
+// BufferedStream reads another stream in large chunks, so reading a byte
+//   at a time (ReadLine, AwaitString, the Comm framers) no longer means
+//   a read() for each byte.
+//
+// Framers which know they have a BufferedStream can also look at the
+//   data in place:
+//     Peek(n, p)   - p points to the next n bytes, waiting for them if need be
+//     Consume(n)   - then skip over them
+//     ReadUntil(delim, p, len) - the bytes up to and including delim
+//   The pointers are into our buffer, and are good until the next read.
+//
+// Writes and the port settings go straight to the underlying stream.
+//
+//////////////////////////////////////////////////////////////////////////////
+
+class BufferedStream : public Stream
+{
+public:
+	BufferedStream(Stream& in, size_t size = 64*1024);
+	virtual ~BufferedStream();
+	using Stream::Read;
+	using Stream::Write;
+
+	bool Read(byte* buf, size_t len, size_t& actual);
+	bool ReadLine(char* line, size_t max=128);
+
+	// Looking at the data in place
+	bool Peek(size_t n, const byte*& p);
+	void Consume(size_t n);
+	bool ReadUntil(byte delim, const byte*& p, size_t& len);
+	size_t Available() {return End - Start;}
+
+	// How many reads of the underlying stream, and how much they got
+	int32 Fills;
+	uint64 BytesIn;
+
+	// All other operations get passed to the original stream
+	bool Write(const byte* buf, size_t len) {return In.Write(buf, len);}
+	virtual bool ReadOnly() {return In.ReadOnly();}
+	virtual bool SetBaud(int baud) {Drop(); return In.SetBaud(baud);}
+	virtual bool GetBaud(int& baud) {return In.GetBaud(baud);}
+	virtual int FindBaudRate(const char* query, const char* response, int* BaudRates)
+	    {Drop(); return In.FindBaudRate(query, response, BaudRates);}
+	virtual bool SetFraming(int32 DataBits, int32 Parity, int32 StopBits)
+	    {Drop(); return In.SetFraming(DataBits, Parity, StopBits);}
+	virtual bool SetTimeout(int msec) {return In.SetTimeout(msec);}
+	virtual bool Purge() {Drop(); return In.Purge();}
+
+protected:
+	Stream& In;
+	byte* Buf;
+	size_t Size;
+	size_t Start, End;   // the data not yet read
+	bool Eof;            // the underlying stream has no more
+
+	bool Fill(size_t n);
+	void Drop() {Start = End = 0;}
+};
+
+
+#endif // BUFFEREDSTREAM_INCLUDED
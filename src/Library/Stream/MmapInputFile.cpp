@@ -0,0 +1,111 @@
+// MmapInputFile reads a file by mapping it into memory
+//    Part of Kinematic, a utility for GPS positioning
+//
+// Copyright (C) 2006  John Morris    www.precision-gps.org
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation, version 2.
+
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+
+#include "MmapInputFile.h"
+
+
+MmapInputFile::MmapInputFile(const char* name, bool populate)
+: File(name, MappedFile::Sequential | (populate? MappedFile::Populate: 0))
+{
+	Data = (const char*)File.Data();
+	Size = File.Size();
+	Pos = 0;
+	snprintf(Name, sizeof(Name), "%s", name);
+
+	ErrCode = File.GetError();
+	if (ErrCode != OK)
+		Error("Unable to open input file %s\n", name);
+}
+
+
+
+bool MmapInputFile::Read(byte* buf, size_t len, size_t& actual)
+{
+	actual = 0;
+	if (ErrCode != OK) return Error();
+	if (Eof()) return Error("(EOF) Reached end of InputFile\n");
+
+	actual = min(len, Size-Pos);
+	memcpy(buf, Data+Pos, actual);
+	Pos += actual;
+
+	debug_buf(7, buf, actual);
+	return OK;
+}
+
+
+
+bool MmapInputFile::NextLine(const char*& line, size_t& len)
+/////////////////////////////////////////////////////////////////////////
+// Point to the next line and step over it. The last line of
+//   the file may not have a newline.
+/////////////////////////////////////////////////////////////////////////
+{
+	if (ErrCode != OK || Eof()) return Error();
+
+	line = Data + Pos;
+	const char* nl = (const char*)memchr(line, '\n', Size-Pos);
+	if (nl == NULL) {
+		len = Size - Pos;
+		Pos = Size;
+	} else {
+		len = nl - line;
+		Pos += len + 1;
+	}
+
+	// Drop the carriage return of a DOS file
+	if (len > 0 && line[len-1] == '\r')
+		len--;
+
+	debug(5, "MmapInputFile::NextLine: len=%d line=%.*s\n", (int)len, (int)len, line);
+	return OK;
+}
+
+
+
+bool MmapInputFile::ReadLine(char* line, size_t max)
+/////////////////////////////////////////////////////////////////////////
+// Same as Stream::ReadLine, but a copy of NextLine.
+//   A line too long for the buffer continues on the next call.
+/////////////////////////////////////////////////////////////////////////
+{
+	size_t start = Pos;
+	const char* p; size_t len;
+	if (NextLine(p, len) != OK) return Error();
+
+	if (len > max-1) {
+		len = max-1;
+		Pos = start + len;
+	}
+
+	// Any carriage returns inside the line are dropped, as in Stream
+	size_t actual = 0;
+	for (size_t i=0; i<len; i++)
+		if (p[i] != '\r')
+			line[actual++] = p[i];
+	line[actual] = 0;
+
+	return OK;
+}
+
+
+
+MmapInputFile::~MmapInputFile()
+{
+}
@@ -0,0 +1,81 @@
+#ifndef MMAPINPUTFILE_INCLUDED
+#define MMAPINPUTFILE_INCLUDED
+
+// Part of Kinematic, a utility for GPS positioning
+//
+// Copyright (C) 2006  John Morris    www.precision-gps.org
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation, version 2.
+
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+
+
+#include "Stream.h"
+#include "MappedFile.h"
+
+
+//////////////////////////////////////////////////////////////////////////////
+//
+// MmapInputFile reads a file by mapping it into memory.
+//   It works as any other input stream, but text readers can also
+//   take the lines in place:
+//     NextLine(line, len) - line points to the next line in the file
+//   The line doesn't include the end of line characters, and it isn't
+//   null terminated. It stays good as long as the file is open.
+//   A decoder can also work on the rest of the file (Next() to End())
+//   and then Skip() past what it used.
+//
+// The file is expected to be read from front to back, and the system
+//   is told so. "populate" reads the whole file in before we start,
+//   which suits files we know will be read in full.
+//
+//////////////////////////////////////////////////////////////////////////////
+
+class MmapInputFile : public Stream
+{
+public:
+	MmapInputFile(const char* name, bool populate = false);
+	virtual ~MmapInputFile();
+	using Stream::Read;
+	using Stream::Write;
+
+	bool Read(byte* buf, size_t len, size_t& actual);
+	bool ReadLine(char* line, size_t max=128);
+	bool Write(const byte* buf, size_t len) {return Error("MmapInputFile is read only\n");}
+	bool ReadOnly() {return true;}
+
+	// The next line, in place
+	bool NextLine(const char*& line, size_t& len);
+	bool Eof() {return Pos >= Size;}
+
+	// Or decode the data directly, and then say how far we got
+	const char* Next() {return Data + Pos;}
+	const char* End() {return Data + Size;}
+	void Skip(const char* p) {Pos = p - Data;}
+
+	// Where we are in the file, as an offset from the start
+	size_t Tell() {return Pos;}
+	void Seek(size_t pos) {Pos = min(pos, Size);}
+	size_t Length() {return Size;}
+	const char* FileName() {return Name;}
+
+protected:
+	MappedFile File;
+	const char* Data;
+	size_t Size;
+	size_t Pos;        // the next byte to be read
+	char Name[260];
+};
+
+
+#endif // MMAPINPUTFILE_INCLUDED
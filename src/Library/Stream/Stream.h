@@ -40,7 +40,7 @@ public:
 	    {return Write((byte*)buf, strlen(buf));}
 
 
-    bool ReadLine(char* line, size_t max=128);
+    virtual bool ReadLine(char* line, size_t max=128);
     bool WriteLine(const char* line);
     bool ReadNmea(char* line);
     bool WriteNmea(const char* line);
@@ -16,9 +16,11 @@ public:
 	using Stream::Write;
 	virtual bool ReadOnly() {return In.ReadOnly();}
     
-	// Read copies the data to the copy stream
+	// Read copies the data to the copy stream, including any we got
+	//   just before an error (eg. the end of a file)
 	bool Read(byte* buf, size_t len, size_t& actual)
-	    {return In.Read(buf, len, actual) || Copy.Write(buf, len);}
+	    {actual = 0; bool err = In.Read(buf, len, actual);
+	     return (actual > 0 && Copy.Write(buf, actual) != OK) || err;}
 
 	// All other operations get passed to the original stream
 	bool Write(const byte* buf, size_t len) {return In.Write(buf, len);};
@@ -1,4 +1,5 @@
 #include "Logger.h"
+#include "Thread.h"
 #include "stdio.h"
 
 Logger::Logger(const char* name)
@@ -74,6 +75,7 @@ TimeLogger::~TimeLogger()
 
 
 static TimeLogger EventLog("events.txt");
+static Mutex EventLock;    // several rovers may report events at once
 
 bool EventSetTime(Time *tp)
 {
@@ -85,8 +87,10 @@ bool Event(const char* fmt, ...)
 	va_list args;
 	va_start(args, fmt);
 	debug(1, "Event: "); vdebug(1, fmt, args);
+	EventLock.Lock();
 	bool ret = EventLog.VPrintf(fmt, args);
 	EventLog.Flush();
+	EventLock.Unlock();
 	va_end(args);
 
     return ret;
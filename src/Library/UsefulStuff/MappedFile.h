@@ -0,0 +1,84 @@
+#ifndef MAPPEDFILE_INCLUDED
+#define MAPPEDFILE_INCLUDED
+// Part of Kinematic, a utility for GPS positioning
+//
+// Copyright (C) 2006  John Morris    www.precision-gps.org
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation, version 2.
+
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+
+
+#include "util.h"
+#include <stdio.h>
+
+#if defined(WINDOWS)
+#include <windows.h>
+typedef HANDLE FileHandle;
+#else
+typedef int FileHandle;
+#endif
+
+
+//////////////////////////////////////////////////////////////////////////////
+//
+// MappedFile maps a whole file, read only, into memory.
+//   Processes mapping the same file share the same pages.
+//
+// A file which will be read once from front to back can say so, and the
+//   system reads ahead of us more aggressively. It may also ask for the
+//   whole file to be read in before we start.
+//
+// It also has the other file operations which differ between systems.
+//
+//////////////////////////////////////////////////////////////////////////////
+
+class MappedFile
+{
+public:
+	enum {Random=0, Sequential=1, Populate=2};  // how the file will be used
+	MappedFile(const char* name, int usage = Random);
+	virtual ~MappedFile();
+	inline const byte* Data() {return Base;}
+	inline size_t Size() {return Length;}
+	inline bool GetError() {return ErrCode;}
+
+	// Size and modification time. Quietly fails if the file isn't there.
+	static bool Stat(const char* name, uint64& size, int64& mtime);
+
+	// Is it a regular file with something in it? Pipes, devices and
+	//   empty files can't be mapped, only read.
+	static bool Mappable(const char* name);
+
+	// Is it a pipe or a fifo?
+	static bool Pipe(const char* name);
+
+	// Write a file so others see either the old one or the complete new one
+	static bool SaveAs(const char* name, const byte* data, size_t len);
+
+	// Create an empty file with a new name in the system's temporary directory
+	static bool TempFile(char* name, size_t len, const char* prefix);
+
+	// Seek from the start of a file, even past 2GB
+	static bool Seek(FILE* f, int64 offset);
+
+protected:
+	bool ErrCode;
+	const byte* Base;
+	size_t Length;
+	FileHandle File;
+	FileHandle Map;
+};
+
+
+#endif // MAPPEDFILE_INCLUDED
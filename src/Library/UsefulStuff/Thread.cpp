@@ -0,0 +1,8 @@
+
+#if defined(WINDOWS)
+#include "Thread.cpp.windows"
+
+#else
+#include "Thread.cpp.posix"
+#endif
+
@@ -20,7 +20,20 @@
 
 
 #include "util.h"
+
+#if defined(WINDOWS)
 #include <windows.h>  // MOVE ELSEWHERE!
+typedef CRITICAL_SECTION MutexHandle;
+typedef HANDLE SemaphoreHandle;
+typedef HANDLE ThreadHandle;
+
+#else
+#include <pthread.h>
+#include <semaphore.h>
+typedef pthread_mutex_t MutexHandle;
+typedef sem_t SemaphoreHandle;
+typedef pthread_t ThreadHandle;
+#endif
 
 
 class Mutex
@@ -31,7 +44,7 @@ public:
 	void Unlock();
 	~Mutex();
 private:
-	CRITICAL_SECTION cs[1];
+	MutexHandle cs[1];
 };
 
 
@@ -43,7 +56,7 @@ public:
 	void Wake();
 	~Semaphore();
 private:
-	HANDLE sem;
+	SemaphoreHandle sem;
 };
 
 
@@ -70,17 +83,26 @@ class Thread
 public:
 	Thread();
 	bool Start();
+	bool Join();
 	virtual ~Thread(void);
 
 	bool SetPriority(int32 priority);
 
+	// How many processors are online to run threads
+	static int Processors();
+
 protected:
 	// Each thread type redefines this method.
 	virtual void Run();
 
 private:
-	HANDLE Handle;
+	ThreadHandle Handle;
+	bool Started;
+#if defined(WINDOWS)
 	static void Startup(Thread*);
+#else
+	static void* Startup(void*);
+#endif
 	int32 Priority;
 };
 
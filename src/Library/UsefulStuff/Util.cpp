@@ -17,6 +17,7 @@
 // along with this program; if not, write to the Free Software
 // Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
 #include "util.h"
+#include "Thread.h"
 #include <math.h>
 #include <ctype.h>
 
@@ -207,6 +208,7 @@ int ErrCount = 0;
 static const int ErrMax = 15;
 static const int ErrMaxStr = 256;
 char   ErrSlot[ErrMax][ErrMaxStr];  // Make this thread specific later
+static Mutex ErrLock;              // errors may come from several threads
 
 
 bool SysError(const char* fmt, ...)
@@ -234,15 +236,22 @@ bool Error(const char *fmt, ...)
 
 bool Verror(const char *fmt, va_list arglist)
 {
-	debug("ERROR: "); vdebug(1, fmt, arglist);
-
-	// Format into the slot
-	vsnprintf(ErrSlot[ErrCount], ErrMaxStr-1, fmt, arglist);
-	ErrSlot[ErrCount][ErrMaxStr-1] = '\0';
+	// (the arguments are formatted twice, so debug gets its own copy)
+	va_list copy;
+	va_copy(copy, arglist);
+	debug("ERROR: "); vdebug(1, fmt, copy);
+	va_end(copy);
+
+	// Format into the slot. Once the list is full, the last slot gets overwritten.
+	ErrLock.Lock();
+	int slot = min(ErrCount, ErrMax-1);
+	vsnprintf(ErrSlot[slot], ErrMaxStr-1, fmt, arglist);
+	ErrSlot[slot][ErrMaxStr-1] = '\0';
 
 	// if we have more room in the error list, then allocate a slot
 	if (ErrCount < ErrMax)
 	    ErrCount++;
+	ErrLock.Unlock();
 
 	return true;
 }
@@ -75,6 +75,7 @@ static void DebugArray(Ta& A, int32 MinRow, int32 MaxRow, int32 MinCol,
 						 int32 MaxCol, Tb& B, const char* s="")
 {
 	debug("Array[%d..%d][%d..%d]  %s\n", MinRow, MaxRow, MinCol, MaxCol,s);
+	if (DebugLevel < 3) return;
 	for (int i=MinRow; i<=MaxRow; i++) {
 		for (int j=MinCol; j<=MaxCol; j++)
 			debug(3,"%10.6f ", A[i][j]);
@@ -32,9 +32,10 @@ INCDIR := $(PROJECT_ROOT)/../Include/
 CPPOPT:= -g
 LDOPT := -g
 
-CPPFLAGS:= -I $(CROSS)/usr/include -I $(CROSS)/include $(CPPOPT)
+# Files over 2GB on 32 bit systems too
+CPPFLAGS:= -I $(CROSS)/usr/include -I $(CROSS)/include -D_FILE_OFFSET_BITS=64 $(CPPOPT)
 CFLAGS:=$(CPPFLAGS) -DSQLITE_OMIT_LOAD_EXTENSION  -DSQLITE_THREADSAFE=0
-LDFLAGS:= -L $(CROSS)/usr/lib -L $(CROSS)/lib  #-lpthread
+LDFLAGS:= -L $(CROSS)/usr/lib -L $(CROSS)/lib -lpthread
 
 .SUFFIXES : .cpp .c .o .lib .exe .h .dll .a
 
@@ -0,0 +1,341 @@
+// BenchArchive - read broadcast ephemerides back out of the archive
+//    Part of kinematic, a collection of utilities for GPS positioning
+//
+// Copyright (C) 2006  John Morris    www.precision-gps.org
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation, version 2.
+
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// Broadcasts several hours of made up ephemerides as RTCM 3, the way a
+//   base station would, then reads the stream back with an archive
+//   attached to the receiver. Every issue of every satellite should
+//   come back out of the archive, close to what was sent, even though
+//   the receiver itself only keeps the latest one.
+//
+// Then times the lookups, with and without a lock around them.
+//
+////////////////////////////////////////////////////////////////////////////////
+
+#include "EphemerisArchive.h"
+#include "Rtcm3Station.h"
+#include "RawRtcm3.h"
+#include "OutputFile.h"
+#include "MmapInputFile.h"
+#include "MappedFile.h"
+#include "Thread.h"
+#include <stdio.h>
+#include <time.h>
+
+bool BenchArchive(int argc, const char** argv);
+bool Configure(int argc, const char** argv);
+bool DisplayOptions();
+bool Broadcast(const char* name);
+bool Compare(EphemerisArchive& archive, RawReceiver& rtcm);
+bool TimeLookups(EphemerisArchive& archive);
+double Random();
+
+// run string parameters
+int Sats;
+int Issues;
+double Step;        // sec
+int32 Lookups;
+
+// GPS satellites 1 to Sats, with a new issue every two hours.
+//   RTCM 3 sends the week of the epoch rather than of t_oe, so stay
+//   inside one week, and its weeks are ten bits, so stay before the
+//   first rollover.
+static const Time IssueStep = 2*NsecPerHour;
+static const int MaxIssues = 24;
+Time Start;
+EphemerisXmit* Issue[MaxSats][MaxIssues];
+
+
+
+class Broadcaster: public RawReceiver
+//////////////////////////////////////////////////////////////////////
+// A receiver which hears the made up satellites. It switches to each
+//   new issue half way between the t_oe's.
+//////////////////////////////////////////////////////////////////////
+{
+public:
+	Broadcaster(Position pos);
+	bool NextEpoch();
+	~Broadcaster();
+};
+
+
+
+int main(int argc, const char** argv)
+{
+	BenchArchive(argc, argv);
+	ShowErrors();
+	return 0;
+}
+
+
+bool BenchArchive(int argc, const char** argv)
+{
+	// parse the command line
+	if (Configure(argc, argv) != OK) {
+		DisplayOptions();
+		return Error();
+	}
+
+	// Random orbits, roughly like the real ones, changing a bit each issue
+	srand(1);
+	Start = ConvertGpsTime(1000, 86400);
+	for (int s=1; s<=Sats; s++) {
+		EphemerisXmit base(s, "Bench");
+		base.m_0 = Random()*PI; base.delta_n = Random()*5e-9; base.e = fabs(Random())*.02;
+		base.sqrt_a = 5153.6 + Random(); base.omega_0 = Random()*PI; base.i_0 = .96 + Random()*.02;
+		base.omega = Random()*PI; base.omegadot = -8e-9 + Random()*1e-9; base.idot = Random()*1e-10;
+		base.c_uc = Random()*1e-5; base.c_us = Random()*1e-5; base.c_rc = Random()*300;
+		base.c_rs = Random()*100; base.c_ic = Random()*1e-7; base.c_is = Random()*1e-7;
+		base.t_gd = 0; base.a_f0 = Random()*1e-4; base.a_f1 = Random()*1e-11; base.a_f2 = 0;
+		base.acc = 2.4; base.health = 0;
+
+		for (int k=0; k<Issues; k++) {
+			EphemerisXmit* x = new EphemerisXmit(base);
+			x->t_oe = x->t_oc = Start + k*IssueStep;
+			x->m_0 += Random()*1e-6; x->c_rs += Random(); x->a_f0 += Random()*1e-8;
+			x->iode = x->iodc = k+1;
+			x->MinTime = x->t_oe - 2*NsecPerHour; x->MaxTime = x->t_oe + 2*NsecPerHour;
+			Issue[s][k] = x;
+		}
+	}
+
+	// Send it all out as RTCM 3
+	char name[260];
+	if (MappedFile::TempFile(name, sizeof(name), "archive") != OK) return Error();
+	if (Broadcast(name) != OK) {remove(name); return Error();}
+
+	// Read it back, keeping every ephemeris in the archive
+	EphemerisArchive archive;
+	MmapInputFile in(name);
+	RawRtcm3 rtcm(in);
+	if (rtcm.GetError() != OK) {remove(name); return Error();}
+	rtcm.SetArchive(&archive);
+	int32 epochs;
+	for (epochs=0; rtcm.NextEpoch() == OK; epochs++)
+		;
+	ClearError();
+	remove(name);
+
+	printf("%d satellites, %d issues each, %d epochs read back\n", Sats, Issues, (int)epochs);
+	if (Compare(archive, rtcm) != OK) return Error();
+	return TimeLookups(archive);
+}
+
+
+
+bool Broadcast(const char* name)
+{
+	OutputFile out(name);
+	Broadcaster gps(Position(-2700000, -4300000, 3850000));
+	Rtcm3Station::Attributes attr;
+	attr.Id = 1;
+	attr.ARP = gps.Pos;
+	attr.AntennaDesc[0] = '\0';
+	attr.AntennaSetupId = 0;
+	Rtcm3Station station(out, gps, attr);
+	if (station.GetError() != OK) return Error();
+
+	while (gps.NextEpoch() == OK)
+		if (station.OutputEpoch() != OK) return Error();
+	ClearError();
+
+	return out.Flush();
+}
+
+
+
+bool Compare(EphemerisArchive& archive, RawReceiver& rtcm)
+/////////////////////////////////////////////////////////////////////
+// Each issue should be in the archive, and near its t_oe the archive
+//   should give the same positions as the original, to within the
+//   precision of the RTCM fields.
+/////////////////////////////////////////////////////////////////////
+{
+	int32 found = 0, latest = 0;
+	double WorstPos = 0, WorstClock = 0;
+	for (int s=1; s<=Sats; s++) {
+		if (archive.Count(s) != Issues)
+			printf("  sat %d: %d issues in the archive, expected %d\n", s, (int)archive.Count(s), Issues);
+
+		for (int k=0; k<Issues; k++) {
+			EphemerisXmit& sent = *Issue[s][k];
+			EphemerisXmit* x = archive.Find(s, sent.t_oe);
+			if (x == NULL || x->iode != sent.iode || x->t_oe != sent.t_oe) continue;
+			found++;
+			if (rtcm[s].Valid(sent.t_oe))
+				latest++;
+
+			for (Time t = sent.t_oe - 50*NsecPerMinute; t <= sent.t_oe + 50*NsecPerMinute; t += 10*NsecPerMinute) {
+				Position p[2]; double a[2];
+				if (sent.SatPos(t, p[0], a[0]) != OK) return Error();
+				if (archive[s].SatPos(t, p[1], a[1]) != OK) return Error();
+				WorstPos = max(WorstPos, Range(p[1] - p[0]));
+				WorstClock = max(WorstClock, abs(a[1] - a[0]) * C);
+			}
+		}
+	}
+
+	printf("%d of %d came back from the archive (the receiver alone has %d)\n",
+		(int)found, Sats*Issues, (int)latest);
+	printf("worst difference %.3f m in position, %.3f m in clock\n", WorstPos, WorstClock);
+	if (found != Sats*Issues)
+		return Error("The archive is missing ephemerides\n");
+	return OK;
+}
+
+
+
+bool TimeLookups(EphemerisArchive& archive)
+////////////////////////////////////////////////////////////////////
+// Find is lock free. Time it against the same lookups with a mutex
+//   taken around each one, the way they were done before.
+////////////////////////////////////////////////////////////////////
+{
+	Time span = (Issues-1)*IssueStep;
+	Time* times = new Time[Lookups];
+	for (int32 i=0; i<Lookups; i++)
+		times[i] = Start + (Time)((Random()+1)/2 * span);
+
+	Mutex lock;
+	double nsec[2];
+	int32 hits[2];
+	for (int l=0; l<2; l++) {
+		hits[l] = 0;
+		clock_t begin = clock();
+		for (int32 i=0; i<Lookups; i++) {
+			if (l == 1) lock.Lock();
+			EphemerisXmit* x = archive.Find(i%Sats + 1, times[i]);
+			if (l == 1) lock.Unlock();
+			hits[l] += (x != NULL);
+		}
+		nsec[l] = (double)(clock() - begin) / CLOCKS_PER_SEC / Lookups * 1e9;
+	}
+	delete[] times;
+
+	printf("%d lookups: %.1f nsec each lock free, %.1f nsec with a lock\n",
+		(int)Lookups, nsec[0], nsec[1]);
+	if (hits[0] != Lookups || hits[1] != Lookups)
+		return Error("Some lookups found nothing\n");
+	return OK;
+}
+
+
+
+Broadcaster::Broadcaster(Position pos)
+{
+	strcpy(Description, "Broadcaster");
+	Pos = pos;
+	GpsTime = Start - IssueStep/2;
+	for (int s=0; s<MaxSats; s++)
+		eph[s] = NULL;
+	for (int s=1; s<=Sats; s++)
+		eph[s] = Issue[s][0];
+}
+
+
+bool Broadcaster::NextEpoch()
+{
+	GpsTime += (Time)(Step * NsecPerSec);
+	if (GpsTime > Start + (Issues-1)*IssueStep + IssueStep/2)
+		return Error("Broadcaster: done\n");
+
+	int k = (int)((GpsTime - Start + IssueStep/2) / IssueStep);
+	k = min(max(k, 0), Issues-1);
+	for (int s=1; s<=Sats; s++) {
+		eph[s] = Issue[s][k];
+		Position xmit; double adjust;
+		if (eph[s]->SatPos(GpsTime, xmit, adjust) != OK) return Error();
+		obs[s].Valid = true;
+		obs[s].Slip = false;
+		obs[s].PR = Range(xmit - Pos);
+		obs[s].Phase = obs[s].PR / L1WaveLength;
+		obs[s].SNR = 45;
+		obs[s].Doppler = 0;
+	}
+
+	return OK;
+}
+
+
+Broadcaster::~Broadcaster()
+// The ephemerides belong to Issue[][]
+{
+	for (int s=0; s<MaxSats; s++)
+		eph[s] = NULL;
+}
+
+
+
+double Random()
+// Uniform between -1 and 1
+{
+	return 2.0 * rand() / RAND_MAX - 1;
+}
+
+
+
+ bool Configure(int argc, const char** argv)
+ {
+     // defaults
+	 Sats = 8;
+	 Issues = 6;
+	 Step = 5;
+	 Lookups = 10000000;
+
+	 // Do for each argument
+	 const char* arg;
+	 int i;
+	 for (i=1; i<argc && argv[i][0] == '-'; i++) {
+
+		 if (Match(argv[i], "-debug=", arg))            DebugLevel = atoi(arg);
+		 else if (Match(argv[i], "-sats=", arg))        Sats = atoi(arg);
+		 else if (Match(argv[i], "-issues=", arg))      Issues = atoi(arg);
+		 else if (Match(argv[i], "-step=", arg))        Step = atof(arg);
+		 else if (Match(argv[i], "-lookups=", arg))     Lookups = atoi(arg);
+		 else    return Error("Didn't recognize option %s\n", argv[i]);
+	 }
+
+	 if (Sats < 1 || Sats > 32)
+		 return Error("The number of satellites must be from 1 to 32\n");
+	 if (Issues < 1 || Issues > MaxIssues)
+		 return Error("The number of issues must be from 1 to %d\n", MaxIssues);
+	 if (Step < 1 || Step > 60 || Lookups < 1)
+		 return Error("Need a step from 1 to 60 seconds and some lookups\n");
+
+	 return OK;
+ }
+
+
+ bool DisplayOptions()
+ {
+	 printf("\n");
+     printf("BenchArchive [options]\n");
+	 printf("     Send ephemerides through RTCM 3 and read them back from the archive\n");
+	 printf("\n");
+	 printf("    Where {options} include any of the following:\n");
+	 printf("        -sats=n          - number of satellites (default 8)\n");
+	 printf("        -issues=n        - issues of each ephemeris, 2 hours apart (default 6)\n");
+	 printf("        -step=sec        - time between epochs (default 5)\n");
+	 printf("        -lookups=n       - how many lookups to time (default 10000000)\n");
+	 printf("\n");
+	 return OK;
+ }
@@ -0,0 +1,210 @@
+// BenchEphemeris - time the satellite positions at high rates
+//    Part of kinematic, a collection of utilities for GPS positioning
+//
+// Copyright (C) 2005  John Morris    kinematic@coyotebush.net
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation, version 2.
+
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// Calculates the satellite positions at 20 Hz (or any rate), first directly
+//   from the ephemerides and then interpolated between anchors. It does
+//   this for both broadcast ephemerides and precise (sp3 style) ones made
+//   from them.
+//
+// Reports the time for each epoch, the speedup, and the largest 
+//   difference in position and clock.
+//
+////////////////////////////////////////////////////////////////////////////////
+
+#include "EphemerisXmit.h"
+#include "SP3.h"
+#include "EphemerisAnchored.h"
+#include <stdio.h>
+#include <time.h>
+
+bool BenchEphemeris(int argc, const char** argv);
+bool Configure(int argc, const char** argv);
+bool DisplayOptions();
+bool RunBench(const char* title, Ephemerides& direct, Ephemerides& anchored, Time start);
+double Random();
+
+// run string parameters
+int Sats;
+double Rate;        // Hz
+double AnchorStep;  // sec
+double Minutes;
+
+// Broadcast ephemerides, like a receiver's
+class BroadcastEphemerides: public Ephemerides
+{
+public:
+	EphemerisXmit* Broadcast(int s) {return (EphemerisXmit*)eph[s];}
+};
+
+
+
+int main(int argc, const char** argv)
+{
+	BenchEphemeris(argc, argv);
+	ShowErrors();
+	return 0;
+}
+
+
+bool BenchEphemeris(int argc, const char** argv)
+{
+	// parse the command line
+	if (Configure(argc, argv) != OK) {
+		DisplayOptions();
+		return Error();
+	}
+
+	printf("%d satellites at %.0f Hz for %.0f minutes, anchors %.2f sec apart\n",
+		Sats, Rate, Minutes, AnchorStep);
+	printf("%-10s %14s %14s %8s %16s %16s\n", "", "direct(usec)", "anchored(usec)", 
+		"speedup", "worst pos(m)", "worst clock(m)");
+
+	// Random orbits, roughly like the real ones
+	srand(1);
+	Time toe = ConvertGpsTime(1400, 300000);
+	BroadcastEphemerides broadcast;
+	Ephemerides precise;
+	for (int s=0; s<Sats; s++) {
+		EphemerisXmit* x = new EphemerisXmit(s, "Bench");
+		x->m_0 = Random()*PI; x->delta_n = Random()*5e-9; x->e = fabs(Random())*.02;
+		x->sqrt_a = 5153.6 + Random(); x->omega_0 = Random()*PI; x->i_0 = .96 + Random()*.02;
+		x->omega = Random()*PI; x->omegadot = -8e-9 + Random()*1e-9; x->idot = Random()*1e-10;
+		x->c_uc = Random()*1e-5; x->c_us = Random()*1e-5; x->c_rc = Random()*300;
+		x->c_rs = Random()*100; x->c_ic = Random()*1e-7; x->c_is = Random()*1e-7;
+		x->t_oe = x->t_oc = toe; x->t_gd = 0;
+		x->a_f0 = Random()*1e-4; x->a_f1 = Random()*1e-11; x->a_f2 = 0;
+		x->MinTime = toe - 2*NsecPerHour; x->MaxTime = toe + 2*NsecPerHour;
+		broadcast.eph[s] = x;
+
+		// The precise ones are every 15 minutes, like an sp3 file
+		EphemerisInterpolated* p = new EphemerisInterpolated(s);
+		for (int k=-8; k<=8; k++) {
+			Time t = toe + k*15*60*NsecPerSec;
+			Position pos; double adjust;
+			x->SatPos(t, pos, adjust);
+			p->AddSatPos(t, pos, adjust);
+		}
+		precise.eph[s] = p;
+	}
+
+	EphemeridesAnchored AnchoredBroadcast(broadcast, (Time)(AnchorStep*NsecPerSec));
+	EphemeridesAnchored AnchoredPrecise(precise, (Time)(AnchorStep*NsecPerSec));
+	if (RunBench("broadcast", broadcast, AnchoredBroadcast, toe - NsecPerHour) != OK) return Error();
+	if (RunBench("precise", precise, AnchoredPrecise, toe - NsecPerHour) != OK) return Error();
+
+	return OK;
+}
+
+
+
+bool RunBench(const char* title, Ephemerides& direct, Ephemerides& anchored, Time start)
+{
+	int32 Epochs = (int32)(Minutes * 60 * Rate);
+	Time step = (Time)(NsecPerSec / Rate);
+
+	// Time them separately so neither one helps the other's cache
+	double usec[2];
+	Position pos[2][MaxSats]; double adjust[2][MaxSats];
+	Ephemerides* eph[2] = {&direct, &anchored};
+	for (int e=0; e<2; e++) {
+		clock_t begin = clock();
+		for (int32 epoch=0; epoch<Epochs; epoch++) {
+			bool valid[MaxSats];
+			for (int s=0; s<MaxSats; s++)
+				valid[s] = s < Sats;
+			if (eph[e]->SatPosAll(start + epoch*step, valid, pos[e], adjust[e]) != OK)
+				return Error();
+		}
+		usec[e] = (double)(clock() - begin) / CLOCKS_PER_SEC / Epochs * 1000000;
+	}
+
+	// Compare them at every epoch
+	double WorstPos = 0, WorstClock = 0;
+	for (int32 epoch=0; epoch<Epochs; epoch++) {
+		Time t = start + epoch*step;
+		for (int s=0; s<Sats; s++) {
+			Position p[2]; double a[2];
+			if (direct[s].SatPos(t, p[0], a[0]) != OK) return Error();
+			if (anchored[s].SatPos(t, p[1], a[1]) != OK) return Error();
+			WorstPos = max(WorstPos, Range(p[1] - p[0]));
+			WorstClock = max(WorstClock, abs(a[1] - a[0]) * C);
+		}
+	}
+
+	printf("%-10s %14.2f %14.2f %8.1f %16.2e %16.2e\n", title, usec[0], usec[1], 
+		usec[0]/usec[1], WorstPos, WorstClock);
+	return OK;
+}
+
+
+double Random()
+// Uniform between -1 and 1
+{
+	return 2.0 * rand() / RAND_MAX - 1;
+}
+
+
+
+ bool Configure(int argc, const char** argv)
+ {
+     // defaults
+	 Sats = 12;
+	 Rate = 20;
+	 AnchorStep = S(EphemeridesAnchored::DefaultStep);
+	 Minutes = 10;
+
+	 // Do for each argument
+	 const char* arg;
+	 int i;
+	 for (i=1; i<argc && argv[i][0] == '-'; i++) {
+
+		 if (Match(argv[i], "-debug=", arg))            DebugLevel = atoi(arg);
+		 else if (Match(argv[i], "-sats=", arg))        Sats = atoi(arg);
+		 else if (Match(argv[i], "-rate=", arg))        Rate = atof(arg);
+		 else if (Match(argv[i], "-anchors=", arg))     AnchorStep = atof(arg);
+		 else if (Match(argv[i], "-minutes=", arg))     Minutes = atof(arg);
+		 else    return Error("Didn't recognize option %s\n", argv[i]);
+	 }
+
+	 if (Sats < 1 || Sats > MaxSats)
+		 return Error("The number of satellites must be from 1 to %d\n", MaxSats);
+	 if (Rate <= 0 || AnchorStep <= 0 || Minutes <= 0 || Minutes > 110)
+		 return Error("Need a positive rate, anchor step, and up to 110 minutes\n");
+
+	 return OK;
+ }
+
+
+ bool DisplayOptions()
+ {
+	 printf("\n");
+     printf("BenchEphemeris [options]\n");
+	 printf("     Time the satellite positions at high rates, with and without anchors\n");
+	 printf("\n");
+	 printf("    Where {options} include any of the following:\n");
+	 printf("        -sats=n          - number of satellites (default 12)\n");
+	 printf("        -rate=hz         - epochs per second (default 20)\n");
+	 printf("        -anchors=sec     - time between anchors (default %.0f)\n", S(EphemeridesAnchored::DefaultStep));
+	 printf("        -minutes=n       - how long to run (default 10)\n");
+	 printf("\n");
+	 return OK;
+ }
@@ -0,0 +1,333 @@
+// BenchExclude - check and time the trial satellite exclusions
+//    Part of kinematic, a collection of utilities for GPS positioning
+//
+// Copyright (C) 2005  John Morris    kinematic@coyotebush.net
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation, version 2.
+
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// Runs synthetic kinematic sessions and tries every satellite and every pair
+//   of satellites out of each epoch, the way DoubleDiff looks for bad ones.
+//   Each trial is done twice:
+//     old - copy the previous epoch's solution and update it without them.
+//     new - downdate them out of the full solution, or do the old trial
+//           when the reference satellite is one of them.
+//   Now and then one satellite gets a phase blunder, taking turns so the
+//   reference satellite gets its share.
+//
+// Reports the largest differences in the trials' fits and positions, the
+//   trials where the two disagree about being acceptable, and the
+//   epochs where they pick different satellites to drop. The dropped
+//   solutions are then compared for position and covariance.
+//
+////////////////////////////////////////////////////////////////////////////////
+
+#include "Solution.h"
+#include "Policy.h"
+#include <stdio.h>
+#include <time.h>
+
+bool BenchExclude(int argc, const char** argv);
+bool Configure(int argc, const char** argv);
+bool DisplayOptions();
+bool RunSession(int seed);
+bool OldTrial(Solution& before, Observations& obs, int s, int t, double& fit, Position& pos);
+bool NewTrial(Solution& before, Solution& sol, Observations& obs, int s, int t, double& fit, Position& pos);
+void Invalidate(Observations& obs, int s, bool valid[2]);
+void Revalidate(Observations& obs, int s, bool valid[2]);
+double Random();
+
+// run string parameters
+int Sats;
+int Epochs;
+int Sessions;
+double CodeNoise, PhaseNoise;   // meters
+double Blunder;                 // meters
+int BlunderEvery;               // epochs
+
+// results
+Policy Check;
+int Trials, Downdated, Disagree, WorstDisagree;
+double MaxFitDiff, MaxPosDiff, MaxFinalPosDiff, MaxFinalCovDiff;
+clock_t OldTime, NewTime;
+
+
+
+
+int main(int argc, const char** argv)
+{
+	BenchExclude(argc, argv);
+	ShowErrors();
+	return 0;
+}
+
+
+bool BenchExclude(int argc, const char** argv)
+{
+	// parse the command line
+	if (Configure(argc, argv) != OK) {
+		DisplayOptions();
+		return Error();
+	}
+
+	printf("%d satellites, %d epochs, code noise %.2f m, phase noise %.3f m, "
+		   "%.2f m blunder every %d epochs\n",
+		Sats, Epochs, CodeNoise, PhaseNoise, Blunder, BlunderEvery);
+
+	for (int session=0; session<Sessions; session++)
+		if (RunSession(session+1) != OK) return Error();
+
+	printf("\n%d trials, %d downdated, %d full updates of the reference satellite\n",
+		Trials, Downdated, Trials-Downdated);
+	printf("largest trial difference:  fit %.3g   position %.3g m\n", MaxFitDiff, MaxPosDiff);
+	printf("trials disagreeing on acceptable: %d\n", Disagree);
+	printf("epochs dropping different satellites: %d\n", WorstDisagree);
+	printf("largest final difference:  position %.3g m   covariance factor %.3g\n",
+		MaxFinalPosDiff, MaxFinalCovDiff);
+	printf("trial time:  old %.1f msec   new %.1f msec\n",
+		(double)OldTime / CLOCKS_PER_SEC * 1000, (double)NewTime / CLOCKS_PER_SEC * 1000);
+	return OK;
+}
+
+
+
+bool RunSession(int seed)
+{
+	srand(seed);
+
+	// A base, and satellites in a rough hemisphere above it
+	Position base = Wgs84ToPosition(lla(37, -122, 100));
+	Position up = base / Range(base);
+	Position sat[MaxSats], velocity[MaxSats];
+	double ambiguity[MaxSats];
+	for (int s=0; s<Sats; s++) {
+		Position dir = up + Position(Random(), Random(), Random()) * .8;
+		sat[s] = base + dir / Range(dir) * 20000000;
+		velocity[s] = Position(Random(), Random(), Random()) * 3000;
+		ambiguity[s] = round(Random() * 1000);
+	}
+
+	// The rover starts about 3 km away and wanders
+	Position rover = base + Position(2000, 2000, 1000);
+	Position estimate = rover + Position(1, -1, 1);
+	Solution solution(base, estimate);
+
+	Observations obs;
+	obs.BasePos = base;
+	double CodeClock = 30, PhaseClock = -20;
+
+	for (int epoch=0; epoch<Epochs; epoch++) {
+		obs.GpsTime = epoch * NsecPerSec;
+		rover = rover + Position(Random(), Random(), Random()*.1);
+		obs.RoverPos = rover;
+
+		int bad = (epoch > 0 && epoch % BlunderEvery == 0)? (epoch/BlunderEvery) % Sats: -1;
+		for (int s=0; s<Sats; s++) {
+			sat[s] = sat[s] + velocity[s];
+			double diff = Range(rover - sat[s]) - Range(base - sat[s]);
+			Observation& o = obs[s];
+			o.Sat = s;
+			o.SatPos = sat[s];
+			o.ValidCode = o.ValidPhase = true;
+			o.Slip = (epoch == 0);
+			o.CodeWeight = .01;
+			o.PhaseWeight = 1;
+			o.PR = diff + CodeClock + Random() * CodeNoise * sqrt(3.0);
+			o.Phase = (diff + PhaseClock + Random() * PhaseNoise * sqrt(3.0)
+				       + ((s == bad)? Blunder: 0)) / L1WaveLength + ambiguity[s];
+		}
+
+		// The full solution
+		solution.NewPosition(estimate);
+		Solution before(solution);
+		Position pos; double cep, fit;
+		if (solution.Update(obs, pos, cep, fit) != OK) return Error();
+		if (cep == -1) continue;
+
+		// Try each satellite, then each pair, both ways, keeping the best of each
+		int OldWorst = -1, NewWorst = -1;
+		double OldBest = 999999, NewBest = 999999;
+		for (int i=0; i<Sats*Sats; i++) {
+			int s = i / Sats, t = i % Sats;
+			if (s == t) t = -1;
+			else if (t < s) continue;
+
+			double OldFit, NewFit; Position OldPos, NewPos;
+			clock_t start = clock();
+			if (OldTrial(before, obs, s, t, OldFit, OldPos) != OK) return Error();
+			clock_t middle = clock();
+			if (NewTrial(before, solution, obs, s, t, NewFit, NewPos) != OK) return Error();
+			OldTime += middle - start;
+			NewTime += clock() - middle;
+
+			Trials++;
+			if ((OldFit == -1) != (NewFit == -1))
+				Disagree++;
+			else if (OldFit != -1) {
+				MaxFitDiff = max(MaxFitDiff, abs(OldFit - NewFit));
+				MaxPosDiff = max(MaxPosDiff, Range(OldPos - NewPos));
+			}
+			if (OldFit != -1 && OldFit < OldBest) {OldWorst = i; OldBest = OldFit;}
+			if (NewFit != -1 && NewFit < NewBest) {NewWorst = i; NewBest = NewFit;}
+		}
+		if (OldWorst != NewWorst)
+			WorstDisagree++;
+
+		// Drop the worst both ways and compare the resulting solutions
+		if (OldWorst != -1 && NewWorst != -1) {
+			PositionFactor f[2]; Position p[2];
+			int worst[2] = {OldWorst, NewWorst};
+			for (int k=0; k<2; k++) {
+				int s = worst[k] / Sats, t = worst[k] % Sats;
+				if (s == t) t = -1;
+				bool vs[2], vt[2] = {false, false};
+				Invalidate(obs, s, vs);
+				if (t != -1) Invalidate(obs, t, vt);
+				Solution dropped(before);
+				if (dropped.Update(obs, p[k], cep, fit) != OK) return Error();
+				if (dropped.GetFactor(f[k]) != OK) return Error();
+				if (t != -1) Revalidate(obs, t, vt);
+				Revalidate(obs, s, vs);
+			}
+			MaxFinalPosDiff = max(MaxFinalPosDiff, Range(p[0] - p[1]));
+			for (int r=0; r<3; r++) for (int c=r; c<3; c++)
+				MaxFinalCovDiff = max(MaxFinalCovDiff, abs(f[0].R[r][c] - f[1].R[r][c]));
+		}
+
+		estimate = pos;
+	}
+
+	return OK;
+}
+
+
+
+bool OldTrial(Solution& before, Observations& obs, int s, int t, double& fit, Position& pos)
+// Update a copy of the previous solution without the satellites
+{
+	bool vs[2], vt[2] = {false, false};
+	Invalidate(obs, s, vs);
+	if (t != -1) Invalidate(obs, t, vt);
+
+	Solution trial(before);
+	double cep;
+	if (trial.Update(obs, pos, cep, fit) != OK) return Error();
+	if (!Check.Acceptable(obs, trial)) fit = -1;
+
+	if (t != -1) Revalidate(obs, t, vt);
+	Revalidate(obs, s, vs);
+	return OK;
+}
+
+
+bool NewTrial(Solution& before, Solution& sol, Observations& obs, int s, int t, double& fit, Position& pos)
+// Downdate the satellites out of the full solution (same as DoubleDiff's TryExclusion)
+{
+	if (!sol.CanExclude(s, t))
+		return OldTrial(before, obs, s, t, fit, pos);
+	Downdated++;
+
+	if (sol.Exclude(obs, s, t, fit) != OK) return Error();
+	bool vs[2], vt[2] = {false, false};
+	Invalidate(obs, s, vs);
+	if (t != -1) Invalidate(obs, t, vt);
+
+	pos = sol.GetPosition();
+	if (fit != -1 && !Check.Acceptable(obs, sol)) fit = -1;
+
+	if (t != -1) Revalidate(obs, t, vt);
+	Revalidate(obs, s, vs);
+	return sol.Restore();
+}
+
+
+void Invalidate(Observations& obs, int s, bool valid[2])
+{
+	valid[0] = obs[s].ValidCode;  obs[s].ValidCode = false;
+	valid[1] = obs[s].ValidPhase; obs[s].ValidPhase = false;
+}
+
+
+void Revalidate(Observations& obs, int s, bool valid[2])
+{
+	obs[s].ValidCode = valid[0];
+	obs[s].ValidPhase = valid[1];
+}
+
+
+double Random()
+// Uniform between -1 and 1
+{
+	return 2.0 * rand() / RAND_MAX - 1;
+}
+
+
+
+ bool Configure(int argc, const char** argv)
+ {
+     // defaults
+	 Sats = 8;
+	 Epochs = 300;
+	 Sessions = 4;
+	 CodeNoise = .5;
+	 PhaseNoise = .003;
+	 Blunder = .5;
+	 BlunderEvery = 7;
+
+	 // Do for each argument
+	 const char* arg;
+	 int i;
+	 for (i=1; i<argc && argv[i][0] == '-'; i++) {
+
+		 if (Match(argv[i], "-debug=", arg))            DebugLevel = atoi(arg);
+		 else if (Match(argv[i], "-sats=", arg))        Sats = atoi(arg);
+		 else if (Match(argv[i], "-epochs=", arg))      Epochs = atoi(arg);
+		 else if (Match(argv[i], "-sessions=", arg))    Sessions = atoi(arg);
+		 else if (Match(argv[i], "-code=", arg))        CodeNoise = atof(arg);
+		 else if (Match(argv[i], "-phase=", arg))       PhaseNoise = atof(arg);
+		 else if (Match(argv[i], "-blunder=", arg))     Blunder = atof(arg);
+		 else if (Match(argv[i], "-every=", arg))       BlunderEvery = atoi(arg);
+		 else    return Error("Didn't recognize option %s\n", argv[i]);
+	 }
+
+	 // (dropping a pair should leave enough satellites for a solid solution)
+	 if (Sats < 7 || GpsEquationsSize(Sats+2) == -1)
+		 return Error("The number of satellites must be from 7 to %d\n",
+		              EquationChannels[NrEquationSizes-1]-2);
+	 if (Epochs < 1 || Sessions < 1 || BlunderEvery < 1)
+		 return Error("Need at least one epoch, session and blunder interval\n");
+
+	 return OK;
+ }
+
+
+ bool DisplayOptions()
+ {
+	 printf("\n");
+     printf("BenchExclude [options]\n");
+	 printf("     Compare trial satellite exclusions by downdating and by updating\n");
+	 printf("\n");
+	 printf("    Where {options} include any of the following:\n");
+	 printf("        -sats=n          - number of satellites (default 8)\n");
+	 printf("        -epochs=n        - epochs per session (default 300)\n");
+	 printf("        -sessions=n      - number of sessions (default 4)\n");
+	 printf("        -code=m          - code noise in meters (default .5)\n");
+	 printf("        -phase=m         - phase noise in meters (default .003)\n");
+	 printf("        -blunder=m       - size of the phase blunders (default .5)\n");
+	 printf("        -every=n         - epochs between blunders (default 7)\n");
+	 printf("\n");
+	 return OK;
+ }
@@ -0,0 +1,236 @@
+// BenchFix - check and time the integer ambiguity resolution
+//    Part of kinematic, a collection of utilities for GPS positioning
+//
+// Copyright (C) 2005  John Morris    kinematic@coyotebush.net
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation, version 2.
+
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// Runs synthetic kinematic sessions through Solution with fixing turned on.
+//   The rover wanders around a base a few km away, and each satellite has
+//   a random integer number of waves in its phase. Whenever the solution is
+//   fixed, its ambiguities are checked against the true integers.
+//
+// Reports the time to first fix, the fixed and wrong epochs, and the
+//   longest integer search.
+//
+////////////////////////////////////////////////////////////////////////////////
+
+#include "Solution.h"
+#include <stdio.h>
+
+bool BenchFix(int argc, const char** argv);
+bool Configure(int argc, const char** argv);
+bool DisplayOptions();
+bool RunSession(int seed, FixStatistics& st, int& wrong, double& worst);
+double Random();
+
+// run string parameters
+int Sats;
+int Epochs;
+int Sessions;
+double CodeNoise, PhaseNoise;   // meters
+double Ratio;
+double Budget;                  // msec
+
+
+
+
+int main(int argc, const char** argv)
+{
+	BenchFix(argc, argv);
+	ShowErrors();
+	return 0;
+}
+
+
+bool BenchFix(int argc, const char** argv)
+{
+	// parse the command line
+	if (Configure(argc, argv) != OK) {
+		DisplayOptions();
+		return Error();
+	}
+
+	printf("%d satellites, %d epochs, code noise %.2f m, phase noise %.3f m\n",
+		Sats, Epochs, CodeNoise, PhaseNoise);
+	printf("session   ttff(sec)  fixed epochs   wrong   worst error(m)   longest search(msec)\n");
+
+	int TotalWrong = 0; int Unfixed = 0; double TotalTtff = 0; int Timeouts = 0;
+	for (int session=0; session<Sessions; session++) {
+		FixStatistics st; int wrong; double worst;
+		if (RunSession(session+1, st, wrong, worst) != OK) return Error();
+
+		if (st.FixedSegments == 0) {
+			printf("%7d %11s %13d %7d %16s %20.3f\n", session, "none", (int)st.FixedEpochs,
+				wrong, "", S(st.MaxSearchTime)*1000);
+			Unfixed++;
+		}
+		else {
+			printf("%7d %11.0f %13d %7d %16.4f %20.3f\n", session, st.MinTtff, (int)st.FixedEpochs,
+				wrong, worst, S(st.MaxSearchTime)*1000);
+			TotalTtff += st.MinTtff;
+		}
+		TotalWrong += wrong;
+		Timeouts += st.Timeouts;
+	}
+
+	if (Unfixed < Sessions)
+		printf("\naverage time to first fix %.1f sec, ", TotalTtff/(Sessions-Unfixed));
+	printf("%d sessions never fixed, %d wrong epochs, %d searches timed out\n", 
+		Unfixed, TotalWrong, Timeouts);
+	return OK;
+}
+
+
+
+bool RunSession(int seed, FixStatistics& st, int& wrong, double& worst)
+{
+	srand(seed);
+
+	// A base, and satellites in a rough hemisphere above it
+	Position base = Wgs84ToPosition(lla(37, -122, 100));
+	Position up = base / Range(base);
+	Position sat[MaxSats], velocity[MaxSats];
+	double ambiguity[MaxSats];
+	for (int s=0; s<Sats; s++) {
+		Position dir = up + Position(Random(), Random(), Random()) * .8;
+		sat[s] = base + dir / Range(dir) * 20000000;
+		velocity[s] = Position(Random(), Random(), Random()) * 3000;
+		ambiguity[s] = round(Random() * 1000);
+	}
+
+	// The rover starts about 3 km away and wanders
+	Position rover = base + Position(2000, 2000, 1000);
+	Position estimate = rover + Position(1, -1, 1);
+	Solution solution(base, estimate);
+	solution.SetFixing(Ratio, (Time)(Budget * NsecPerSec / 1000));
+
+	Observations obs;
+	obs.BasePos = base;
+	double CodeClock = 30, PhaseClock = -20;
+
+	wrong = 0; worst = 0;
+	for (int epoch=0; epoch<Epochs; epoch++) {
+		obs.GpsTime = epoch * NsecPerSec;
+		rover = rover + Position(Random(), Random(), Random()*.1);
+		obs.RoverPos = rover;
+
+		for (int s=0; s<Sats; s++) {
+			sat[s] = sat[s] + velocity[s];
+			double diff = Range(rover - sat[s]) - Range(base - sat[s]);
+			Observation& o = obs[s];
+			o.Sat = s;
+			o.SatPos = sat[s];
+			o.ValidCode = o.ValidPhase = true;
+			o.Slip = (epoch == 0);
+			o.CodeWeight = .01;
+			o.PhaseWeight = 1;
+			o.PR = diff + CodeClock + Random() * CodeNoise * sqrt(3.0);
+			o.Phase = (diff + PhaseClock + Random() * PhaseNoise * sqrt(3.0)) / L1WaveLength
+				      + ambiguity[s];
+		}
+
+		// Solve, and fix if we can
+		solution.NewPosition(estimate);
+		Position pos; double cep, fit;
+		if (solution.Update(obs, pos, cep, fit) != OK) return Error();
+		if (cep == -1) continue;
+		if (solution.Fix(obs, pos) != OK) return Error();
+		estimate = pos;
+
+		// Check the fixed ambiguities against the truth. They are relative to
+		//   the reference satellite, so they should all be off by the same amount.
+		if (solution.IsFixed()) {
+			worst = max(worst, Range(pos - rover));
+			double offset = 0; bool first = true; bool ok = true;
+			for (int s=0; s<Sats; s++) {
+				double a = solution.GetAmbiguity(s);
+				if (a == 0) continue;
+				if (first) {offset = round(a) - ambiguity[s]; first = false;}
+				if (round(a) - ambiguity[s] != offset) ok = false;
+			}
+			if (!ok) wrong++;
+		}
+	}
+
+	solution.GetFixStatistics(st);
+	return OK;
+}
+
+
+double Random()
+// Uniform between -1 and 1
+{
+	return 2.0 * rand() / RAND_MAX - 1;
+}
+
+
+
+ bool Configure(int argc, const char** argv)
+ {
+     // defaults
+	 Sats = 8;
+	 Epochs = 600;
+	 Sessions = 10;
+	 CodeNoise = .5;
+	 PhaseNoise = .003;
+	 Ratio = 3;
+	 Budget = 50;
+
+	 // Do for each argument
+	 const char* arg;
+	 int i;
+	 for (i=1; i<argc && argv[i][0] == '-'; i++) {
+
+		 if (Match(argv[i], "-debug=", arg))            DebugLevel = atoi(arg);
+		 else if (Match(argv[i], "-sats=", arg))        Sats = atoi(arg);
+		 else if (Match(argv[i], "-epochs=", arg))      Epochs = atoi(arg);
+		 else if (Match(argv[i], "-sessions=", arg))    Sessions = atoi(arg);
+		 else if (Match(argv[i], "-code=", arg))        CodeNoise = atof(arg);
+		 else if (Match(argv[i], "-phase=", arg))       PhaseNoise = atof(arg);
+		 else if (Match(argv[i], "-ratio=", arg))       Ratio = atof(arg);
+		 else if (Match(argv[i], "-fixbudget=", arg))   Budget = atof(arg);
+		 else    return Error("Didn't recognize option %s\n", argv[i]);
+	 }
+
+	 if (Sats < 5 || GpsEquationsSize(Sats+2) == -1)
+		 return Error("The number of satellites must be from 5 to %d\n",
+		              EquationChannels[NrEquationSizes-1]-2);
+	 if (Epochs < 1 || Sessions < 1)
+		 return Error("Need at least one epoch and one session\n");
+
+	 return OK;
+ }
+
+
+ bool DisplayOptions()
+ {
+	 printf("\n");
+     printf("BenchFix [options]\n");
+	 printf("     Check and time the integer ambiguity resolution\n");
+	 printf("\n");
+	 printf("    Where {options} include any of the following:\n");
+	 printf("        -sats=n          - number of satellites (default 8)\n");
+	 printf("        -epochs=n        - epochs per session (default 600)\n");
+	 printf("        -sessions=n      - number of sessions (default 10)\n");
+	 printf("        -code=m          - code noise in meters (default .5)\n");
+	 printf("        -phase=m         - phase noise in meters (default .003)\n");
+	 printf("        -ratio=r         - ratio test threshhold (default 3)\n");
+	 printf("        -fixbudget=msec  - most time for each integer search (default 50)\n");
+	 printf("\n");
+	 return OK;
+ }
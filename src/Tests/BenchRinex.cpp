@@ -0,0 +1,322 @@
+// BenchRinex - time reading a Rinex observation file
+//    Part of kinematic, a collection of utilities for GPS positioning
+//
+// Copyright (C) 2005  John Morris    kinematic@coyotebush.net
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation, version 2.
+
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// Reads a Rinex observation file to the end, first a line at a time
+//   through a BufferedStream, then the same way from a pipe, as
+//   NewRawReceiver opens it, then decoded in place from a mapped file,
+//   and last loaded whole by several threads (RawRinexStore).
+//
+// Reports the epochs per second each way, and whether all ways got the
+//   same observations. The times are wall clock, since the store uses
+//   several threads, and its load time counts against it.
+//
+// Before timing, reads a small made up file of the awkward shape real
+//   receivers write (CR LF line ends, trailing blanks stripped, fields
+//   we don't use between the ones we do) and checks all ways agree on it.
+//
+////////////////////////////////////////////////////////////////////////////////
+
+#include "RawRinex.h"
+#include "RawRinexStore.h"
+#include "InputFile.h"
+#include "MmapInputFile.h"
+#include "BufferedStream.h"
+#include "MappedFile.h"
+#include "NewRawReceiver.h"
+#include "Thread.h"
+#include <stdio.h>
+#if !defined(WINDOWS)
+#include <unistd.h>
+#endif
+
+bool BenchRinex(int argc, const char** argv);
+bool Configure(int argc, const char** argv);
+bool DisplayOptions();
+enum {Lines, Piped, InPlace, Loaded};
+bool RunBench(const char* title, int how, const char* name, int32 repeat,
+              int32& epochs, uint64& hash);
+bool RunAllWays(bool print, const char* name, int32 repeat);
+bool WriteAwkward(const char* name);
+
+// run string parameters
+const char* FileName;
+int32 Repeat;
+int32 Threads;
+
+
+#if !defined(WINDOWS)
+class PipeWriter: public Thread
+// Feeds the file into a pipe, like a program writing to its output
+{
+public:
+	PipeWriter(const char* name, int fd): Name(name), Fd(fd) {}
+protected:
+	void Run();
+	const char* Name;
+	int Fd;
+};
+#endif
+
+
+int main(int argc, const char** argv)
+{
+	BenchRinex(argc, argv);
+	ShowErrors();
+	return 0;
+}
+
+
+bool BenchRinex(int argc, const char** argv)
+{
+	// parse the command line
+	if (Configure(argc, argv) != OK) {
+		DisplayOptions();
+		return Error();
+	}
+
+	// Make sure the ways agree on an awkward file before we time them
+	char awkward[260];
+	if (MappedFile::TempFile(awkward, sizeof(awkward), "rinex") != OK) return Error();
+	bool err = WriteAwkward(awkward);
+	if (err == OK) err = RunAllWays(false, awkward, 1);
+	remove(awkward);
+	if (err != OK) return Error("The ways of reading disagree on an awkward file\n");
+
+	printf("%-10s %10s %10s %12s %18s\n", "", "epochs", "msec", "epochs/sec", "checksum");
+	return RunAllWays(true, FileName, Repeat);
+}
+
+
+
+bool RunAllWays(bool print, const char* name, int32 repeat)
+/////////////////////////////////////////////////////////////////////
+// Read the file each way, printing the results if asked.
+//   It is an error if the ways don't all get the same observations.
+/////////////////////////////////////////////////////////////////////
+{
+	static const struct {const char* title; int how;} Ways[] = {
+		{"lines", Lines},
+#if !defined(WINDOWS)
+		{"piped", Piped},
+#endif
+		{"in place", InPlace},
+		{"loaded", Loaded}
+	};
+	static const int NrWays = sizeof(Ways) / sizeof(Ways[0]);
+
+	int32 epochs[NrWays];
+	uint64 hash[NrWays];
+	for (int w=0; w<NrWays; w++) {
+		if (RunBench(print? Ways[w].title: NULL, Ways[w].how, name, repeat,
+		             epochs[w], hash[w]) != OK)
+			return Error();
+		if (epochs[w] != epochs[0] || hash[w] != hash[0])
+			return Error("Read %s %s, it got %d epochs, not %d, or other observations\n",
+			             name, Ways[w].title, (int)epochs[w], (int)epochs[0]);
+	}
+
+	return OK;
+}
+
+
+
+bool RunBench(const char* title, int how, const char* name, int32 repeat,
+              int32& epochs, uint64& hash)
+{
+	double best = 0;
+	epochs = 0;
+	hash = 0;
+
+	// Take the best of several runs, so the file is in memory
+	for (int r=0; r<repeat; r++) {
+		InputFile file(name);
+		BufferedStream buf(file);
+		MmapInputFile map(name, true);
+		if (file.GetError() != OK || map.GetError() != OK)
+			return Error("Can't open %s\n", name);
+
+		Time begin = GetCurrentTime();
+		RawReceiver* rinex;
+		Thread* writer = NULL;
+		int PipeIn = -1;
+		if (how == Loaded)  rinex = new RawRinexStore(name, Threads);
+		else if (how == Piped) {
+#if !defined(WINDOWS)
+			// The receiver opens the pipe by name, so it can't be mapped
+			int fd[2];
+			if (pipe(fd) != 0) return SysError("Can't create a pipe\n");
+			char fdname[32];
+			snprintf(fdname, sizeof(fdname), "/dev/fd/%d", fd[0]);
+			writer = new PipeWriter(name, fd[1]);
+			if (writer->Start() != OK) return Error();
+			rinex = NewRawReceiver("RINEX", fdname);
+			if (rinex == NULL) return Error("Can't read Rinex from a pipe\n");
+			PipeIn = fd[0];
+#endif
+		}
+		else                rinex = new RawRinex(how == InPlace? (Stream&)map: (Stream&)buf);
+		if (rinex->GetError() != OK) return Error();
+
+		// Checksum the observations (FNV-1a, a word at a time) so we know both ways agree
+		hash = 14695981039346656037ULL;
+		for (epochs = 0; rinex->NextEpoch() == OK; epochs++)
+			for (int s=0; s<MaxSats; s++) {
+				RawObservation& o = rinex->obs[s];
+				if (!o.Valid) continue;
+				double values[] = {S(rinex->GpsTime), o.PR, o.Phase, o.SNR, o.Doppler, (double)o.Slip};
+				for (int i=0; i<6; i++) {
+					uint64 word;
+					memcpy(&word, &values[i], sizeof(word));
+					hash = (hash ^ word) * 1099511628211ULL;
+				}
+			}
+
+		double msec = S(GetCurrentTime() - begin) * 1000;
+		delete rinex;
+		if (writer != NULL) {
+#if !defined(WINDOWS)
+			// The receiver keeps its end of the pipe open, and may have stopped
+			//   early, so read out the rest or the writer never finishes
+			char rest[65536];
+			while (read(PipeIn, rest, sizeof(rest)) > 0)
+				;
+			close(PipeIn);
+#endif
+			writer->Join();
+			delete writer;
+		}
+		if (r == 0 || msec < best)
+			best = msec;
+	}
+
+	// The end of file errors are expected
+	ClearError();
+
+	if (title != NULL)
+		printf("%-10s %10d %10.1f %12.0f %18llx\n", title, (int)epochs, best,
+			epochs / max(best, 0.001) * 1000, (unsigned long long)hash);
+	return OK;
+}
+
+
+
+bool WriteAwkward(const char* name)
+/////////////////////////////////////////////////////////////////////
+// A few epochs with the types C1 L1 P2 S1, where we don't use P2.
+//   The lines end in CR LF with their trailing blanks stripped, so
+//   a line often ends inside or just before a field we skip.
+/////////////////////////////////////////////////////////////////////
+{
+	FILE* f = fopen(name, "wb");
+	if (f == NULL) return SysError("Can't create %s\n", name);
+
+	fprintf(f, "%-60s%s\r\n", "     2.10           OBSERVATION         G (GPS)", "RINEX VERSION / TYPE");
+	fprintf(f, "%-60s%s\r\n", "BenchRinex", "PGM / RUN BY / DATE");
+	fprintf(f, "%-60s%s\r\n", "  6374430.8487  -234966.9861    71905.3973", "APPROX POSITION XYZ");
+	fprintf(f, "%-60s%s\r\n", "     1     0", "WAVELENGTH FACT L1/2");
+	fprintf(f, "%-60s%s\r\n", "     4    C1    L1    P2    S1", "# / TYPES OF OBSERV");
+	fprintf(f, "%-60s%s\r\n", "  2006    11     5     6     0    0.000000", "TIME OF FIRST OBS");
+	fprintf(f, "%-60s%s\r\n", "", "END OF HEADER");
+
+	static const int Sats = 4;
+	for (int k=0; k<3; k++) {
+		fprintf(f, " 06 11  5  6  0%11.7f  0%3d", (double)k, Sats);
+		for (int s=1; s<=Sats; s++)
+			fprintf(f, "G%02d", s);
+		fprintf(f, "\r\n");
+
+		// Satellite s has its last s-1 fields blank (and stripped)
+		for (int s=1; s<=Sats; s++) {
+			double pr = 2.2e7 + s*1e5 + k*123.456;
+			char line[81];
+			snprintf(line, sizeof(line), "%14.3f  %14.3f 5%14.3f  %14.3f  ",
+			         pr, pr/L1WaveLength, pr + 3.5, 40.0 + s);
+			int len = 16 * (Sats - s + 1);
+			while (len > 0 && line[len-1] == ' ')
+				len--;
+			fprintf(f, "%.*s\r\n", len, line);
+		}
+	}
+
+	if (fclose(f) != 0) return SysError("Can't write %s\n", name);
+	return OK;
+}
+
+
+
+#if !defined(WINDOWS)
+void PipeWriter::Run()
+{
+	FILE* in = fopen(Name, "rb");
+	char buf[65536];
+	size_t len;
+	while (in != NULL && (len = fread(buf, 1, sizeof(buf), in)) > 0)
+		if (write(Fd, buf, len) != (ssize_t)len)
+			break;
+	if (in != NULL)
+		fclose(in);
+	close(Fd);
+}
+#endif
+
+
+
+ bool Configure(int argc, const char** argv)
+ {
+     // defaults
+	 Repeat = 3;
+	 Threads = 4;
+
+	 // Do for each argument
+	 const char* arg;
+	 int i;
+	 for (i=1; i<argc && argv[i][0] == '-'; i++) {
+
+		 if (Match(argv[i], "-debug=", arg))            DebugLevel = atoi(arg);
+		 else if (Match(argv[i], "-repeat=", arg))      Repeat = atoi(arg);
+		 else if (Match(argv[i], "-threads=", arg))     Threads = atoi(arg);
+		 else    return Error("Didn't recognize option %s\n", argv[i]);
+	 }
+
+	 if (argc - i != 1)
+		 return Error("Need the name of a Rinex observation file\n");
+	 FileName = argv[i];
+
+	 if (Repeat < 1)
+		 return Error("Need to run at least once\n");
+
+	 return OK;
+ }
+
+
+ bool DisplayOptions()
+ {
+	 printf("\n");
+     printf("BenchRinex [options] file\n");
+	 printf("     Time reading a Rinex observation file, a line at a time, from a pipe, in place and loaded\n");
+	 printf("\n");
+	 printf("    Where {options} include any of the following:\n");
+	 printf("        -repeat=n        - best of n runs (default 3)\n");
+	 printf("        -threads=n       - threads for loading the file (default 4)\n");
+	 printf("\n");
+	 return OK;
+ }
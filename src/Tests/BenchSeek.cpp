@@ -0,0 +1,375 @@
+// BenchSeek - seek raw receivers to a time, and check what comes next
+//    Part of kinematic, a collection of utilities for GPS positioning
+//
+// Copyright (C) 2006  John Morris    www.precision-gps.org
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation, version 2.
+
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// Writes a made up Rinex observation file, with some epochs stamped a
+//   little before the whole second and some a little after, and an
+//   RTCM 2.3 capture of the same data. Then each way of reading them
+//   seeks to a series of times. After each seek, the next epoch must be
+//   the first one at or after the time, with the same observations as
+//   when the file is read from the start.
+//
+// The seeks land on the epochs, half way between them and just past
+//   them, before the first epoch and after the last. Receivers which
+//   can seek go back and forth; the others only go forward.
+//
+////////////////////////////////////////////////////////////////////////////////
+
+#include "RawRinex.h"
+#include "RawRinexStore.h"
+#include "RawRtcm23.h"
+#include "Rtcm23Station.h"
+#include "InputFile.h"
+#include "OutputFile.h"
+#include "MmapInputFile.h"
+#include "BufferedStream.h"
+#include "MappedFile.h"
+#include <stdio.h>
+#include <vector>
+#include <algorithm>
+using namespace std;
+
+bool BenchSeek(int argc, const char** argv);
+bool Configure(int argc, const char** argv);
+bool DisplayOptions();
+bool WriteRinex(const char* name);
+bool WriteRtcm23(const char* rinex, const char* name);
+enum {RinexMapped, RinexStream, RinexLoaded, Rtcm23Mapped, Rtcm23Stream};
+bool RunSeeks(const char* title, int how, const char* name, int32& wrong);
+uint64 Signature(RawReceiver& gps);
+
+// run string parameters
+int32 Epochs;
+int32 Seeks;
+const char* Capture;
+
+// The made up data starts on the hour
+static const int Sats = 8;
+static const Time Skew = 50000;   // nsec the stamps are off by
+Time Start;
+
+
+class Source
+//////////////////////////////////////////////////////////////////////
+// A receiver and the streams it reads from
+//////////////////////////////////////////////////////////////////////
+{
+public:
+	Source(int how, const char* name);
+	~Source();
+	RawReceiver* Gps;
+	bool CanSeek;
+
+protected:
+	InputFile* File;
+	BufferedStream* Buf;
+	MmapInputFile* Map;
+};
+
+
+
+int main(int argc, const char** argv)
+{
+	BenchSeek(argc, argv);
+	ShowErrors();
+	return 0;
+}
+
+
+bool BenchSeek(int argc, const char** argv)
+{
+	// parse the command line
+	if (Configure(argc, argv) != OK) {
+		DisplayOptions();
+		return Error();
+	}
+
+	// Make up the data, unless we have a real RTCM 2.3 capture
+	char rinex[260], rtcm[260];
+	if (MappedFile::TempFile(rinex, sizeof(rinex), "seek") != OK) return Error();
+	if (MappedFile::TempFile(rtcm, sizeof(rtcm), "seek") != OK) return Error();
+	bool err = WriteRinex(rinex);
+	if (err == OK && Capture == NULL)
+		err = WriteRtcm23(rinex, rtcm);
+	const char* rtcm23 = (Capture != NULL)? Capture: rtcm;
+
+	// Seek every way we can read it
+	int32 wrong = 0;
+	printf("%-14s %8s %8s %8s %12s\n", "", "epochs", "seeks", "wrong", "usec/seek");
+	if (err == OK) err = RunSeeks("rinex mapped", RinexMapped, rinex, wrong);
+	if (err == OK) err = RunSeeks("rinex stream", RinexStream, rinex, wrong);
+	if (err == OK) err = RunSeeks("rinex loaded", RinexLoaded, rinex, wrong);
+	if (err == OK) err = RunSeeks("rtcm23 mapped", Rtcm23Mapped, rtcm23, wrong);
+	if (err == OK) err = RunSeeks("rtcm23 stream", Rtcm23Stream, rtcm23, wrong);
+
+	// Clean up, including the index of the Rinex file
+	char index[280];
+	snprintf(index, sizeof(index), "%s.index", rinex);
+	remove(index);
+	remove(rinex);
+	remove(rtcm);
+
+	if (err != OK) return Error();
+	if (wrong != 0)
+		return Error("%d seeks didn't come to the right epoch\n", (int)wrong);
+	return OK;
+}
+
+
+
+bool WriteRinex(const char* name)
+/////////////////////////////////////////////////////////////////////
+// One epoch a second, each a little early, on time or a little late
+//   in turn. A satellite drops out now and then.
+/////////////////////////////////////////////////////////////////////
+{
+	FILE* f = fopen(name, "w");
+	if (f == NULL) return SysError("Can't create %s\n", name);
+
+	fprintf(f, "%-60s%s\n", "     2.10           OBSERVATION         G (GPS)", "RINEX VERSION / TYPE");
+	fprintf(f, "%-60s%s\n", "BenchSeek", "PGM / RUN BY / DATE");
+	fprintf(f, "%-60s%s\n", "  6374430.8487  -234966.9861    71905.3973", "APPROX POSITION XYZ");
+	fprintf(f, "%-60s%s\n", "        0.0000        0.0000        0.0000", "ANTENNA: DELTA H/E/N");
+	fprintf(f, "%-60s%s\n", "     1     0", "WAVELENGTH FACT L1/2");
+	fprintf(f, "%-60s%s\n", "     4    C1    L1    S1    D1", "# / TYPES OF OBSERV");
+	fprintf(f, "%-60s%s\n", "  2006    11     5     6     0    0.000000", "TIME OF FIRST OBS");
+	fprintf(f, "%-60s%s\n", "", "END OF HEADER");
+
+	for (int32 k=0; k<Epochs; k++) {
+		Time stamp = Start + k*NsecPerSec + (k%3 - 1)*Skew;
+		int32 year, month, day, hour, min, sec, nsec;
+		TimeToDate(stamp, year, month, day);
+		TimeToTod(stamp, hour, min, sec, nsec);
+
+		int sat[Sats], n = 0;
+		for (int s=1; s<=Sats; s++)
+			if ((k + 7*s) % 41 != 0)
+				sat[n++] = s;
+
+		fprintf(f, " %02d %2d %2d %2d %2d%11.7f  0%3d", (int)(year%100), (int)month, (int)day,
+			(int)hour, (int)min, sec + nsec/1e9, n);
+		for (int i=0; i<n; i++)
+			fprintf(f, "G%02d", sat[i]);
+		fprintf(f, "\n");
+
+		for (int i=0; i<n; i++) {
+			double pr = 2e7 + sat[i]*1e5 + k*(sat[i]-4.5)*123.456;
+			fprintf(f, "%14.3f  %14.3f  %14.3f  %14.3f  \n", pr, pr/L1WaveLength, 45.0, 0.0);
+		}
+	}
+
+	if (fclose(f) != 0) return SysError("Can't write %s\n", name);
+	return OK;
+}
+
+
+
+bool WriteRtcm23(const char* rinex, const char* name)
+// Broadcast the Rinex file as a base station would
+{
+	MmapInputFile in(rinex);
+	RawRinex gps(in);
+	OutputFile out(name);
+	if (gps.GetError() != OK || out.GetError() != OK) return Error();
+	Rtcm23Station station(out, gps);
+	if (station.GetError() != OK) return Error();
+
+	while (gps.NextEpoch() == OK)
+		if (station.OutputEpoch() != OK) return Error();
+	ClearError();
+
+	return out.Flush();
+}
+
+
+
+bool RunSeeks(const char* title, int how, const char* name, int32& wrong)
+{
+	// Read it from the start to see where the epochs are
+	vector<Time> time;
+	vector<uint64> sig;
+	{
+		Source src(how, name);
+		if (src.Gps == NULL) return Error();
+		while (src.Gps->NextEpoch() == OK) {
+			time.push_back(src.Gps->GpsTime);
+			sig.push_back(Signature(*src.Gps));
+		}
+		ClearError();
+	}
+	if (time.empty())
+		return Error("%s: no epochs in %s\n", title, name);
+
+	// On the epochs, half way between, just past, and off both ends
+	Time interval = NsecPerSec / RawReceiver::HZ;
+	vector<Time> target;
+	target.push_back(time.front() - 10*interval);
+	for (int32 i=0; i<Seeks; i++) {
+		Time t = time[rand() % time.size()];
+		switch (rand() % 3) {
+		case 0: break;
+		case 1: t -= interval/2; break;
+		case 2: t += 1; break;
+		}
+		target.push_back(t);
+	}
+	sort(target.begin()+1, target.end());
+	target.push_back(time.back() + interval);
+
+	// Receivers which can seek also go backwards
+	Source src(how, name);
+	if (src.Gps == NULL) return Error();
+	int passes = src.CanSeek? 2: 1;
+
+	int32 seeks = 0, bad = 0;
+	Time begin = GetCurrentTime();
+	for (int pass=0; pass<passes; pass++) {
+		if (pass == 1)
+			reverse(target.begin(), target.end());
+
+		Time previous = -1;
+		for (size_t i=0; i<target.size(); i++) {
+			Time t = target[i];
+			if (!src.CanSeek && t <= previous)
+				continue;
+			size_t e = lower_bound(time.begin(), time.end(), t) - time.begin();
+			seeks++;
+
+			bool ok = (src.Gps->SeekTo(t) == OK && src.Gps->NextEpoch() == OK);
+			if (!ok) ClearError();
+			if (e == time.size())
+				bad += ok;
+			else if (!ok || src.Gps->GpsTime != time[e] || Signature(*src.Gps) != sig[e]) {
+				debug("%s: seek to %.3f got %.3f, not %.3f\n", title,
+					S(t), ok? S(src.Gps->GpsTime): 0.0, S(time[e]));
+				bad++;
+			}
+			previous = ok? src.Gps->GpsTime: MaxTime;
+		}
+	}
+	double usec = S(GetCurrentTime() - begin) * 1e6 / max(seeks, (int32)1);
+
+	printf("%-14s %8d %8d %8d %12.1f\n", title, (int)time.size(), (int)seeks, (int)bad, usec);
+	wrong += bad;
+	return OK;
+}
+
+
+
+uint64 Signature(RawReceiver& gps)
+// Which satellites, and their pseudoranges (FNV-1a)
+{
+	uint64 hash = 14695981039346656037ULL;
+	for (int s=0; s<MaxSats; s++) {
+		if (!gps.obs[s].Valid) continue;
+		int64 pr = (int64)(gps.obs[s].PR * 1000 + .5);
+		hash = (hash ^ s) * 1099511628211ULL;
+		hash = (hash ^ (uint64)pr) * 1099511628211ULL;
+	}
+	return hash;
+}
+
+
+
+Source::Source(int how, const char* name)
+{
+	File = NULL; Buf = NULL; Map = NULL; Gps = NULL;
+	CanSeek = (how == RinexMapped || how == RinexLoaded || how == Rtcm23Mapped);
+
+	if (how == RinexLoaded)
+		Gps = new RawRinexStore(name, 1);
+	else {
+		Stream* in;
+		if (CanSeek)
+			in = Map = new MmapInputFile(name);
+		else {
+			File = new InputFile(name);
+			in = Buf = new BufferedStream(*File);
+		}
+		if (in->GetError() != OK) {
+			Error("Can't open %s\n", name);
+			return;
+		}
+		if (how == RinexMapped || how == RinexStream)
+			Gps = new RawRinex(*in);
+		else
+			Gps = new RawRtcm23(*in);
+	}
+
+	if (Gps->GetError() != OK) {
+		Error("Can't read %s\n", name);
+		delete Gps;
+		Gps = NULL;
+	}
+}
+
+
+Source::~Source()
+{
+	delete Gps;
+	delete Buf;
+	delete File;
+	delete Map;
+}
+
+
+
+ bool Configure(int argc, const char** argv)
+ {
+     // defaults
+	 Epochs = 3600;
+	 Seeks = 200;
+	 Capture = NULL;
+	 Start = DateToTime(2006, 11, 5) + 6*NsecPerHour;
+	 srand(1);
+
+	 // Do for each argument
+	 const char* arg;
+	 int i;
+	 for (i=1; i<argc && argv[i][0] == '-'; i++) {
+
+		 if (Match(argv[i], "-debug=", arg))            DebugLevel = atoi(arg);
+		 else if (Match(argv[i], "-epochs=", arg))      Epochs = atoi(arg);
+		 else if (Match(argv[i], "-seeks=", arg))       Seeks = atoi(arg);
+		 else if (Match(argv[i], "-capture=", arg))     Capture = arg;
+		 else    return Error("Didn't recognize option %s\n", argv[i]);
+	 }
+
+	 if (Epochs < 1 || Seeks < 0)
+		 return Error("Need some epochs\n");
+
+	 return OK;
+ }
+
+
+ bool DisplayOptions()
+ {
+	 printf("\n");
+     printf("BenchSeek [options]\n");
+	 printf("     Seek Rinex and RTCM 2.3 receivers to a time, and check the next epoch\n");
+	 printf("\n");
+	 printf("    Where {options} include any of the following:\n");
+	 printf("        -epochs=n        - epochs of made up data, one a second (default 3600)\n");
+	 printf("        -seeks=n         - times to seek to (default 200)\n");
+	 printf("        -capture=file    - an RTCM 2.3 capture to use instead of the made up one\n");
+	 printf("\n");
+	 return OK;
+ }
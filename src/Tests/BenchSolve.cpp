@@ -0,0 +1,245 @@
+// BenchSolve - time the per-epoch solution of the gps equations
+//    Part of kinematic, a collection of utilities for GPS positioning
+//
+// Copyright (C) 2005  John Morris    kinematic@coyotebush.net
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation, version 2.
+
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// Runs a synthetic kinematic session through GpsEquations once for each
+//   set of Householder kernels, and reports the time per epoch. The solutions
+//   from each set are compared against the plain C kernels.
+//
+// The session is then repeated with the dense factorization, and "-sweep"
+//   compares sparse against dense over a range of satellites.
+//
+////////////////////////////////////////////////////////////////////////////////
+
+#include "GpsEquations.h"
+#include <stdio.h>
+#include <time.h>
+
+bool BenchSolve(int argc, const char** argv);
+bool Configure(int argc, const char** argv);
+bool DisplayOptions();
+bool RunSession(double& usec, double* answer);
+bool CompareDense(double& sparse, double& dense, double& diff);
+bool Sweep();
+double Random();
+
+// run string parameters
+int Sats;
+int Epochs;
+const char* KernelName;
+bool Sweeping;
+
+static const char* KernelNames[] = {"c", "sse2", "avx2", "neon"};
+static const int NrKernelNames = sizeof(KernelNames)/sizeof(KernelNames[0]);
+
+
+int main(int argc, const char** argv)
+{
+	BenchSolve(argc, argv);
+	ShowErrors();
+	return 0;
+}
+
+
+bool BenchSolve(int argc, const char** argv)
+{
+	// parse the command line
+	if (Configure(argc, argv) != OK) {
+		DisplayOptions();
+		return Error();
+	}
+
+	if (Sweeping)
+		return Sweep();
+
+	printf("%d satellites, %d epochs\n", Sats, Epochs);
+	printf("kernels   usec/epoch   speedup   solution\n");
+
+	double reference[MaxSats+3];
+	double ReferenceTime = 0;
+	for (int k=0; k<NrKernelNames; k++) {
+		if (KernelName != NULL && k != 0 && strcmp(KernelName, KernelNames[k]) != 0) continue;
+		if (SelectKernels(KernelNames[k]) != OK) {ClearError(); continue;}
+
+		// Run the session and compare against the plain C kernels
+		double usec, answer[MaxSats+3];
+		if (RunSession(usec, answer) != OK) return Error();
+		if (k == 0) {
+			ReferenceTime = usec;
+			memcpy(reference, answer, sizeof(reference));
+		}
+		const char* same = (memcmp(reference, answer, sizeof(answer)) == 0)? "identical": "DIFFERENT";
+
+		printf("%-8s %10.2f %9.2f   %s\n", KernelNames[k], usec, ReferenceTime/usec, same);
+	}
+	if (SelectKernels(KernelName) != OK) return Error();
+
+	// Compare the dense factorization, using the best kernels
+	double sparse, dense, diff;
+	if (CompareDense(sparse, dense, diff) != OK) return Error();
+	printf("\nsparse %.2f  dense %.2f usec/epoch  speedup %.2f  max difference %.3g\n",
+		sparse, dense, dense/sparse, diff);
+
+	return OK;
+}
+
+
+bool CompareDense(double& sparse, double& dense, double& diff)
+{
+	bool SavedSparse = SparseFactor;
+	double a[MaxSats+3], b[MaxSats+3];
+
+	SparseFactor = true;
+	if (RunSession(sparse, a) != OK) return Error();
+	SparseFactor = false;
+	if (RunSession(dense, b) != OK) return Error();
+	SparseFactor = SavedSparse;
+
+	diff = 0;
+	for (int i=0; i<MaxSats+3; i++)
+		diff = max(diff, abs(a[i]-b[i]));
+	return OK;
+}
+
+
+bool Sweep()
+// Compare sparse against dense for increasing numbers of satellites.
+{
+	if (SelectKernels(KernelName) != OK) return Error();
+	printf("kernels %s, %d epochs\n", Kernels->Name, Epochs);
+	printf("sats  columns      sparse     dense   speedup  max difference\n");
+
+	for (Sats=6; GpsEquationsSize(Sats+2) != -1; Sats+=4) {
+		double sparse, dense, diff;
+		if (CompareDense(sparse, dense, diff) != OK) return Error();
+		int columns = Sats + 4;
+		printf("%4d %8d %11.2f %9.2f %9.2f  %.3g\n", Sats, columns, sparse, dense, 
+			dense/sparse, diff);
+	}
+
+	return OK;
+}
+
+
+
+bool RunSession(double& usec, double* answer)
+{
+	// Start with a reproducible geometry
+	srand(1);
+	Triple e[MaxSats];
+	for (int s=0; s<Sats; s++) {
+		e[s] = Triple(Random(), Random(), Random()+1.5);
+		e[s] = e[s] / Range(e[s]);
+	}
+
+	GpsEquationsBase* eqn = NewGpsEquations(Sats+2);
+	if (eqn == NULL) return Error();
+
+	// Satellite 0 is the reference, so it has no phase variable
+	for (int s=1; s<Sats; s++)
+		if (eqn->AddPhase(s) != OK) return Error();
+
+	// Do for each epoch
+	clock_t start = clock();
+	for (int epoch=0; epoch<Epochs; epoch++) {
+		eqn->NewPosition();
+		eqn->NewEpoch();
+
+		// The satellites drift across the sky
+		for (int s=0; s<Sats; s++) {
+			e[s] = e[s] + Triple(Random(), Random(), Random()) * .001;
+			e[s] = e[s] / Range(e[s]);
+			eqn->AppendCode(e[s], Random()*5, 1);
+			eqn->AppendPhase(e[s], Random()*.01, s, L1WaveLength, 0, 100);
+		}
+
+		Position offset; double cep, fit;
+		if (eqn->SolvePosition(offset, cep, fit) != OK) return Error();
+	}
+	usec = (double)(clock() - start) / CLOCKS_PER_SEC / Epochs * 1000000;
+
+	// Save the final solution
+	Position offset = eqn->GetOffset();
+	answer[0] = offset.x; answer[1] = offset.y; answer[2] = offset.z;
+	for (int s=0; s<MaxSats; s++)
+		answer[s+3] = (s < Sats)? eqn->GetAmbiguity(s): 0;
+
+	delete eqn;
+	return OK;
+}
+
+
+double Random()
+// Uniform between -1 and 1
+{
+	return 2.0 * rand() / RAND_MAX - 1;
+}
+
+
+
+ bool Configure(int argc, const char** argv)
+ {
+     // defaults
+	 Sats = 12;
+	 Epochs = 5000;
+	 KernelName = NULL;
+	 Sweeping = false;
+
+	 // Do for each argument
+	 const char* arg;
+	 int i;
+	 for (i=1; i<argc && argv[i][0] == '-'; i++) {
+
+		 if (Match(argv[i], "-debug=", arg))            DebugLevel = atoi(arg);
+		 else if (Match(argv[i], "-sats=", arg))        Sats = atoi(arg);
+		 else if (Match(argv[i], "-epochs=", arg))      Epochs = atoi(arg);
+		 else if (Match(argv[i], "-kernels=", KernelName))  ;
+		 else if (Same(argv[i], "-sweep"))              Sweeping = true;
+		 else if (Same(argv[i], "-dense"))              SparseFactor = false;
+		 else if (Match(argv[i], "-slack=", arg))       GroupSlack = atoi(arg);
+		 else    return Error("Didn't recognize option %s\n", argv[i]);
+	 }
+
+	 if (Sats < 4 || GpsEquationsSize(Sats+2) == -1)
+		 return Error("The number of satellites must be from 4 to %d\n",
+		              EquationChannels[NrEquationSizes-1]-2);
+	 if (Epochs < 1)
+		 return Error("Need at least one epoch\n");
+
+	 return OK;
+ }
+
+
+ bool DisplayOptions()
+ {
+	 printf("\n");
+     printf("BenchSolve [options]\n");
+	 printf("     Time the per-epoch solution of the gps equations\n");
+	 printf("\n");
+	 printf("    Where {options} include any of the following:\n");
+	 printf("        -sats=n          - number of satellites (default 12)\n");
+	 printf("        -epochs=n        - number of epochs (default 5000)\n");
+	 printf("        -kernels=name    - only compare c against these kernels (sse2, avx2, neon)\n");
+	 printf("        -sweep           - compare sparse and dense for 6 or more satellites\n");
+	 printf("        -dense           - don't skip the zeros when factoring\n");
+	 printf("        -slack=n         - group rows reaching up to n columns further (default %d)\n", (int)GroupSlack);
+	 printf("\n");
+	 return OK;
+ }
@@ -0,0 +1,161 @@
+// BenchStream - count the reads it takes to get through a file
+//    Part of kinematic, a collection of utilities for GPS positioning
+//
+// Copyright (C) 2005  John Morris    kinematic@coyotebush.net
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation, version 2.
+
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// Reads a file by lines and then a byte at a time, the way the Rinex
+//   reader and the receiver framers do, first straight from the file and
+//   then through a BufferedStream.
+//
+// Reports how many reads reached the underlying stream (on a socket or
+//   serial port, each one is a system call), the time taken, and whether
+//   both ways got the same data.
+//
+////////////////////////////////////////////////////////////////////////////////
+
+#include "InputFile.h"
+#include "BufferedStream.h"
+#include <stdio.h>
+#include <time.h>
+
+bool BenchStream(int argc, const char** argv);
+bool Configure(int argc, const char** argv);
+bool DisplayOptions();
+bool RunBench(const char* title, bool lines);
+
+// run string parameters
+const char* FileName;
+int32 BufferSize;
+
+
+// Counts the reads which get through to the file
+class CountingStream: public InputFile
+{
+public:
+	CountingStream(const char* name): InputFile(name) {Reads = 0;}
+	using Stream::Read;
+	bool Read(byte* buf, size_t len, size_t& actual)
+	    {Reads++; return InputFile::Read(buf, len, actual);}
+	int32 Reads;
+};
+
+
+
+int main(int argc, const char** argv)
+{
+	BenchStream(argc, argv);
+	ShowErrors();
+	return 0;
+}
+
+
+bool BenchStream(int argc, const char** argv)
+{
+	// parse the command line
+	if (Configure(argc, argv) != OK) {
+		DisplayOptions();
+		return Error();
+	}
+
+	printf("%-8s %-10s %12s %12s %10s %18s\n", "", "", "reads", "bytes", "msec", "checksum");
+	if (RunBench("lines", true) != OK) return Error();
+	if (RunBench("bytes", false) != OK) return Error();
+
+	// The end of file errors are expected
+	ClearError();
+	return OK;
+}
+
+
+
+bool RunBench(const char* title, bool lines)
+{
+	for (int buffered=0; buffered<2; buffered++) {
+		CountingStream file(FileName);
+		if (file.GetError() != OK) return Error("Can't open %s\n", FileName);
+		BufferedStream buf(file, BufferSize);
+		Stream& in = buffered? (Stream&)buf: (Stream&)file;
+
+		// Checksum the data (FNV-1a) so we know both ways agree
+		uint64 hash = 14695981039346656037ULL;
+		uint64 bytes = 0;
+		clock_t begin = clock();
+
+		if (lines) {
+			char line[256];
+			while (in.ReadLine(line, sizeof(line)) == OK)
+				for (char* p=line; *p != 0; p++, bytes++)
+					hash = (hash ^ (byte)*p) * 1099511628211ULL;
+		} else {
+			byte c;
+			while (in.Read(c) == OK) {
+				hash = (hash ^ c) * 1099511628211ULL;
+				bytes++;
+			}
+		}
+
+		double msec = (double)(clock() - begin) / CLOCKS_PER_SEC * 1000;
+		printf("%-8s %-10s %12d %12.0f %10.1f %18llx\n", title,
+			buffered? "buffered": "direct", (int)file.Reads, (double)bytes, msec,
+			(unsigned long long)hash);
+	}
+
+	return OK;
+}
+
+
+
+ bool Configure(int argc, const char** argv)
+ {
+     // defaults
+	 BufferSize = 64*1024;
+
+	 // Do for each argument
+	 const char* arg;
+	 int i;
+	 for (i=1; i<argc && argv[i][0] == '-'; i++) {
+
+		 if (Match(argv[i], "-debug=", arg))            DebugLevel = atoi(arg);
+		 else if (Match(argv[i], "-buffer=", arg))      BufferSize = atoi(arg);
+		 else    return Error("Didn't recognize option %s\n", argv[i]);
+	 }
+
+	 if (argc - i != 1)
+		 return Error("Need the name of a file to read\n");
+	 FileName = argv[i];
+
+	 if (BufferSize < 1)
+		 return Error("The buffer needs at least one byte\n");
+
+	 return OK;
+ }
+
+
+ bool DisplayOptions()
+ {
+	 printf("\n");
+     printf("BenchStream [options] file\n");
+	 printf("     Count the reads it takes to get through a file, with and without buffering\n");
+	 printf("\n");
+	 printf("    Where {options} include any of the following:\n");
+	 printf("        -buffer=bytes    - size of the buffer (default 65536)\n");
+	 printf("\n");
+	 return OK;
+ }
@@ -1,4 +1,4 @@
-APPS = NtripServer ZeroBase
+APPS = NtripServer ZeroBase BenchSolve BenchFix BenchEphemeris BenchStream BenchRinex BenchExclude BenchArchive BenchSeek
 
 all: $(APPS)
 